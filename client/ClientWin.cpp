@@ -26,16 +26,42 @@ using namespace client;
 extern Display *maindpy;
 
 
+// With the FIFO policy, the queue depth is the number of tiles that can be
+// queued, and the default was chosen so that the decoder runs at most one tile
+// behind the receiver (as in previous releases.)  This keeps the receiver from
+// reading ahead, so the server sees back pressure from a slow client and
+// spoils frames before sending them.  With the newest-wins policy, the queue
+// depth is the number of whole frames that can be queued, so that the receiver
+// can keep reading from the socket while the decoder works through a backlog
+// (and the decoder, rather than the server, skips the superseded frames.)
+#define DEFQUEUEDEPTH_FIFO    2
+#define DEFQUEUEDEPTH_NEWEST  8
+
+
 ClientWin::ClientWin(int dpynum_, Window window_, int drawMethod_,
-	bool stereo_) : drawMethod(drawMethod_), reqDrawMethod(drawMethod_),
-	fb(NULL), cfindex(0), deadYet(false), thread(NULL), stereo(stereo_)
+	bool stereo_, int queuePolicy_, int queueDepth) : drawMethod(drawMethod_),
+	reqDrawMethod(drawMethod_), nFrames(queueDepth), queuePolicy(queuePolicy_),
+	fb(NULL), cfindex(0), nSlots(0), tiles(0), maxTiles(1), nPending(0), profile(false), latencySum(0.),
+	latencyMax(0.), latencyFrames(0), dropped(0), deadYet(false), thread(NULL),
+	stereo(stereo_)
 {
+	char *env = NULL;
+
 	if(dpynum_ < 0 || dpynum_ > 65535 || !window_)
 		throw(Error("ClientWin::ClientWin()", "Invalid argument"));
 	dpynum = dpynum_;  window = window_;
+	if(queuePolicy != RR_QUEUENEWEST) queuePolicy = RR_QUEUEFIFO;
+	if(nFrames < 2 || nFrames > MAXFRAMES)
+		nFrames = queuePolicy == RR_QUEUENEWEST ?
+			DEFQUEUEDEPTH_NEWEST : DEFQUEUEDEPTH_FIFO;
+	nSlots = nFrames;
+	for(int i = 0; i < MAXSLOTS; i++) cframes[i] = NULL;
+	if((env = getenv("VGL_PROFILE")) != NULL && !strncmp(env, "1", 1))
+		profile = true;
+	latencyTimer.start();
 
 	#ifdef USEXV
-	for(int i = 0; i < NFRAMES; i++) xvframes[i] = NULL;
+	for(int i = 0; i < MAXSLOTS; i++) xvframes[i] = NULL;
 	#endif
 	if(drawMethod == RR_DRAWAUTO) drawMethod = RR_DRAWX11;
 	if(stereo) drawMethod = RR_DRAWOGL;
@@ -54,7 +80,7 @@ ClientWin::~ClientWin(void)
 	if(thread) thread->stop();
 	delete fb;  fb = NULL;
 	#ifdef USEXV
-	for(int i = 0; i < NFRAMES; i++)
+	for(int i = 0; i < MAXSLOTS; i++)
 	{
 		if(xvframes[i])
 		{
@@ -62,7 +88,13 @@ ClientWin::~ClientWin(void)
 		}
 	}
 	#endif
-	for(int i = 0; i < NFRAMES; i++) cframes[i].signalComplete();
+	for(int i = 0; i < MAXSLOTS; i++)
+	{
+		if(cframes[i])
+		{
+			cframes[i]->signalComplete();  delete cframes[i];  cframes[i] = NULL;
+		}
+	}
 	delete thread;  thread = NULL;
 }
 
@@ -161,8 +193,15 @@ Frame *ClientWin::getFrame(bool useXV)
 	}
 	else
 	#endif
-	f = (Frame *)&cframes[cfindex];
-	cfindex = (cfindex + 1) % NFRAMES;
+	{
+		if(!cframes[cfindex])
+		{
+			cframes[cfindex] = new CompressedFrame();
+			if(!cframes[cfindex]) THROW("Could not allocate class instance");
+		}
+		f = (Frame *)cframes[cfindex];
+	}
+	cfindex = (cfindex + 1) % nSlots;
 	cfmutex.unlock();
 	f->waitUntilComplete();
 	if(thread) thread->checkError();
@@ -193,10 +232,131 @@ void ClientWin::drawFrame(Frame *f)
 			initX11();
 		}
 	}
+	if(queuePolicy == RR_QUEUENEWEST)
+	{
+		CriticalSection::SafeLock l(pendingMutex);
+		if(f->hdr.flags == RR_EOF) spoilPending();
+		if(nPending < MAXSLOTS)
+		{
+			pending[nPending] = f;  superseded[nPending] = false;  nPending++;
+		}
+		tiles++;
+		if(f->hdr.flags == RR_EOF)
+		{
+			// Spoiling happens only when the previous frame's End-of-Frame marker
+			// is still queued when the next one arrives, so there must be enough
+			// slots to hold nFrames whole frames.  Otherwise, the receiver would
+			// block on a slot that the decoder has not yet freed, and the decoder
+			// would never fall far enough behind to skip anything.
+			if(tiles > maxTiles)
+			{
+				maxTiles = tiles;
+				CriticalSection::SafeLock cfl(cfmutex);
+				nSlots = min(nFrames * maxTiles, (int)MAXSLOTS);
+			}
+			tiles = 0;
+		}
+	}
 	q.add(f);
 }
 
 
+static bool sameTile(Frame *f1, Frame *f2)
+{
+	return f1->isXV == f2->isXV && f1->hdr.flags == f2->hdr.flags
+		&& f1->hdr.x == f2->hdr.x && f1->hdr.y == f2->hdr.y
+		&& f1->hdr.width == f2->hdr.width && f1->hdr.height == f2->hdr.height
+		&& f1->hdr.framew == f2->hdr.framew && f1->hdr.frameh == f2->hdr.frameh;
+}
+
+
+// Called when an End-of-Frame marker is received.  If the End-of-Frame marker
+// for the previous frame is still queued, then the decoder has fallen behind,
+// so the previous frame is merged into the new one:  its End-of-Frame marker
+// is not drawn, and any of its tiles that are replaced by a tile in the new
+// frame are not decoded.  Tiles that are not replaced must still be decoded,
+// since the new frame contains only the tiles that changed.
+
+void ClientWin::spoilPending(void)
+{
+	int prevEOF = -1;
+
+	for(int i = nPending - 1; i >= 0; i--)
+	{
+		if(pending[i]->hdr.flags == RR_EOF) { prevEOF = i;  break; }
+	}
+	if(prevEOF < 0) return;
+
+	superseded[prevEOF] = true;
+	for(int i = 0; i < prevEOF; i++)
+	{
+		if(superseded[i] || pending[i]->hdr.flags == RR_EOF) continue;
+		for(int j = prevEOF + 1; j < nPending; j++)
+		{
+			if(sameTile(pending[i], pending[j]))
+			{
+				superseded[i] = true;  break;
+			}
+		}
+	}
+}
+
+
+// Remove a frame from the head of the pending list, and return true if it has
+// been superseded
+
+bool ClientWin::dequeue(Frame *f)
+{
+	bool ret = false;
+
+	if(queuePolicy != RR_QUEUENEWEST) return false;
+	CriticalSection::SafeLock l(pendingMutex);
+	if(nPending < 1 || pending[0] != f)
+		throw(Error("ClientWin::run()", "Frame queue is out of sync"));
+	ret = superseded[0];
+	for(int i = 0; i < nPending - 1; i++)
+	{
+		pending[i] = pending[i + 1];  superseded[i] = superseded[i + 1];
+	}
+	nPending--;
+	return ret;
+}
+
+
+// Estimate the motion-to-photon latency of a frame that has just been drawn,
+// that is, the time from the moment the application triggered the frame on
+// the server to the moment it was drawn on the client.  The server and client
+// clocks are not synchronized, so the time spent in transit is estimated as
+// half of the round-trip time.
+
+void ClientWin::reportLatency(Frame *f)
+{
+	if(!profile) return;
+	if(f->timing.frameID != 0)
+	{
+		double latency = (double)f->timing.sent / 1000000.
+			+ (double)f->timing.rtt / 2000000. + (GetTime() - f->timestamp);
+		latencySum += latency;  latencyFrames++;
+		if(latency > latencyMax) latencyMax = latency;
+	}
+	if(latencyFrames == 0 && dropped == 0) return;
+	if(latencyTimer.elapsed() > 2.0)
+	{
+		char temps[256];  size_t i = 0;
+		if(latencyFrames > 0)
+			snprintf(temps, 255, "Latency     - %7.2f ms avg - %7.2f ms max",
+				latencySum / (double)latencyFrames * 1000., latencyMax * 1000.);
+		else snprintf(temps, 255, "Latency     - (not available)");
+		i = strlen(temps);
+		if(queuePolicy == RR_QUEUENEWEST)
+			snprintf(&temps[i], 255 - i, " - %d frames dropped", dropped);
+		vglout.PRINTLN("%s", temps);
+		latencySum = latencyMax = 0.;  latencyFrames = dropped = 0;
+		latencyTimer.start();
+	}
+}
+
+
 void ClientWin::run(void)
 {
 	Profiler pt("Total     "), pb("Blit      "), pd("Decompress");
@@ -210,11 +370,18 @@ void ClientWin::run(void)
 			q.get(&ftemp);  f = (Frame *)ftemp;  if(deadYet) break;
 			if(!f)
 				throw(Error("ClientWin::run()", "Invalid image received from queue"));
+			if(dequeue(f))
+			{
+				if(f->hdr.flags == RR_EOF) dropped++;
+				f->signalComplete();
+				continue;
+			}
 			CriticalSection::SafeLock l(mutex);
 			#ifdef USEXV
 			if(f->isXV)
 			{
-				if(f->hdr.flags != RR_EOF)
+				if(f->hdr.flags == RR_EOF) reportLatency(f);
+				else
 				{
 					pb.startFrame();
 					((XVFrame *)f)->redraw();
@@ -235,6 +402,7 @@ void ClientWin::run(void)
 					if(fb->isGL) ((GLFrame *)fb)->redraw();
 					else ((FBXFrame *)fb)->redraw();
 					pb.endFrame(fb->hdr.framew * fb->hdr.frameh, 0, 1);
+					reportLatency(f);
 					pt.endFrame(fb->hdr.framew * fb->hdr.frameh, bytes, 1);
 					bytes = 0;
 					pt.startFrame();
@@ -18,10 +18,14 @@
 #include "Frame.h"
 #include "Thread.h"
 #include "GenericQ.h"
+#include "Timer.h"
 
 
 enum { RR_DRAWAUTO = -1, RR_DRAWX11 = 0, RR_DRAWOGL };
 
+// Queue policies
+enum { RR_QUEUEFIFO = 0, RR_QUEUENEWEST };
+
 
 namespace client
 {
@@ -29,7 +33,8 @@ namespace client
 	{
 		public:
 
-			ClientWin(int dpynum, Window window, int drawMethod, bool stereo);
+			ClientWin(int dpynum, Window window, int drawMethod, bool stereo,
+				int queuePolicy = RR_QUEUEFIFO, int queueDepth = 0);
 			virtual ~ClientWin(void);
 			common::Frame *getFrame(bool useXV);
 			void drawFrame(common::Frame *f);
@@ -40,15 +45,32 @@ namespace client
 
 			void initGL(void);
 			void initX11(void);
+			void spoilPending(void);
+			bool dequeue(common::Frame *f);
+			void reportLatency(common::Frame *f);
 
 			int drawMethod, reqDrawMethod;
-			static const int NFRAMES = 2;
+			static const int MAXFRAMES = 16;
+			// Each slot holds one tile (or End-of-Frame marker.)  With the
+			// newest-wins queue policy, the number of slots grows to nFrames times
+			// the largest number of tiles in a frame, so that nFrames whole frames
+			// can be queued.
+			static const int MAXSLOTS = 1024;
+			int nFrames, queuePolicy;
 			common::Frame *fb;
-			common::CompressedFrame cframes[NFRAMES];  int cfindex;
+			common::CompressedFrame *cframes[MAXSLOTS];  int cfindex, nSlots;
+			int tiles, maxTiles;
 			#ifdef USEXV
-			common::XVFrame *xvframes[NFRAMES];
+			common::XVFrame *xvframes[MAXSLOTS];
 			#endif
 			util::GenericQ q;
+			// With the newest-wins queue policy, the tiles that have been queued
+			// but not yet decoded, in queue order, and whether each has been
+			// superseded by a newer frame
+			common::Frame *pending[MAXSLOTS];  bool superseded[MAXSLOTS];
+			int nPending;  util::CriticalSection pendingMutex;
+			bool profile;  util::Timer latencyTimer;
+			double latencySum, latencyMax;  int latencyFrames, dropped;
 			bool deadYet;
 			int dpynum;  Window window;
 			void run(void);
@@ -136,6 +136,12 @@ GLFrame &GLFrame::operator= (CompressedFrame &cf)
 			if(stereo && cf.rbits && rbits)
 				decompressRGB(cf, width, height, true);
 		}
+		else if(cf.hdr.compress == RRCOMP_LOSSLESS)
+		{
+			decompressLossless(cf, cf.hdr.size, width, height, false);
+			if(stereo && cf.rbits && rbits)
+				decompressLossless(cf, cf.rhdr.size, width, height, true);
+		}
 		else
 		{
 			if(!tjhnd)
@@ -67,6 +67,44 @@ static unsigned short DisplayNumber(Display *dpy)
 	} \
 }
 
+#define ENDIANIZE_CAPS(c) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		c.flags = BYTESWAP(c.flags); \
+		c.shmid = BYTESWAP(c.shmid); \
+	} \
+}
+
+#define ENDIANIZE_TIMING(t) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		t.frameID = BYTESWAP(t.frameID); \
+		t.queued = BYTESWAP(t.queued); \
+		t.sent = BYTESWAP(t.sent); \
+		t.rtt = BYTESWAP(t.rtt); \
+	} \
+}
+
+#define ENDIANIZE_STREAMS(s) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		s.count = BYTESWAP(s.count); \
+		s.index = BYTESWAP(s.index); \
+	} \
+}
+
+#define ENDIANIZE_SHMREF(r) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		r.offset = BYTESWAP(r.offset); \
+		r.end = BYTESWAP(r.end); \
+	} \
+}
+
 #define CONVERT_HEADER(h1, h) \
 { \
 	h.size = h1.size; \
@@ -84,9 +122,10 @@ static unsigned short DisplayNumber(Display *dpy)
 }
 
 
-VGLTransReceiver::VGLTransReceiver(bool ipv6_, int drawMethod_) :
-	drawMethod(drawMethod_), listenSocket(NULL), thread(NULL), deadYet(false),
-	ipv6(ipv6_)
+VGLTransReceiver::VGLTransReceiver(bool ipv6_, int drawMethod_,
+	int queuePolicy_, int queueDepth_) : drawMethod(drawMethod_),
+	queuePolicy(queuePolicy_), queueDepth(queueDepth_), listenSocket(NULL),
+	thread(NULL), deadYet(false), ipv6(ipv6_)
 {
 	char *env = NULL;
 
@@ -133,7 +172,7 @@ void VGLTransReceiver::run(void)
 			listener = NULL;  socket = NULL;
 			socket = listenSocket->accept();  if(deadYet) break;
 			vglout.println("++ Connection from %s.", socket->remoteName());
-			listener = new Listener(socket, drawMethod);
+			listener = new Listener(socket, drawMethod, queuePolicy, queueDepth);
 			continue;
 		}
 		catch(std::exception &e)
@@ -154,12 +193,16 @@ void VGLTransReceiver::run(void)
 }
 
 
+VGLTransReceiver::Listener *VGLTransReceiver::Listener::sessions = NULL;
+CriticalSection VGLTransReceiver::Listener::sessionMutex;
+
+
 void VGLTransReceiver::Listener::run(void)
 {
 	ClientWin *w = NULL;
 	Frame *f = NULL;
 	rrframeheader h;  rrframeheader_v1 h1;  bool haveHeader = false;
-	rrversion v;
+	rrversion &v = version;  rrframetiming timing;
 
 	try
 	{
@@ -185,8 +228,11 @@ void VGLTransReceiver::Listener::run(void)
 			&& !strncmp(env, "1", 1))
 			vglout.println("Server version: %d.%d", v.major, v.minor);
 		vglout.flush();
+		if(v.major > 2 || (v.major == 2 && v.minor >= 2)) negotiateCaps();
 
-		while(1)
+		// If this connection has been handed to another Listener as an additional
+		// stream, then there is nothing more for us to do.
+		while(!joined)
 		{
 			do
 			{
@@ -200,48 +246,23 @@ void VGLTransReceiver::Listener::run(void)
 					haveHeader = false;
 					CONVERT_HEADER(h1, h);
 				}
+				else if(compactHeaders) reader.readHeader(h);
 				else
 				{
 					recv((char *)&h, sizeof_rrframeheader);
 					ENDIANIZE(h);
 				}
-				bool stereo = (h.flags == RR_LEFT || h.flags == RR_RIGHT);
-				unsigned short dpynum =
-					(v.major < 2 || (v.major == 2 && v.minor < 1)) ?
-					h.dpynum : DisplayNumber(maindpy);
-				ERRIFNOT(w = addWindow(dpynum, h.winid, stereo));
-
-				if(!stereo || h.flags == RR_LEFT || !f)
+				memset(&timing, 0, sizeof(rrframetiming));
+				if(h.flags == RR_EOF && recvTiming)
 				{
-					try
-					{
-						f = w->getFrame(h.compress == RRCOMP_YUV);
-					}
-					catch(...) { if(w) deleteWindow(w);  throw; }
-				}
-				#ifdef USEXV
-				if(h.compress == RRCOMP_YUV)
-				{
-					((XVFrame *)f)->init(h);
-					if(h.size != ((XVFrame *)f)->hdr.size && h.flags != RR_EOF)
-						THROW("YUV image size mismatch");
-				}
-				else
-				#endif
-				((CompressedFrame *)f)->init(h, h.flags);
-				if(h.flags != RR_EOF)
-					recv((char *)(h.flags == RR_RIGHT ? f->rbits : f->bits), h.size);
-
-				if(!stereo || h.flags != RR_LEFT)
-				{
-					try
-					{
-						w->drawFrame(f);
-					}
-					catch(...) { if(w) deleteWindow(w);  throw; }
+					reader.read((char *)&timing, sizeof_rrframetiming);
+					ENDIANIZE_TIMING(timing);
 				}
+				if(h.flags == RR_EOF) waitForStreams();
+				recvTile(reader, h, &timing, w, f);
 
 			} while(!(f && f->hdr.flags == RR_EOF));
+			resumeStreams();
 
 			if(v.major == 1 && v.minor == 0)
 			{
@@ -259,6 +280,332 @@ void VGLTransReceiver::Listener::run(void)
 }
 
 
+// Receive the image data for a tile whose header has already been received
+// through Reader r, and pass the tile to the appropriate ClientWin instance.
+// This is called by both the Listener and the Stream threads, so only the
+// Listener deletes a window that has become invalid.
+
+void VGLTransReceiver::Listener::recvTile(Reader &r, rrframeheader &h,
+	rrframetiming *timing, ClientWin *&w, Frame *&f)
+{
+	bool primary = (&r == &reader);
+	bool shmData = (h.flags & RR_SHMDATA) != 0;
+	h.flags &= ~RR_SHMDATA;
+	if(shmData && (!shmRing || !primary))
+		THROW("Server sent shared memory data without negotiating it");
+	bool stereo = (h.flags == RR_LEFT || h.flags == RR_RIGHT);
+	unsigned short dpynum =
+		(version.major < 2 || (version.major == 2 && version.minor < 1)) ?
+		h.dpynum : DisplayNumber(maindpy);
+	ERRIFNOT(w = addWindow(dpynum, h.winid, stereo));
+
+	if(!stereo || h.flags == RR_LEFT || !f)
+	{
+		try
+		{
+			f = w->getFrame(h.compress == RRCOMP_YUV);
+		}
+		catch(...) { if(w && primary) deleteWindow(w);  throw; }
+	}
+	#ifdef USEXV
+	if(h.compress == RRCOMP_YUV)
+	{
+		((XVFrame *)f)->init(h);
+		if(h.size != ((XVFrame *)f)->hdr.size && h.flags != RR_EOF)
+			THROW("YUV image size mismatch");
+	}
+	else
+	#endif
+	((CompressedFrame *)f)->init(h, h.flags);
+	if(h.flags == RR_EOF)
+	{
+		if(timing) f->timing = *timing;
+		else memset(&f->timing, 0, sizeof(rrframetiming));
+		f->timestamp = GetTime();
+	}
+	else
+	{
+		char *bits = (char *)(h.flags == RR_RIGHT ? f->rbits : f->bits);
+		if(shmData)
+		{
+			rrshmref ref;
+			r.read((char *)&ref, sizeof_rrshmref);
+			ENDIANIZE_SHMREF(ref);
+			shmRing->read(bits, h.size, ref);
+		}
+		else r.read(bits, h.size);
+	}
+
+	if(!stereo || h.flags != RR_LEFT)
+	{
+		CriticalSection::SafeLock l(drawMutex);
+		try
+		{
+			w->drawFrame(f);
+		}
+		catch(...) { if(w && primary) deleteWindow(w);  throw; }
+	}
+}
+
+
+// Wait until all of the additional streams have received the End-of-Frame
+// marker for the current frame
+
+void VGLTransReceiver::Listener::waitForStreams(void)
+{
+	for(int i = 1; i < nStreams; i++)
+	{
+		streamThreads[i]->eof.wait();
+		if(streamThreads[i]->error) throw(Error(streamThreads[i]->error));
+	}
+}
+
+
+void VGLTransReceiver::Listener::resumeStreams(void)
+{
+	for(int i = 1; i < nStreams; i++) streamThreads[i]->resume.signal();
+}
+
+
+// The server offers a set of capabilities, and we reply with the subset of
+// those that we can use.
+void VGLTransReceiver::Listener::negotiateCaps(void)
+{
+	rrcaps caps;  char *env = NULL;
+	bool verbose = ((env = getenv("VGL_VERBOSE")) != NULL && strlen(env) > 0
+		&& !strncmp(env, "1", 1));
+
+	recv((char *)&caps, sizeof_rrcaps);
+	ENDIANIZE_CAPS(caps);
+	caps.flags &= RR_CAP_SHM | RR_CAP_TIMING | RR_CAP_STREAMS | RR_CAP_COMPACT |
+		RR_CAP_LOSSLESS;
+	recvTiming = (caps.flags & RR_CAP_TIMING) != 0;
+	compactHeaders = (caps.flags & RR_CAP_COMPACT) != 0;
+
+	if(caps.flags & RR_CAP_SHM)
+	{
+		if((env = getenv("VGL_SHMTRANS")) != NULL && strlen(env) > 0
+			&& !strncmp(env, "0", 1))
+			caps.flags &= ~RR_CAP_SHM;
+		else
+		{
+			try
+			{
+				shmRing = new ShmRing(caps.shmid, caps.shmkey);
+				if(verbose)
+					vglout.println("Using shared memory to receive image data");
+			}
+			catch(std::exception &e)
+			{
+				// Most likely, the server is on a different host that happens to be
+				// using the same IP address (NAT, containers, etc.)
+				if(verbose)
+					vglout.println("Could not attach to shared memory ring:\n   %s",
+						e.what());
+				shmRing = NULL;  caps.flags &= ~RR_CAP_SHM;
+			}
+		}
+	}
+
+	ENDIANIZE_CAPS(caps);
+	send((char *)&caps, sizeof_rrcaps);
+	ENDIANIZE_CAPS(caps);
+
+	if(caps.flags & RR_CAP_STREAMS) negotiateStreams();
+}
+
+
+// See the description of rrstreams in rr.h
+
+void VGLTransReceiver::Listener::negotiateStreams(void)
+{
+	rrstreams streamInfo;  char *env = NULL;
+	bool verbose = ((env = getenv("VGL_VERBOSE")) != NULL && strlen(env) > 0
+		&& !strncmp(env, "1", 1));
+
+	recv((char *)&streamInfo, sizeof_rrstreams);
+	ENDIANIZE_STREAMS(streamInfo);
+
+	if(streamInfo.index != 0)
+	{
+		// This is an additional connection, so attach it to the session that it
+		// belongs to.  The socket is no longer ours once it has been attached.
+		unsigned int index = streamInfo.index;
+		Socket *s = socket;
+		{
+			CriticalSection::SafeLock l(sessionMutex);
+			for(Listener *session = sessions; session;
+				session = session->nextSession)
+			{
+				if(session->streamKey[0] == streamInfo.key[0]
+					&& session->streamKey[1] == streamInfo.key[1]
+					&& (int)index < session->maxStreams && !session->streams[index])
+				{
+					session->streams[index] = socket;
+					socket = NULL;  joined = true;
+					break;
+				}
+			}
+		}
+		if(!joined) streamInfo.index = 0;
+		ENDIANIZE_STREAMS(streamInfo);
+		s->send((char *)&streamInfo, sizeof_rrstreams);
+		if(!joined) THROW("Additional connection does not belong to a session");
+		return;
+	}
+
+	maxStreams = min(max((int)streamInfo.count, 1), RR_MAXSTREAMS);
+	streamKey[0] = streamInfo.key[0];  streamKey[1] = streamInfo.key[1];
+	{
+		CriticalSection::SafeLock l(sessionMutex);
+		nextSession = sessions;  sessions = this;
+	}
+	streamInfo.count = maxStreams;
+	ENDIANIZE_STREAMS(streamInfo);
+	send((char *)&streamInfo, sizeof_rrstreams);
+
+	// The server sends the final number of connections once it has finished
+	// opening them.
+	recv((char *)&streamInfo, sizeof_rrstreams);
+	ENDIANIZE_STREAMS(streamInfo);
+	removeSession();
+	nStreams = min(max((int)streamInfo.count, 1), maxStreams);
+	for(int i = 1; i < RR_MAXSTREAMS; i++)
+	{
+		if(i < nStreams && !streams[i])
+			THROW("Server did not open all of the additional connections");
+		if(i >= nStreams) { delete streams[i];  streams[i] = NULL; }
+	}
+	for(int i = 1; i < nStreams; i++) streamThreads[i] = new Stream(this, streams[i]);
+	if(verbose && nStreams > 1)
+		vglout.println("Receiving image data through %d connections", nStreams);
+}
+
+
+void VGLTransReceiver::Listener::removeSession(void)
+{
+	CriticalSection::SafeLock l(sessionMutex);
+	Listener **prev = &sessions;
+
+	for(Listener *session = sessions; session; session = session->nextSession)
+	{
+		if(session == this) { *prev = nextSession;  break; }
+		prev = &session->nextSession;
+	}
+	nextSession = NULL;
+}
+
+
+VGLTransReceiver::Stream::Stream(Listener *parent_, Socket *socket_) :
+	parent(parent_), socket(socket_), reader(parent_, socket_), thread(NULL),
+	deadYet(false)
+{
+	eof.wait();  resume.wait();
+	thread = new Thread(this);
+	thread->start();
+}
+
+
+VGLTransReceiver::Stream::~Stream(void)
+{
+	deadYet = true;
+	if(socket) socket->close();
+	resume.signal();
+	if(thread) { thread->stop();  delete thread;  thread = NULL; }
+}
+
+
+void VGLTransReceiver::Stream::run(void)
+{
+	ClientWin *w = NULL;
+	Frame *f = NULL;
+	rrframeheader h;
+
+	try
+	{
+		while(!deadYet)
+		{
+			if(parent->isCompact()) reader.readHeader(h);
+			else
+			{
+				socket->recv((char *)&h, sizeof_rrframeheader);
+				ENDIANIZE(h);
+			}
+			if(h.flags == RR_EOF)
+			{
+				// The Listener draws the frame once all of the streams have received
+				// the End-of-Frame marker.
+				f = NULL;
+				eof.signal();
+				resume.wait();
+				continue;
+			}
+			parent->recvTile(reader, h, NULL, w, f);
+		}
+	}
+	catch(std::exception &e)
+	{
+		if(!deadYet) error = e;
+		eof.signal();
+	}
+}
+
+
+void VGLTransReceiver::Reader::readHeader(rrframeheader &h)
+{
+	while(true)
+	{
+		unsigned char buf[RR_MAXRECORD], *rec = buf;  unsigned int len = 0;
+
+		if(batchPos < batchLen)
+		{
+			len = batch[batchPos++];
+			if(len < 1 || len > batchLen - batchPos)
+				THROW("Malformed batch received from server");
+			rec = &batch[batchPos];  batchPos += len;
+		}
+		else
+		{
+			unsigned char len8 = 0;
+			parent->recv(socket, (char *)&len8, 1);
+			if((len = len8) < 1 || len > RR_MAXRECORD)
+				THROW("Malformed header received from server");
+			parent->recv(socket, (char *)buf, len);
+		}
+
+		unsigned int n = codec.decode(rec, len, h);
+		if(n == 0) return;
+
+		// Batch record:  read the whole batch, and then read the headers and
+		// image data from it
+		if(batchPos < batchLen) THROW("Nested batch received from server");
+		if(n > RR_MAXBATCH) THROW("Batch received from server is too large");
+		if(n > batchSize)
+		{
+			unsigned char *newBatch = (unsigned char *)realloc(batch, n);
+			if(!newBatch) THROW("Memory allocation error");
+			batch = newBatch;  batchSize = n;
+		}
+		batchLen = batchPos = 0;
+		parent->recv(socket, (char *)batch, n);
+		batchLen = n;
+	}
+}
+
+
+void VGLTransReceiver::Reader::read(char *buf, int len)
+{
+	if(batchPos < batchLen)
+	{
+		if(len < 0 || (unsigned int)len > batchLen - batchPos)
+			THROW("Malformed batch received from server");
+		memcpy(buf, &batch[batchPos], len);
+		batchPos += len;
+	}
+	else parent->recv(socket, buf, len);
+}
+
+
 void VGLTransReceiver::Listener::deleteWindow(ClientWin *w)
 {
 	int i, j;
@@ -295,7 +642,8 @@ ClientWin *VGLTransReceiver::Listener::addWindow(int dpynum, Window win,
 	}
 	if(nwin >= MAXWIN) THROW("No free window IDs");
 	if(dpynum < 0 || dpynum > 65535 || win == None) THROW("Invalid argument");
-	windows[winid] = new ClientWin(dpynum, win, drawMethod, stereo);
+	windows[winid] = new ClientWin(dpynum, win, drawMethod, stereo,
+		queuePolicy, queueDepth);
 
 	if(!windows[winid]) THROW("Could not create window instance");
 	nwin++;
@@ -319,13 +667,20 @@ void VGLTransReceiver::Listener::send(char *buf, int len)
 
 
 void VGLTransReceiver::Listener::recv(char *buf, int len)
+{
+	recv(socket, buf, len);
+}
+
+
+void VGLTransReceiver::Listener::recv(Socket *s, char *buf, int len)
 {
 	try
 	{
-		if(socket) socket->recv(buf, len);
+		if(s) s->recv(buf, len);
 	}
 	catch(...)
 	{
+		if(s != socket) throw;
 		vglout.println("Error receiving data from server.  Server may have disconnected.");
 		vglout.println("   (this is normal if the application exited.)");
 		throw;
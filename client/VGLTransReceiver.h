@@ -17,6 +17,8 @@
 
 #include "Socket.h"
 #include "ClientWin.h"
+#include "ShmRing.h"
+#include "CompactHeader.h"
 #include "Log.h"
 
 
@@ -29,7 +31,8 @@ namespace client
 	{
 		public:
 
-			VGLTransReceiver(bool ipv6, int drawmethod);
+			VGLTransReceiver(bool ipv6, int drawmethod,
+				int queuePolicy = RR_QUEUEFIFO, int queueDepth = 0);
 			void listen(unsigned short port);
 			unsigned short getPort(void) { return port; }
 			virtual ~VGLTransReceiver(void);
@@ -38,7 +41,7 @@ namespace client
 
 			void run(void);
 
-			int drawMethod;
+			int drawMethod, queuePolicy, queueDepth;
 			util::Socket *listenSocket;
 			util::CriticalSection listenMutex;
 			util::Thread *thread;
@@ -46,15 +49,73 @@ namespace client
 			bool ipv6;
 			unsigned short port;
 
+		class Listener;
+
+		// Reads headers and image data from one of a session's connections,
+		// decoding compact headers and unpacking batches if RR_CAP_COMPACT was
+		// negotiated
+		class Reader
+		{
+			public:
+
+				Reader(Listener *parent_, util::Socket *socket_) : parent(parent_),
+					socket(socket_), batch(NULL), batchSize(0), batchLen(0),
+					batchPos(0)
+				{
+				}
+
+				~Reader(void) { free(batch); }
+				void readHeader(rrframeheader &h);
+				void read(char *buf, int len);
+
+				Listener *parent;
+				util::Socket *socket;
+
+			private:
+
+				common::CompactHeader codec;
+				unsigned char *batch;
+				unsigned int batchSize, batchLen, batchPos;
+		};
+
+		// Reads tiles from one of the additional connections of a multi-stream
+		// session and hands them to the session's Listener
+		class Stream : public util::Runnable
+		{
+			public:
+
+				Stream(Listener *parent, util::Socket *socket);
+				virtual ~Stream(void);
+				void run(void);
+
+				util::Event eof, resume;
+				util::Error error;
+
+			private:
+
+				Listener *parent;
+				util::Socket *socket;
+				Reader reader;
+				util::Thread *thread;
+				bool deadYet;
+		};
+
 		class Listener : public util::Runnable
 		{
 			public:
 
-				Listener(util::Socket *socket_, int drawMethod_) :
-					drawMethod(drawMethod_), nwin(0), socket(socket_), thread(NULL),
-					remoteName(NULL)
+				Listener(util::Socket *socket_, int drawMethod_, int queuePolicy_,
+					int queueDepth_) : drawMethod(drawMethod_),
+					queuePolicy(queuePolicy_), queueDepth(queueDepth_), nwin(0),
+					socket(socket_), thread(NULL), remoteName(NULL), shmRing(NULL),
+					recvTiming(false), compactHeaders(false), nStreams(1),
+					maxStreams(1), joined(false), nextSession(NULL),
+					reader(this, socket_)
 				{
 					memset(windows, 0, sizeof(ClientWin *) * MAXWIN);
+					memset(streams, 0, sizeof(util::Socket *) * RR_MAXSTREAMS);
+					memset(streamThreads, 0, sizeof(Stream *) * RR_MAXSTREAMS);
+					streamKey[0] = streamKey[1] = 0;
 					if(socket) remoteName = socket->remoteName();
 					thread = new util::Thread(this);
 					thread->start();
@@ -64,6 +125,12 @@ namespace client
 				{
 					int i;
 
+					removeSession();
+					for(i = 1; i < RR_MAXSTREAMS; i++)
+					{
+						delete streamThreads[i];  streamThreads[i] = NULL;
+						delete streams[i];  streams[i] = NULL;
+					}
 					winMutex.lock(false);
 					for(i = 0; i < nwin; i++)
 					{
@@ -71,19 +138,32 @@ namespace client
 					}
 					nwin = 0;
 					winMutex.unlock(false);
-					if(!remoteName) vglout.PRINTLN("-- Disconnecting\n");
-					else vglout.PRINTLN("-- Disconnecting %s", remoteName);
+					if(!joined)
+					{
+						if(!remoteName) vglout.PRINTLN("-- Disconnecting\n");
+						else vglout.PRINTLN("-- Disconnecting %s", remoteName);
+					}
+					delete shmRing;  shmRing = NULL;
 					delete socket;  socket = NULL;
 				}
 
 				void send(char *buf, int len);
 				void recv(char *buf, int len);
+				void recv(util::Socket *s, char *buf, int len);
+				void recvTile(Reader &r, rrframeheader &h, rrframetiming *timing,
+					ClientWin *&w, common::Frame *&f);
+				bool isCompact(void) { return compactHeaders; }
 
 			private:
 
 				void run(void);
+				void negotiateCaps(void);
+				void negotiateStreams(void);
+				void removeSession(void);
+				void waitForStreams(void);
+				void resumeStreams(void);
 
-				int drawMethod;
+				int drawMethod, queuePolicy, queueDepth;
 				ClientWin *windows[MAXWIN];
 				int nwin;
 				ClientWin *addWindow(int dpynum, Window win, bool stereo = false);
@@ -92,6 +172,25 @@ namespace client
 				util::Socket *socket;
 				util::Thread *thread;
 				const char *remoteName;
+				rrversion version;
+				common::ShmRing *shmRing;
+				bool recvTiming, compactHeaders;
+
+				// Multi-stream sessions.  The primary Listener owns the additional
+				// connections (streams[0] is unused), and drawMutex serializes the
+				// tiles that the Stream threads and the primary Listener pass to
+				// ClientWin.  A Listener whose connection has been handed to another
+				// Listener is marked as joined.
+				util::Socket *streams[RR_MAXSTREAMS];
+				Stream *streamThreads[RR_MAXSTREAMS];
+				int nStreams, maxStreams;
+				unsigned int streamKey[2];
+				bool joined;
+				util::CriticalSection drawMutex;
+				Listener *nextSession;
+				static Listener *sessions;
+				static util::CriticalSection sessionMutex;
+				Reader reader;
 		};
 	};
 }
@@ -43,6 +43,7 @@ bool deadYet;
 unsigned short port = 0;
 bool ipv6 = false;
 int drawMethod = RR_DRAWAUTO;
+int queuePolicy = RR_QUEUEFIFO, queueDepth = 0;
 Display *maindpy = NULL;
 bool detach = false, force = false, child = false;
 char *logFile = NULL;
@@ -219,7 +220,13 @@ void usage(char **argv)
 	fprintf(stderr, "-l = Redirect all output to <file>\n");
 	fprintf(stderr, "-v = Display version information\n");
 	fprintf(stderr, "-x = Use X11 drawing (default)\n");
-	fprintf(stderr, "-gl = Use OpenGL drawing\n\n");
+	fprintf(stderr, "-gl = Use OpenGL drawing\n");
+	fprintf(stderr, "-fifo = Draw every frame that is received (default)\n");
+	fprintf(stderr, "-newest = Drop frames that have been superseded by a newer frame if drawing\n");
+	fprintf(stderr, "          falls behind\n");
+	fprintf(stderr, "-queuedepth <n> = Number of frames (with -newest) or image tiles (with -fifo)\n");
+	fprintf(stderr, "                  that can be queued for drawing (2-16)\n");
+	fprintf(stderr, "                  (default: 2 with -fifo, 8 with -newest)\n\n");
 	exit(1);
 }
 
@@ -271,6 +278,14 @@ void getEnvironment(void)
 		if(!strnicmp(env, "o", 1)) drawMethod = RR_DRAWOGL;
 		else if(!strncmp(env, "x", 1)) drawMethod = RR_DRAWX11;
 	}
+	if((env = getenv("VGLCLIENT_QUEUE")) != NULL && strlen(env) > 0)
+	{
+		if(!strnicmp(env, "n", 1)) queuePolicy = RR_QUEUENEWEST;
+		else if(!strnicmp(env, "f", 1)) queuePolicy = RR_QUEUEFIFO;
+	}
+	if((env = getenv("VGLCLIENT_QUEUEDEPTH")) != NULL && strlen(env) > 0
+		&& (temp = atoi(env)) >= 2 && temp <= 16)
+		queueDepth = temp;
 	if((env = getenv("VGLCLIENT_LOG")) != NULL && strlen(env) > 0)
 	{
 		logFile = env;
@@ -326,6 +341,12 @@ int main(int argc, char *argv[])
 			}
 			else if(!stricmp(argv[i], "-x")) drawMethod = RR_DRAWX11;
 			else if(!stricmp(argv[i], "-gl")) drawMethod = RR_DRAWOGL;
+			else if(!stricmp(argv[i], "-fifo")) queuePolicy = RR_QUEUEFIFO;
+			else if(!stricmp(argv[i], "-newest")) queuePolicy = RR_QUEUENEWEST;
+			else if(!stricmp(argv[i], "-queuedepth") && i < argc - 1)
+			{
+				queueDepth = atoi(argv[++i]);
+			}
 			else if(!stricmp(argv[i], "-display") && i < argc - 1)
 			{
 				displayname = argv[++i];
@@ -378,7 +399,8 @@ int start(char *displayname)
 		if(!force) actualPort = instanceCheck(maindpy);
 		if(actualPort == 0)
 		{
-			receiver = new VGLTransReceiver(ipv6, drawMethod);
+			receiver = new VGLTransReceiver(ipv6, drawMethod, queuePolicy,
+				queueDepth);
 			if(port == 0)
 			{
 				bool success = false;  unsigned short i = RR_DEFAULTPORT;
@@ -0,0 +1,172 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "CompactHeader.h"
+#include "Error.h"
+
+using namespace util;
+using namespace common;
+
+
+#define RECFLAGS  (RR_REC_FULL | RR_REC_SAMESIZE | RR_REC_BATCH)
+
+
+static unsigned char *putVarint(unsigned char *p, unsigned int value)
+{
+	while(value >= 0x80)
+	{
+		*p++ = (unsigned char)(value | 0x80);  value >>= 7;
+	}
+	*p++ = (unsigned char)value;
+	return p;
+}
+
+
+static unsigned int getVarint(const unsigned char *&p, const unsigned char *end,
+	unsigned int max = 0xFFFFFFFF)
+{
+	unsigned int value = 0;
+
+	for(int shift = 0; ; shift += 7)
+	{
+		if(p >= end || shift > 28) THROW("Malformed compact header");
+		unsigned char c = *p++;
+		value |= (unsigned int)(c & 0x7F) << shift;
+		if(!(c & 0x80)) break;
+	}
+	if(value > max) THROW("Malformed compact header");
+	return value;
+}
+
+
+int CompactHeader::encode(const rrframeheader &h, unsigned char *buf)
+{
+	unsigned char *p = &buf[2], flags = h.flags & ~RECFLAGS;
+	bool eof = (h.flags & ~RR_SHMDATA) == RR_EOF;
+
+	// The size of an End-of-Frame marker is meaningless, so it is not sent.
+	bool full = !haveRef || h.winid != ref.winid || h.framew != ref.framew
+		|| h.frameh != ref.frameh || h.qual != ref.qual
+		|| h.subsamp != ref.subsamp || h.compress != ref.compress
+		|| h.dpynum != ref.dpynum
+		|| (eof && (h.x != 0 || h.y != 0 || h.width != h.framew
+			|| h.height != h.frameh));
+
+	if(full)
+	{
+		flags |= RR_REC_FULL;
+		p = putVarint(p, h.size);
+		p = putVarint(p, h.winid);
+		p = putVarint(p, h.framew);
+		p = putVarint(p, h.frameh);
+		p = putVarint(p, h.width);
+		p = putVarint(p, h.height);
+		p = putVarint(p, h.x);
+		p = putVarint(p, h.y);
+		p = putVarint(p, h.qual);
+		p = putVarint(p, h.subsamp);
+		p = putVarint(p, h.compress);
+		p = putVarint(p, h.dpynum);
+	}
+	else if(!eof)
+	{
+		p = putVarint(p, h.x);
+		p = putVarint(p, h.y);
+		if(h.width == ref.width && h.height == ref.height)
+			flags |= RR_REC_SAMESIZE;
+		else
+		{
+			p = putVarint(p, h.width);
+			p = putVarint(p, h.height);
+		}
+		p = putVarint(p, h.size);
+	}
+	buf[1] = flags;
+	buf[0] = (unsigned char)(p - &buf[1]);
+
+	ref = h;  haveRef = true;
+	if(eof && !full)
+	{
+		ref.x = ref.y = 0;  ref.width = h.framew;  ref.height = h.frameh;
+		ref.size = 0;
+	}
+	return (int)(p - buf);
+}
+
+
+int CompactHeader::encodeBatch(unsigned int len, unsigned char *buf)
+{
+	unsigned char *p = putVarint(&buf[2], len);
+	buf[1] = RR_REC_BATCH;
+	buf[0] = (unsigned char)(p - &buf[1]);
+	return (int)(p - buf);
+}
+
+
+unsigned int CompactHeader::decode(const unsigned char *rec, int len,
+	rrframeheader &h)
+{
+	const unsigned char *p = rec, *end = rec + len;
+	rrframeheader hdr;
+
+	if(len < 1) THROW("Malformed compact header");
+	unsigned char flags = *p++;
+
+	if(flags & RR_REC_BATCH)
+	{
+		unsigned int batchLen = getVarint(p, end);
+		if(p != end || batchLen < 1) THROW("Malformed compact header");
+		return batchLen;
+	}
+
+	if(flags & RR_REC_FULL)
+	{
+		hdr.size = getVarint(p, end);
+		hdr.winid = getVarint(p, end);
+		hdr.framew = (unsigned short)getVarint(p, end, 0xFFFF);
+		hdr.frameh = (unsigned short)getVarint(p, end, 0xFFFF);
+		hdr.width = (unsigned short)getVarint(p, end, 0xFFFF);
+		hdr.height = (unsigned short)getVarint(p, end, 0xFFFF);
+		hdr.x = (unsigned short)getVarint(p, end, 0xFFFF);
+		hdr.y = (unsigned short)getVarint(p, end, 0xFFFF);
+		hdr.qual = (unsigned char)getVarint(p, end, 0xFF);
+		hdr.subsamp = (unsigned char)getVarint(p, end, 0xFF);
+		hdr.compress = (unsigned char)getVarint(p, end, 0xFF);
+		hdr.dpynum = (unsigned short)getVarint(p, end, 0xFFFF);
+	}
+	else
+	{
+		if(!haveRef) THROW("Compact header received before full header");
+		hdr = ref;
+		if((flags & ~(RECFLAGS | RR_SHMDATA)) == RR_EOF)
+		{
+			hdr.x = hdr.y = 0;  hdr.width = hdr.framew;  hdr.height = hdr.frameh;
+			hdr.size = 0;
+		}
+		else
+		{
+			hdr.x = (unsigned short)getVarint(p, end, 0xFFFF);
+			hdr.y = (unsigned short)getVarint(p, end, 0xFFFF);
+			if(!(flags & RR_REC_SAMESIZE))
+			{
+				hdr.width = (unsigned short)getVarint(p, end, 0xFFFF);
+				hdr.height = (unsigned short)getVarint(p, end, 0xFFFF);
+			}
+			hdr.size = getVarint(p, end);
+		}
+	}
+	if(p != end) THROW("Malformed compact header");
+	hdr.flags = flags & ~RECFLAGS;
+
+	h = hdr;  ref = hdr;  haveRef = true;
+	return 0;
+}
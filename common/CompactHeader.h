@@ -0,0 +1,59 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __COMPACTHEADER_H__
+#define __COMPACTHEADER_H__
+
+#include "rr.h"
+
+
+// Maximum size (in bytes) of an encoded record, including its length prefix
+#define RR_MAXRECORD  64
+
+// Maximum size (in bytes) of the records and image data in a batch
+#define RR_MAXBATCH  (256 * 1024)
+
+
+namespace common
+{
+	// Encoder/decoder for the compact tile headers described in rr.h.  Records
+	// are encoded relative to the previous header on the same connection, so
+	// each connection needs its own instance on each end.
+
+	class CompactHeader
+	{
+		public:
+
+			CompactHeader(void) : haveRef(false) {}
+			void reset(void) { haveRef = false; }
+
+			// Encode h as a record (including its length prefix) in buf, which must
+			// be at least RR_MAXRECORD bytes in size, and return the number of
+			// bytes written
+			int encode(const rrframeheader &h, unsigned char *buf);
+
+			// Encode a batch record for len bytes of records and image data
+			static int encodeBatch(unsigned int len, unsigned char *buf);
+
+			// Decode a record (excluding its length prefix.)  If the record is a
+			// batch record, then h is unchanged, and the length of the batch is
+			// returned.  Otherwise, 0 is returned.
+			unsigned int decode(const unsigned char *rec, int len, rrframeheader &h);
+
+		private:
+
+			rrframeheader ref;
+			bool haveRef;
+	};
+}
+
+#endif  // __COMPACTHEADER_H__
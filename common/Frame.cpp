@@ -39,9 +39,11 @@ static int tjpf[PIXELFORMATS] =
 // Uncompressed frame
 
 Frame::Frame(bool primary_) : bits(NULL), rbits(NULL), pitch(0), flags(0),
-	pf(pf_get(-1)), isGL(false), isXV(false), stereo(false), primary(primary_)
+	pf(pf_get(-1)), isGL(false), isXV(false), stereo(false), timestamp(0.),
+	primary(primary_), stripes(NULL), nStripes(0), maxStripes(0), stripeHeight(0)
 {
 	memset(&hdr, 0, sizeof(rrframeheader));
+	memset(&timing, 0, sizeof(rrframetiming));
 	ready.wait();
 }
 
@@ -49,6 +51,7 @@ Frame::Frame(bool primary_) : bits(NULL), rbits(NULL), pitch(0), flags(0),
 Frame::~Frame(void)
 {
 	deInit();
+	delete [] stripes;  stripes = NULL;
 }
 
 
@@ -68,6 +71,7 @@ void Frame::init(rrframeheader &h, int pixelFormat, int flags_, bool stereo_)
 		throw(Error("Frame::init", "Invalid argument"));
 
 	flags = flags_;
+	nStripes = 0;
 	PF *newpf = pf_get(pixelFormat);
 	if(h.size == 0) h.size = h.framew * h.frameh * newpf->size;
 	checkHeader(h);
@@ -110,10 +114,58 @@ void Frame::init(unsigned char *bits_, int width, int pitch_, int height,
 	checkHeader(hdr);
 	pitch = pitch_;
 	flags = flags_;
+	nStripes = 0;
 	primary = false;
 }
 
 
+void Frame::setStripes(int nStripes_, int stripeHeight_)
+{
+	if(nStripes_ < 1 || stripeHeight_ < 1)
+	{
+		nStripes = 0;  return;
+	}
+	if(nStripes_ > maxStripes)
+	{
+		delete [] stripes;  stripes = NULL;  maxStripes = 0;
+		stripes = new Event[nStripes_];
+		maxStripes = nStripes_;
+	}
+	// Events are created in the signaled state, and a stripe may have been
+	// signaled when the frame was last used.
+	for(int i = 0; i < nStripes_; i++)
+		if(!stripes[i].isLocked()) stripes[i].wait();
+	nStripes = nStripes_;  stripeHeight = stripeHeight_;
+}
+
+
+void Frame::signalStripe(int stripe)
+{
+	if(stripe >= 0 && stripe < nStripes) stripes[stripe].signal();
+}
+
+
+void Frame::signalStripes(void)
+{
+	for(int i = 0; i < nStripes; i++) stripes[i].signal();
+}
+
+
+void Frame::waitForRows(int y, int height)
+{
+	if(nStripes < 1 || height < 1) return;
+
+	int first = max(y / stripeHeight, 0);
+	int last = min((y + height - 1) / stripeHeight, nStripes - 1);
+	// Each stripe is signaled only once per frame, but it may have more than
+	// one waiter, so every waiter passes the signal on.
+	for(int i = first; i <= last; i++)
+	{
+		stripes[i].wait();  stripes[i].signal();
+	}
+}
+
+
 Frame *Frame::getTile(int x, int y, int width, int height)
 {
 	Frame *f;
@@ -155,6 +207,7 @@ bool Frame::tileEquals(Frame *last, int x, int y, int width, int height)
 		&& hdr.framew == last->hdr.framew && hdr.frameh == last->hdr.frameh
 		&& hdr.qual == last->hdr.qual && hdr.subsamp == last->hdr.subsamp
 		&& pf->id == last->pf->id && pf->size == last->pf->size
+		&& (flags & FRAME_BOTTOMUP) == (last->flags & FRAME_BOTTOMUP)
 		&& hdr.winid == last->hdr.winid && hdr.dpynum == last->hdr.dpynum)
 	{
 		if(bits && last->bits)
@@ -300,6 +353,89 @@ void Frame::decompressRGB(Frame &f, int width, int height, bool rightEye)
 }
 
 
+void Frame::decompressLossless(Frame &f, unsigned int size, int width,
+	int height, bool rightEye)
+{
+	unsigned char pixels[RR_MAXPALETTE][4];
+	unsigned char *srcptr = rightEye ? f.rbits : f.bits;
+
+	if(!srcptr || size < 1 || !bits || !hdr.size)
+		THROW("Frame not initialized");
+	if(pf->bpc < 8 || pf->size < 3)
+		throw(Error("Lossless decompressor",
+			"Destination frame has the wrong pixel format"));
+
+	unsigned char *srcend = &srcptr[size];
+	int nColors = (int)(*srcptr++) + 1;
+	if(srcend - srcptr < nColors * 3)
+		throw(Error("Lossless decompressor", "Truncated palette"));
+	for(int i = 0; i < nColors; i++, srcptr += 3)
+	{
+		int r = srcptr[0], g = srcptr[1], b = srcptr[2];
+		if(pf->bpc == 10)
+		{
+			r = (r << 2) | (r >> 6);  g = (g << 2) | (g >> 6);
+			b = (b << 2) | (b >> 6);
+		}
+		pf->setRGB(pixels[i], r, g, b);
+	}
+
+	// The runs are in top-down order and cover the whole tile, but only the
+	// pixels that fall within width x height are stored.
+	bool dstbu = (flags & FRAME_BOTTOMUP);
+	int dstStride = dstbu ? -pitch : pitch;
+	int startLine = dstbu ? max(0, hdr.frameh - f.hdr.y - height) + height - 1 :
+		f.hdr.y;
+	unsigned char *dstRow = rightEye ?
+		&rbits[pitch * startLine + f.hdr.x * pf->size] :
+		&bits[pitch * startLine + f.hdr.x * pf->size];
+	unsigned char *dstptr = dstRow;
+	int x = 0, y = 0, pixelSize = pf->size;
+	unsigned int remaining = f.hdr.width * f.hdr.height;
+
+	while(remaining > 0)
+	{
+		if(srcptr >= srcend)
+			throw(Error("Lossless decompressor", "Truncated image data"));
+		int index = *srcptr++;
+		unsigned int runLength = 0;
+		for(int shift = 0; ; shift += 7)
+		{
+			if(srcptr >= srcend || shift > 28)
+				throw(Error("Lossless decompressor", "Corrupt run length"));
+			runLength |= (unsigned int)(*srcptr & 0x7F) << shift;
+			if(!(*srcptr++ & 0x80)) break;
+		}
+		if(index >= nColors || runLength >= remaining)
+			throw(Error("Lossless decompressor", "Corrupt image data"));
+		runLength++;
+		remaining -= runLength;
+
+		unsigned char *pixel = pixels[index];
+		while(runLength > 0)
+		{
+			if(y < height)
+			{
+				int n = min((int)runLength, f.hdr.width - x);
+				int stored = min(n, max(0, width - x));
+				for(int i = 0; i < stored; i++, dstptr += pixelSize)
+					memcpy(dstptr, pixel, pixelSize);
+				x += n;  runLength -= n;
+			}
+			else
+			{
+				x += runLength;  runLength = 0;
+			}
+			if(x >= f.hdr.width)
+			{
+				x = 0;  y++;
+				if(y < height) { dstRow += dstStride;  dstptr = dstRow; }
+			}
+		}
+	}
+}
+
+
 #define DRAWLOGO() \
 	switch(pf->size) \
 	{ \
@@ -401,7 +537,8 @@ void Frame::checkHeader(rrframeheader &h)
 
 // Compressed frame
 
-CompressedFrame::CompressedFrame(void) : Frame(), tjhnd(NULL)
+CompressedFrame::CompressedFrame(void) : Frame(), tjhnd(NULL),
+	yuvEncoder(NULL)
 {
 	if(!(tjhnd = tjInitCompress())) THROW(tjGetErrorStr());
 	pf = pf_get(PF_RGB);
@@ -441,8 +578,12 @@ void CompressedFrame::compressYUV(Frame &f)
 
 	init(f.hdr, 0);
 	if(f.flags & FRAME_BOTTOMUP) tjflags |= TJ_BOTTOMUP;
-	TRY_TJ(tjEncodeYUV2(tjhnd, f.bits, f.hdr.width, f.pitch, f.hdr.height,
-		tjpf[f.pf->id], bits, TJSUBSAMP(f.hdr.subsamp), tjflags));
+	if(yuvEncoder)
+		yuvEncoder->encode(f.bits, f.hdr.width, f.pitch, f.hdr.height,
+			tjpf[f.pf->id], bits, TJSUBSAMP(f.hdr.subsamp), tjflags);
+	else
+		TRY_TJ(tjEncodeYUV2(tjhnd, f.bits, f.hdr.width, f.pitch, f.hdr.height,
+			tjpf[f.pf->id], bits, TJSUBSAMP(f.hdr.subsamp), tjflags));
 	hdr.size = (unsigned int)tjBufSizeYUV(f.hdr.width, f.hdr.height,
 		TJSUBSAMP(f.hdr.subsamp));
 }
@@ -508,6 +649,102 @@ void CompressedFrame::compressRGB(Frame &f)
 }
 
 
+// Lossless palette/RLE encoder (see RRCOMP_LOSSLESS in rr.h.)  This also
+// serves as the classifier that decides whether a tile is better suited to
+// lossless compression or to JPEG, so it gives up as soon as the tile is
+// found to contain too many colors or to need too many runs.  Photographic
+// tiles usually exceed the palette limit within the first few rows.
+
+#define HASHBITS  10
+
+static INLINE unsigned char *putRun(unsigned char *ptr, int index,
+	unsigned int runLength)
+{
+	*ptr++ = (unsigned char)index;
+	runLength--;
+	while(runLength >= 0x80)
+	{
+		*ptr++ = (unsigned char)(runLength | 0x80);  runLength >>= 7;
+	}
+	*ptr++ = (unsigned char)runLength;
+	return ptr;
+}
+
+
+unsigned int CompressedFrame::encodeLossless(Frame &f, unsigned char *srcBits,
+	unsigned char *dstBits, unsigned int maxSize)
+{
+	unsigned int keys[1 << HASHBITS];  short indices[1 << HASHBITS];
+	bool bu = (f.flags & FRAME_BOTTOMUP);
+	int srcStride = bu ? -f.pitch : f.pitch, nColors = 0, index = 0;
+	unsigned char *srcRow = bu ? &srcBits[f.pitch * (f.hdr.height - 1)] : srcBits;
+	// The runs are written after the largest possible palette and then moved
+	// down once the palette size is known.  init() allocates enough space for
+	// this, since tjBufSize() always exceeds (width * height + 2048) bytes.
+	unsigned char *palette = &dstBits[1],
+		*runs = &dstBits[1 + RR_MAXPALETTE * 3], *runptr = runs;
+	unsigned int color, lastColor = 0, runLength = 0;
+
+	memset(indices, 0xFF, sizeof(indices));
+	for(int j = 0; j < f.hdr.height; j++, srcRow += srcStride)
+	{
+		unsigned char *pixel = srcRow;
+		for(int i = 0; i < f.hdr.width; i++, pixel += f.pf->size)
+		{
+			color = ((unsigned int)pixel[f.pf->rindex] << 16) |
+				((unsigned int)pixel[f.pf->gindex] << 8) | pixel[f.pf->bindex];
+			if(runLength && color == lastColor) { runLength++;  continue; }
+			if(runLength)
+			{
+				runptr = putRun(runptr, index, runLength);
+				if((unsigned int)(runptr - runs) > maxSize) return 0;
+			}
+
+			unsigned int slot = (color * 2654435761U) >> (32 - HASHBITS);
+			while(indices[slot] >= 0 && keys[slot] != color)
+				slot = (slot + 1) & ((1 << HASHBITS) - 1);
+			if(indices[slot] < 0)
+			{
+				if(nColors >= RR_MAXPALETTE) return 0;
+				keys[slot] = color;  indices[slot] = nColors;
+				palette[nColors * 3] = (unsigned char)(color >> 16);
+				palette[nColors * 3 + 1] = (unsigned char)(color >> 8);
+				palette[nColors * 3 + 2] = (unsigned char)color;
+				nColors++;
+			}
+			index = indices[slot];  lastColor = color;  runLength = 1;
+		}
+	}
+	if(runLength) runptr = putRun(runptr, index, runLength);
+
+	unsigned int runBytes = (unsigned int)(runptr - runs);
+	if(nColors < 1 || 1 + nColors * 3 + runBytes > maxSize) return 0;
+	dstBits[0] = (unsigned char)(nColors - 1);
+	memmove(&palette[nColors * 3], runs, runBytes);
+	return 1 + nColors * 3 + runBytes;
+}
+
+
+bool CompressedFrame::compressLossless(Frame &f, unsigned int maxSize)
+{
+	if(f.pf->bpc != 8 || f.pf->size < 3) return false;
+
+	rrframeheader h = f.hdr;
+	h.compress = RRCOMP_LOSSLESS;
+	init(h, f.stereo ? RR_LEFT : 0);
+	if((hdr.size = encodeLossless(f, f.bits, bits, maxSize)) == 0)
+		return false;
+	if(f.stereo && f.rbits)
+	{
+		init(h, RR_RIGHT);
+		if(rbits
+			&& (rhdr.size = encodeLossless(f, f.rbits, rbits, maxSize)) == 0)
+			return false;
+	}
+	return true;
+}
+
+
 void CompressedFrame::init(rrframeheader &h, int buffer)
 {
 	checkHeader(h);
@@ -646,6 +883,8 @@ FBXFrame &FBXFrame::operator= (CompressedFrame &cf)
 		&& cf.hdr.height <= height)
 	{
 		if(cf.hdr.compress == RRCOMP_RGB) decompressRGB(cf, width, height, false);
+		else if(cf.hdr.compress == RRCOMP_LOSSLESS)
+			decompressLossless(cf, cf.hdr.size, width, height, false);
 		else
 		{
 			if(pf->bpc != 8)
@@ -696,7 +935,7 @@ XVFrame::XVFrame(char *dpystring, Window win_) : Frame()
 
 void XVFrame::init(char *dpystring, Window win_)
 {
-	tjhnd = NULL;  isXV = true;
+	tjhnd = NULL;  yuvEncoder = NULL;  isXV = true;
 	memset(&fb, 0, sizeof(fbxv_struct));
 
 	if(!dpystring || !win_) throw(Error("XVFrame::init", "Invalid argument"));
@@ -726,13 +965,19 @@ XVFrame &XVFrame::operator= (Frame &f)
 	int tjflags = 0;
 	init(f.hdr);
 	if(f.flags & FRAME_BOTTOMUP) tjflags |= TJ_BOTTOMUP;
-	if(!tjhnd)
+	if(yuvEncoder)
+		yuvEncoder->encode(f.bits, f.hdr.width, f.pitch, f.hdr.height,
+			tjpf[f.pf->id], bits, TJ_420, tjflags);
+	else
 	{
-		if((tjhnd = tjInitCompress()) == NULL)
-			throw(Error("XVFrame::compressor", tjGetErrorStr()));
+		if(!tjhnd)
+		{
+			if((tjhnd = tjInitCompress()) == NULL)
+				throw(Error("XVFrame::compressor", tjGetErrorStr()));
+		}
+		TRY_TJ(tjEncodeYUV2(tjhnd, f.bits, f.hdr.width, f.pitch, f.hdr.height,
+			tjpf[f.pf->id], bits, TJ_420, tjflags));
 	}
-	TRY_TJ(tjEncodeYUV2(tjhnd, f.bits, f.hdr.width, f.pitch, f.hdr.height,
-		tjpf[f.pf->id], bits, TJ_420, tjflags));
 	hdr.size = (unsigned int)tjBufSizeYUV(f.hdr.width, f.hdr.height, TJ_420);
 	if(hdr.size != (unsigned long)fb.xvi->data_size)
 		THROW("Image size mismatch in YUV encoder");
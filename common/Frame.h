@@ -23,6 +23,7 @@
 #include "fbxv.h"
 #endif
 #include "pf.h"
+#include "YUVEncoder.h"
 
 
 // Flags
@@ -54,8 +55,20 @@ namespace common
 			void waitUntilComplete(void) { complete.wait(); }
 			bool isComplete(void) { return !complete.isLocked(); }
 			void decompressRGB(Frame &f, int width, int height, bool rightEye);
+			void decompressLossless(Frame &f, unsigned int size, int width,
+				int height, bool rightEye);
 			void addLogo(void);
 
+			// A striped frame can be passed to an image transport before its pixels
+			// have been read back.  The pixels arrive in horizontal stripes, from
+			// the top of the frame to the bottom, and waitForRows() blocks until the
+			// stripes that contain the specified rows (in top-down order) have been
+			// signaled.  Initializing the frame makes it unstriped again.
+			void setStripes(int nStripes, int stripeHeight);
+			void signalStripe(int stripe);
+			void signalStripes(void);
+			void waitForRows(int y, int height);
+
 			rrframeheader hdr;
 			unsigned char *bits;
 			unsigned char *rbits;
@@ -63,6 +76,12 @@ namespace common
 			PF *pf;
 			bool isGL, isXV, stereo;
 
+			// On the server, the time at which the application triggered the frame.
+			// On the client, the time at which the End-of-Frame marker was received,
+			// along with the timing information that the server sent with it.
+			double timestamp;
+			rrframetiming timing;
+
 		protected:
 
 			void dumpHeader(rrframeheader &);
@@ -72,6 +91,11 @@ namespace common
 			util::Event complete;
 			friend class CompressedFrame;
 			bool primary;
+
+		private:
+
+			util::Event *stripes;
+			int nStripes, maxStripes, stripeHeight;
 	};
 }
 
@@ -90,13 +114,25 @@ namespace common
 			void compressYUV(Frame &f);
 			void compressJPEG(Frame &f);
 			void compressRGB(Frame &f);
+			// Compress the frame using RRCOMP_LOSSLESS if it contains no more than
+			// RR_MAXPALETTE colors and the result is no larger than maxSize bytes
+			// per eye.  Returns false (leaving this frame in an undefined state) if
+			// the frame is not suitable for lossless compression.
+			bool compressLossless(Frame &f, unsigned int maxSize);
 			void init(rrframeheader &h, int buffer);
+			// Use the specified multithreaded encoder (which is not owned by this
+			// instance) for YUV encoding
+			void setYUVEncoder(YUVEncoder *encoder) { yuvEncoder = encoder; }
 
 			rrframeheader rhdr;
 
 		private:
 
+			unsigned int encodeLossless(Frame &f, unsigned char *srcBits,
+				unsigned char *dstBits, unsigned int maxSize);
+
 			tjhandle tjhnd;
+			YUVEncoder *yuvEncoder;
 			friend class FBXFrame;
 	};
 }
@@ -148,12 +184,16 @@ namespace common
 			XVFrame &operator= (Frame &f);
 			void init(rrframeheader &h);
 			void redraw(void);
+			// Use the specified multithreaded encoder (which is not owned by this
+			// instance) for YUV encoding
+			void setYUVEncoder(YUVEncoder *encoder) { yuvEncoder = encoder; }
 
 		private:
 
 			fbxv_struct fb;
 			Display *dpy;  Window win;
 			tjhandle tjhnd;
+			YUVEncoder *yuvEncoder;
 			static util::CriticalSection mutex;
 	};
 }
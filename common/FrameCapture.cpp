@@ -0,0 +1,272 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "FrameCapture.h"
+#include "Error.h"
+#include "vglutil.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+using namespace util;
+using namespace common;
+
+
+#define PAD8(v)  (((v) + 7) & (~7ULL))
+
+
+CaptureWriter::CaptureWriter(const char *fileName) : file(NULL), index(NULL),
+	count(0), maxCount(0), pos(CAPTURE_HEADERSIZE), finalized(false)
+{
+	if(!fileName || !fileName[0]) THROW("Invalid argument");
+	if((file = fopen(fileName, "wb")) == NULL) THROW_UNIX();
+	try
+	{
+		writeHeader(0, 0);
+	}
+	catch(...)
+	{
+		fclose(file);  file = NULL;
+		throw;
+	}
+	timer.start();
+}
+
+
+CaptureWriter::~CaptureWriter(void)
+{
+	if(file)
+	{
+		try
+		{
+			finalize();
+		}
+		catch(...) {}
+		fclose(file);  file = NULL;
+	}
+	free(index);  index = NULL;
+}
+
+
+void CaptureWriter::writeFrame(Frame &f)
+{
+	CaptureRecord rec;
+	unsigned int size = f.pitch * f.hdr.frameh;
+
+	if(!f.bits || !f.pitch) THROW("Frame not initialized");
+	memset(&rec, 0, sizeof(CaptureRecord));
+	rec.type = CAPTURE_FRAME;
+	rec.pitch = f.pitch;
+	rec.pixelFormat = f.pf->id;
+	rec.flags = f.flags;
+	rec.stereo = (f.stereo && f.rbits) ? 1 : 0;
+	rec.hdr = f.hdr;
+	rec.hdr.size = 0;
+	writeRecord(rec, f.bits, size, rec.stereo ? f.rbits : NULL,
+		rec.stereo ? size : 0);
+}
+
+
+void CaptureWriter::writeTile(rrframeheader &h, const unsigned char *bits)
+{
+	CaptureRecord rec;
+
+	memset(&rec, 0, sizeof(CaptureRecord));
+	rec.type = CAPTURE_TILE;
+	rec.hdr = h;
+	if(h.flags == RR_EOF) bits = NULL;
+	if(!bits) rec.hdr.size = 0;
+	writeRecord(rec, bits, rec.hdr.size, NULL, 0);
+}
+
+
+void CaptureWriter::writeRecord(CaptureRecord &rec,
+	const unsigned char *data1, unsigned int size1, const unsigned char *data2,
+	unsigned int size2)
+{
+	static const unsigned char zero[CAPTURE_RECHEADERSIZE] = { 0 };
+	unsigned char recHeader[CAPTURE_RECHEADERSIZE];
+
+	CriticalSection::SafeLock l(mutex);
+
+	if(!file) THROW("Capture file is not open");
+	if(finalized)
+	{
+		// Overwrite the index that finalize() wrote.
+		writeHeader(0, 0);
+		finalized = false;
+	}
+	if(count >= maxCount)
+	{
+		unsigned int newMax = maxCount ? maxCount * 2 : 1024;
+		unsigned long long *newIndex = (unsigned long long *)realloc(index,
+			sizeof(unsigned long long) * newMax);
+		if(!newIndex) THROW("Memory allocation error");
+		index = newIndex;  maxCount = newMax;
+	}
+
+	rec.size = size1 + size2;
+	rec.time = timer.elapsed();
+	memset(recHeader, 0, CAPTURE_RECHEADERSIZE);
+	memcpy(recHeader, &rec, sizeof(CaptureRecord));
+
+	if(fseeko(file, (off_t)pos, SEEK_SET) != 0) THROW_UNIX();
+	writeData(recHeader, CAPTURE_RECHEADERSIZE);
+	if(size1) writeData(data1, size1);
+	if(size2) writeData(data2, size2);
+	unsigned long long padding = PAD8(rec.size) - rec.size;
+	if(padding) writeData(zero, (size_t)padding);
+
+	index[count++] = pos;
+	pos += CAPTURE_RECHEADERSIZE + PAD8(rec.size);
+}
+
+
+void CaptureWriter::finalize(void)
+{
+	CriticalSection::SafeLock l(mutex);
+
+	if(!file || finalized) return;
+	if(fseeko(file, (off_t)pos, SEEK_SET) != 0) THROW_UNIX();
+	if(count) writeData(index, sizeof(unsigned long long) * count);
+	writeHeader(count, pos);
+	fflush(file);
+	finalized = true;
+}
+
+
+void CaptureWriter::writeHeader(unsigned int count_,
+	unsigned long long indexOffset)
+{
+	unsigned char buf[CAPTURE_HEADERSIZE];
+	CaptureFileHeader fh;
+
+	memset(&fh, 0, sizeof(CaptureFileHeader));
+	memcpy(fh.magic, CAPTURE_MAGIC, 4);
+	fh.version = CAPTURE_VERSION;
+	fh.byteOrder = CAPTURE_BYTEORDER;
+	fh.count = count_;
+	fh.indexOffset = indexOffset;
+	memset(buf, 0, CAPTURE_HEADERSIZE);
+	memcpy(buf, &fh, sizeof(CaptureFileHeader));
+	if(fseeko(file, 0, SEEK_SET) != 0) THROW_UNIX();
+	writeData(buf, CAPTURE_HEADERSIZE);
+}
+
+
+void CaptureWriter::writeData(const void *buf, size_t size)
+{
+	if(fwrite(buf, size, 1, file) != 1) THROW_UNIX();
+}
+
+
+CaptureReader::CaptureReader(const char *fileName) : fd(-1), map(NULL),
+	mapSize(0), index(NULL), scannedIndex(NULL), count(0)
+{
+	struct stat sb;
+
+	if(!fileName || !fileName[0]) THROW("Invalid argument");
+	TRY_UNIX(fd = open(fileName, O_RDONLY));
+	try
+	{
+		TRY_UNIX(fstat(fd, &sb));
+		if(sb.st_size < CAPTURE_HEADERSIZE) THROW("Not a VirtualGL capture file");
+		mapSize = (size_t)sb.st_size;
+		if((map = (unsigned char *)mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd,
+			0)) == MAP_FAILED)
+		{
+			map = NULL;  THROW_UNIX();
+		}
+
+		CaptureFileHeader *fh = (CaptureFileHeader *)map;
+		if(memcmp(fh->magic, CAPTURE_MAGIC, 4))
+			THROW("Not a VirtualGL capture file");
+		if(fh->byteOrder != CAPTURE_BYTEORDER)
+			THROW("Capture file was created on a machine with a different byte order");
+		if(fh->version != CAPTURE_VERSION)
+			THROW("Unsupported capture file version");
+
+		if(fh->indexOffset >= CAPTURE_HEADERSIZE
+			&& fh->indexOffset % 8 == 0 && fh->indexOffset <= mapSize
+			&& (mapSize - fh->indexOffset) / sizeof(unsigned long long) >=
+				fh->count)
+		{
+			index = (const unsigned long long *)&map[fh->indexOffset];
+			count = fh->count;
+		}
+		else
+		{
+			// The capture was not finalized, so scan it.  A partially written
+			// record at the end of the file is ignored.
+			unsigned int maxCount = 0;
+			unsigned long long pos = CAPTURE_HEADERSIZE;
+			while(pos + CAPTURE_RECHEADERSIZE <= mapSize)
+			{
+				CaptureRecord *rec = (CaptureRecord *)&map[pos];
+				if((rec->type != CAPTURE_FRAME && rec->type != CAPTURE_TILE)
+					|| rec->size > mapSize - pos - CAPTURE_RECHEADERSIZE)
+					break;
+				if(count >= maxCount)
+				{
+					maxCount = maxCount ? maxCount * 2 : 1024;
+					unsigned long long *newIndex =
+						(unsigned long long *)realloc(scannedIndex,
+							sizeof(unsigned long long) * maxCount);
+					if(!newIndex) THROW("Memory allocation error");
+					scannedIndex = newIndex;
+				}
+				scannedIndex[count++] = pos;
+				pos += CAPTURE_RECHEADERSIZE + PAD8(rec->size);
+			}
+			index = scannedIndex;
+		}
+	}
+	catch(...)
+	{
+		if(map) munmap(map, mapSize);
+		map = NULL;
+		free(scannedIndex);  scannedIndex = NULL;
+		close(fd);  fd = -1;
+		throw;
+	}
+}
+
+
+CaptureReader::~CaptureReader(void)
+{
+	if(map) { munmap(map, mapSize);  map = NULL; }
+	if(fd >= 0) { close(fd);  fd = -1; }
+	free(scannedIndex);  scannedIndex = NULL;
+}
+
+
+const CaptureRecord *CaptureReader::getRecord(unsigned int i)
+{
+	if(i >= count) THROW("Argument out of range");
+	if(index[i] < CAPTURE_HEADERSIZE || index[i] % 8 != 0
+		|| index[i] > mapSize - CAPTURE_RECHEADERSIZE)
+		THROW("Corrupt capture file index");
+	CaptureRecord *rec = (CaptureRecord *)&map[index[i]];
+	if(rec->size > mapSize - index[i] - CAPTURE_RECHEADERSIZE)
+		THROW("Corrupt capture file record");
+	return rec;
+}
+
+
+const unsigned char *CaptureReader::getData(unsigned int i)
+{
+	getRecord(i);
+	return &map[index[i] + CAPTURE_RECHEADERSIZE];
+}
@@ -0,0 +1,131 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __FRAMECAPTURE_H__
+#define __FRAMECAPTURE_H__
+
+#include <stdio.h>
+#include "rr.h"
+#include "Frame.h"
+#include "Mutex.h"
+#include "Timer.h"
+
+
+// A capture file consists of a fixed-size file header, followed by a sequence
+// of records, followed by an index containing the file offset of each record.
+// Each record consists of a fixed-size record header followed by the record
+// data, padded to a multiple of 8 bytes, so the file can be memory-mapped and
+// the records accessed in place.  The index is written when the capture is
+// finalized.  If the process that created the capture exited without
+// finalizing it, then the reader rebuilds the index by scanning the records.
+// All values are stored in the byte order of the machine that created the
+// capture.
+
+#define CAPTURE_MAGIC  "VGLC"
+#define CAPTURE_VERSION  1
+#define CAPTURE_BYTEORDER  0x01020304
+#define CAPTURE_HEADERSIZE  64
+#define CAPTURE_RECHEADERSIZE  64
+
+// Record types
+enum
+{
+	CAPTURE_FRAME = 1,  // Uncompressed frame, as passed to the image transport
+	CAPTURE_TILE        // Compressed tile (or end-of-frame marker), as sent to
+	                    // the client
+};
+
+
+namespace common
+{
+	typedef struct
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int byteOrder;
+		unsigned int count;             // Number of entries in the index
+		unsigned long long indexOffset;  // 0 if the capture was not finalized
+	} CaptureFileHeader;
+
+	typedef struct
+	{
+		unsigned int type;   // CAPTURE_FRAME or CAPTURE_TILE
+		unsigned int size;   // Size of the record data (in bytes)
+		double time;         // Seconds since the capture was started
+		unsigned int pitch;  // Bytes per row (CAPTURE_FRAME only)
+		unsigned char pixelFormat, flags, stereo, reserved;  // (CAPTURE_FRAME
+		                                                     // only)
+		rrframeheader hdr;
+	} CaptureRecord;
+
+
+	// Writes frames and/or tiles to a capture file.  Multiple image transport
+	// instances can share a writer.
+
+	class CaptureWriter
+	{
+		public:
+
+			CaptureWriter(const char *fileName);
+			~CaptureWriter(void);
+
+			// Record an uncompressed frame (including the right eye buffer, if the
+			// frame is stereo)
+			void writeFrame(Frame &f);
+
+			// Record a compressed tile or an end-of-frame marker (bits can be NULL
+			// if h.flags == RR_EOF)
+			void writeTile(rrframeheader &h, const unsigned char *bits);
+
+			// Write the index and update the file header, so that the capture can be
+			// read without scanning it.  Records written subsequently overwrite the
+			// index, and the capture must be finalized again.
+			void finalize(void);
+
+		private:
+
+			void writeRecord(CaptureRecord &rec, const unsigned char *data1,
+				unsigned int size1, const unsigned char *data2, unsigned int size2);
+			void writeHeader(unsigned int count, unsigned long long indexOffset);
+			void writeData(const void *buf, size_t size);
+
+			FILE *file;
+			util::CriticalSection mutex;
+			util::Timer timer;
+			unsigned long long *index;  unsigned int count, maxCount;
+			unsigned long long pos;  bool finalized;
+	};
+
+
+	// Memory-maps a capture file and provides random access to its records
+
+	class CaptureReader
+	{
+		public:
+
+			CaptureReader(const char *fileName);
+			~CaptureReader(void);
+
+			unsigned int getCount(void) { return count; }
+			const CaptureRecord *getRecord(unsigned int i);
+			const unsigned char *getData(unsigned int i);
+
+		private:
+
+			int fd;
+			unsigned char *map;  size_t mapSize;
+			const unsigned long long *index;  unsigned long long *scannedIndex;
+			unsigned int count;
+	};
+}
+
+#endif  // __FRAMECAPTURE_H__
@@ -19,15 +19,14 @@
 #ifdef _MSC_VER
 #define strdup  _strdup
 #endif
-#include "Timer.h"
 #include "Log.h"
 
 using namespace common;
 
 
 Profiler::Profiler(const char *name_, double interval_) : interval(interval_),
-	mbytes(0.0), mpixels(0.0), totalTime(0.0), start(0.0), frames(0),
-	lastFrame(0.0)
+	mbytes(0.0), mpixels(0.0), totalTime(0.0), frames(0), start(0),
+	lastFrame(0)
 {
 	profile = false;  char *ev = NULL;
 	setName(name_);  freestr = false;
@@ -62,23 +61,24 @@ void Profiler::setName(const char *name_)
 void Profiler::startFrame(void)
 {
 	if(!profile) return;
-	start = timer.time();
+	start = GetTimeNS();
 }
 
 
 void Profiler::endFrame(long pixels, long bytes, double incFrames)
 {
 	if(!profile) return;
-	double now = timer.time();
-	if(start != 0.0)
+	unsigned long long now = GetTimeNS();
+	if(start != 0)
 	{
-		totalTime += now - start;
+		totalTime += (double)(now - start) * 0.000000001;
 		if(pixels) mpixels += (double)pixels / 1000000.;
 		if(bytes) mbytes += (double)bytes / 1000000.;
 		if(incFrames != 0.0) frames += incFrames;
 	}
-	if(lastFrame == 0.0) lastFrame = now;
-	if(totalTime > interval || (now - lastFrame) > interval)
+	if(lastFrame == 0) lastFrame = now;
+	if(totalTime > interval
+		|| (double)(now - lastFrame) * 0.000000001 > interval)
 	{
 		char temps[256];  size_t i = 0;
 		snprintf(&temps[i], 255 - i, "%s  ", name);  i = strlen(temps);
@@ -15,7 +15,7 @@
 #ifndef __PROFILER_H__
 #define __PROFILER_H__
 
-#include "Timer.h"
+#include "vglutil.h"
 
 
 namespace common
@@ -35,9 +35,9 @@ namespace common
 
 			char *name;
 			double interval;
-			double mbytes, mpixels, totalTime, start, frames, lastFrame;
+			double mbytes, mpixels, totalTime, frames;
+			unsigned long long start, lastFrame;
 			bool profile;
-			util::Timer timer;
 			bool freestr;
 	};
 }
@@ -0,0 +1,154 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "ShmRing.h"
+#include "Error.h"
+#include "vglutil.h"
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#ifdef __linux__
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <time.h>
+#endif
+
+using namespace util;
+using namespace common;
+
+
+#define SHMRING_MAGIC  0x53474C56  // "VGLS"
+
+
+ShmRing::ShmRing(unsigned int size) : shmid(-1), owner(true), hdr(NULL),
+	data(NULL), produced(0)
+{
+	if(size < 1 || !IS_POW2(size)) THROW("Invalid argument");
+
+	TRY_UNIX(shmid = shmget(IPC_PRIVATE, HEADERSIZE + size, IPC_CREAT | 0600));
+	if((hdr = (Header *)shmat(shmid, 0, 0)) == (Header *)-1)
+	{
+		shmctl(shmid, IPC_RMID, 0);
+		THROW_UNIX();
+	}
+	data = (char *)hdr + HEADERSIZE;
+
+	// The key is what proves to the server that the client attached the correct
+	// segment, so make it hard to guess.
+	GetRandomBytes(hdr->key, sizeof(hdr->key));
+	hdr->size = size;
+	hdr->consumed = 0;
+	hdr->magic = SHMRING_MAGIC;
+}
+
+
+ShmRing::ShmRing(int shmid_, const unsigned int key[2]) : shmid(shmid_),
+	owner(false), hdr(NULL), data(NULL), produced(0)
+{
+	struct shmid_ds info;
+
+	TRY_UNIX(shmctl(shmid, IPC_STAT, &info));
+	if(info.shm_segsz < (size_t)HEADERSIZE)
+		THROW("Shared memory segment is too small");
+	if((hdr = (Header *)shmat(shmid, 0, 0)) == (Header *)-1)
+	{
+		hdr = NULL;  THROW_UNIX();
+	}
+	if(hdr->magic != SHMRING_MAGIC || hdr->key[0] != key[0]
+		|| hdr->key[1] != key[1]
+		|| info.shm_segsz < (size_t)HEADERSIZE + hdr->size)
+	{
+		shmdt((char *)hdr);  hdr = NULL;
+		THROW("Shared memory key mismatch");
+	}
+	data = (char *)hdr + HEADERSIZE;
+}
+
+
+ShmRing::~ShmRing(void)
+{
+	if(hdr) { shmdt((char *)hdr);  hdr = NULL; }
+	if(owner) remove();
+}
+
+
+void ShmRing::getKey(unsigned int key[2])
+{
+	key[0] = hdr->key[0];  key[1] = hdr->key[1];
+}
+
+
+void ShmRing::remove(void)
+{
+	if(shmid != -1 && owner) { shmctl(shmid, IPC_RMID, 0);  owner = false; }
+}
+
+
+bool ShmRing::write(const char *buf, unsigned int len, rrshmref &ref)
+{
+	unsigned int size = hdr->size;
+
+	// Never split a tile across the end of the ring.  If it won't fit in the
+	// remaining space, skip to the beginning.  Limiting the tile size to half
+	// of the ring guarantees that the skipped space plus the tile will always
+	// fit once the client catches up.
+	if(len > size / 2) return false;
+	unsigned int pos = produced & (size - 1);
+	unsigned int skip = (pos + len > size) ? size - pos : 0;
+	unsigned int needed = skip + len;
+
+	unsigned int consumed;
+	while(size - (produced - (consumed = hdr->consumed)) < needed)
+	{
+		wait(consumed);
+		struct shmid_ds info;
+		if(shmctl(shmid, IPC_STAT, &info) == 0 && info.shm_nattch < 2)
+			THROW("Client detached from shared memory ring");
+	}
+	__sync_synchronize();
+
+	ref.offset = skip ? 0 : pos;
+	memcpy(&data[ref.offset], buf, len);
+	produced += needed;
+	ref.end = produced;
+	return true;
+}
+
+
+void ShmRing::read(char *buf, unsigned int len, const rrshmref &ref)
+{
+	if(ref.offset > hdr->size || len > hdr->size - ref.offset)
+		THROW("Invalid shared memory reference");
+	memcpy(buf, &data[ref.offset], len);
+	__sync_synchronize();
+	hdr->consumed = ref.end;
+	wake();
+}
+
+
+void ShmRing::wait(unsigned int consumed)
+{
+	#ifdef __linux__
+	struct timespec ts = { 0, 100000000 };
+	syscall(SYS_futex, &hdr->consumed, FUTEX_WAIT, consumed, &ts, NULL, 0);
+	#else
+	usleep(1000);
+	#endif
+}
+
+
+void ShmRing::wake(void)
+{
+	#ifdef __linux__
+	syscall(SYS_futex, &hdr->consumed, FUTEX_WAKE, 1, NULL, NULL, 0);
+	#endif
+}
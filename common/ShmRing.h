@@ -0,0 +1,87 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __SHMRING_H__
+#define __SHMRING_H__
+
+#include "rr.h"
+
+
+// Default size (in bytes) of the image data area of a shared memory ring
+#define RR_SHMRINGSIZE  (32 * 1024 * 1024)
+
+
+namespace common
+{
+	// Single-producer/single-consumer ring buffer in a System V shared memory
+	// segment.  The VirtualGL Faker creates the ring and writes compressed or
+	// uncompressed tiles into it, and the VirtualGL Client attaches to it and
+	// reads the tiles back out in the order in which they were written.  The
+	// ordering and the location of each tile within the ring are conveyed
+	// through the existing VGL Transport socket, so the only state that the two
+	// processes share is the position up to which the client has consumed the
+	// ring.
+
+	class ShmRing
+	{
+		public:
+
+			// Create a new ring (server)
+			ShmRing(unsigned int size = RR_SHMRINGSIZE);
+
+			// Attach to an existing ring (client).  Throws an error if the segment
+			// cannot be attached or if the key does not match.
+			ShmRing(int shmid, const unsigned int key[2]);
+
+			~ShmRing(void);
+
+			int getID(void) { return shmid; }
+			void getKey(unsigned int key[2]);
+
+			// Mark the segment for destruction once both processes have detached
+			// from it.  The server calls this once the client has attached.
+			void remove(void);
+
+			// Copy len bytes from buf into the ring, waiting for the client to free
+			// up space if necessary, and return the location of the data in ref.
+			// Returns false if the data is larger than half of the ring, in which
+			// case the caller should send the data through the socket.
+			bool write(const char *buf, unsigned int len, rrshmref &ref);
+
+			// Copy len bytes at the location described by ref from the ring into
+			// buf, then release that space back to the server.
+			void read(char *buf, unsigned int len, const rrshmref &ref);
+
+		private:
+
+			void wait(unsigned int consumed);
+			void wake(void);
+
+			typedef struct
+			{
+				unsigned int magic;
+				unsigned int key[2];
+				unsigned int size;
+				volatile unsigned int consumed;
+			} Header;
+
+			static const int HEADERSIZE = 64;
+
+			int shmid;
+			bool owner;
+			Header *hdr;
+			char *data;
+			unsigned int produced;
+	};
+}
+
+#endif  // __SHMRING_H__
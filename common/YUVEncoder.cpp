@@ -0,0 +1,161 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "YUVEncoder.h"
+#include "Error.h"
+#include "vglutil.h"
+#include <string.h>
+
+using namespace util;
+using namespace common;
+
+
+// tjEncodeYUVPlanes() and tjPlaneWidth()/tjPlaneHeight() were introduced in
+// libjpeg-turbo 1.4, which is also the first version to define TJ_NUMCS.
+#ifdef TJ_NUMCS
+#define HAVE_YUVPLANES
+#endif
+
+#define PAD(v, p)  ((v + (p) - 1) & (~((p) - 1)))
+
+
+YUVEncoder::Worker::Worker(void) : tjhnd(NULL), srcBuf(NULL), width(0),
+	pitch(0), height(0), pixelFormat(0), subsamp(0), flags(0)
+{
+	if(!(tjhnd = tjInitCompress()))
+		throw(Error("YUVEncoder::Worker", tjGetErrorStr()));
+	dstPlanes[0] = dstPlanes[1] = dstPlanes[2] = NULL;
+	strides[0] = strides[1] = strides[2] = 0;
+}
+
+
+YUVEncoder::Worker::~Worker(void)
+{
+	if(tjhnd) { tjDestroy(tjhnd);  tjhnd = NULL; }
+}
+
+
+void YUVEncoder::Worker::execute(void)
+{
+	#ifdef HAVE_YUVPLANES
+	if(tjEncodeYUVPlanes(tjhnd, srcBuf, width, pitch, height, pixelFormat,
+		dstPlanes, strides, subsamp, flags) == -1)
+		throw(Error("YUV encoder", tjGetErrorStr()));
+	#else
+	if(tjEncodeYUV2(tjhnd, (unsigned char *)srcBuf, width, pitch, height,
+		pixelFormat, dstPlanes[0], subsamp, flags) == -1)
+		throw(Error("YUV encoder", tjGetErrorStr()));
+	#endif
+}
+
+
+YUVEncoder::YUVEncoder(int nStripes_, WorkerPool *pool_) :
+	nStripes(nStripes_), workers(NULL), jobs(NULL), pool(pool_)
+{
+	#ifndef HAVE_YUVPLANES
+	nStripes = 1;
+	#endif
+	if(!pool || nStripes < 1) nStripes = 1;
+
+	workers = new Worker *[nStripes];
+	jobs = new WorkerPool::Job *[nStripes];
+	for(int i = 0; i < nStripes; i++) workers[i] = NULL;
+	try
+	{
+		for(int i = 0; i < nStripes; i++) jobs[i] = workers[i] = new Worker;
+	}
+	catch(...)
+	{
+		cleanup();  throw;
+	}
+}
+
+
+YUVEncoder::~YUVEncoder(void)
+{
+	cleanup();
+}
+
+
+void YUVEncoder::cleanup(void)
+{
+	if(!workers) return;
+	for(int i = 0; i < nStripes; i++)
+	{
+		delete workers[i];  workers[i] = NULL;
+	}
+	delete [] workers;  workers = NULL;
+	delete [] jobs;  jobs = NULL;
+}
+
+
+void YUVEncoder::encode(const unsigned char *srcBuf, int width, int pitch,
+	int height, int pixelFormat, unsigned char *dstBuf, int subsamp, int flags)
+{
+	if(!srcBuf || width < 1 || pitch < 0 || height < 1 || pixelFormat < 0
+		|| !dstBuf || subsamp < 0 || subsamp >= TJ_NUMSAMP)
+		throw(Error("YUV encoder", "Invalid argument"));
+	if(pitch == 0) pitch = width * tjPixelSize[pixelFormat];
+
+	#ifdef HAVE_YUVPLANES
+
+	// Compute the layout of the planes in the same way that tjEncodeYUV2()
+	// does.
+	int nc = (subsamp == TJSAMP_GRAY ? 1 : 3), strides[3] = { 0, 0, 0 };
+	unsigned char *dstPlanes[3] = { NULL, NULL, NULL };
+	unsigned char *ptr = dstBuf;
+	for(int i = 0; i < nc; i++)
+	{
+		strides[i] = PAD(tjPlaneWidth(i, width, subsamp), 4);
+		dstPlanes[i] = ptr;
+		ptr += strides[i] * tjPlaneHeight(i, height, subsamp);
+	}
+
+	// Each stripe must start on a chroma row boundary, so its height must be a
+	// multiple of the vertical subsampling factor.
+	int mcuh = tjMCUHeight[subsamp] / 8;
+	int stripeh = (height + nStripes - 1) / nStripes;
+	stripeh = (stripeh + mcuh - 1) / mcuh * mcuh;
+	int nJobs = (height + stripeh - 1) / stripeh;
+
+	for(int i = 0; i < nJobs; i++)
+	{
+		Worker *w = workers[i];
+		int y = i * stripeh, h = min(stripeh, height - y);
+		// In a bottom-up source buffer, the top row of the stripe is the last
+		// row in memory.
+		int srcy = (flags & TJFLAG_BOTTOMUP) ? height - y - h : y;
+
+		w->srcBuf = &srcBuf[pitch * srcy];
+		w->width = width;  w->pitch = pitch;  w->height = h;
+		w->pixelFormat = pixelFormat;  w->subsamp = subsamp;  w->flags = flags;
+		for(int j = 0; j < 3; j++)
+		{
+			w->strides[j] = strides[j];
+			w->dstPlanes[j] = (j < nc) ?
+				dstPlanes[j] + strides[j] * (y / (j ? mcuh : 1)) : NULL;
+		}
+	}
+	if(nJobs > 1) pool->execute(jobs, nJobs);
+	else workers[0]->execute();
+
+	#else
+
+	Worker *w = workers[0];
+	w->srcBuf = srcBuf;
+	w->width = width;  w->pitch = pitch;  w->height = height;
+	w->pixelFormat = pixelFormat;  w->subsamp = subsamp;  w->flags = flags;
+	w->dstPlanes[0] = dstBuf;
+	w->execute();
+
+	#endif
+}
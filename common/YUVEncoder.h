@@ -0,0 +1,68 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __YUVENCODER_H__
+#define __YUVENCODER_H__
+
+#include "turbojpeg.h"
+#include "WorkerPool.h"
+
+
+namespace common
+{
+	// Multithreaded YUV encoder.  The frame is divided into horizontal stripes,
+	// and each stripe is converted by a separate job on a shared worker pool
+	// directly into the appropriate rows of the Y, U, and V planes of the
+	// destination buffer.  The output is identical to that of tjEncodeYUV2()
+	// (planar, with each plane row padded to a multiple of 4 bytes.)
+	// Multithreaded encoding requires libjpeg-turbo 1.4 or later.  With earlier
+	// versions, or if no worker pool is specified, the encoder uses only the
+	// calling thread.
+
+	class YUVEncoder
+	{
+		public:
+
+			YUVEncoder(int nStripes, util::WorkerPool *pool);
+			~YUVEncoder(void);
+			void encode(const unsigned char *srcBuf, int width, int pitch,
+				int height, int pixelFormat, unsigned char *dstBuf, int subsamp,
+				int flags);
+			int getNumStripes(void) { return nStripes; }
+
+		private:
+
+			void cleanup(void);
+
+			class Worker : public util::WorkerPool::Job
+			{
+				public:
+
+					Worker(void);
+					virtual ~Worker(void);
+					void execute(void);
+
+					tjhandle tjhnd;
+					const unsigned char *srcBuf;
+					int width, pitch, height, pixelFormat, subsamp, flags;
+					unsigned char *dstPlanes[3];
+					int strides[3];
+			};
+
+			int nStripes;
+			Worker **workers;
+			util::WorkerPool::Job **jobs;
+			util::WorkerPool *pool;
+	};
+}
+
+#endif  // __YUVENCODER_H__
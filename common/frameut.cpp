@@ -14,6 +14,7 @@
 
 #include "Thread.h"
 #include "Frame.h"
+#include "CompactHeader.h"
 #include "../client/GLFrame.h"
 #include "vglutil.h"
 #include "Timer.h"
@@ -34,7 +35,8 @@ using namespace common;
 #define NUMWIN  1
 
 bool useGL = false, useXV = false, doRgbBench = false, useRGB = false,
-	addLogo = false, anaglyph = false, check = false;
+	addLogo = false, anaglyph = false, check = false, doLosslessTest = false,
+	doCompactTest = false;
 
 
 void resizeWindow(Display *dpy, Window win, int width, int height, int myID)
@@ -537,7 +539,7 @@ int cmpFrame(unsigned char *buf, int width, int height, Frame &dst)
 	for(int i = 0; i < height; i++)
 	{
 		_i = dstbu ? i : height - i - 1;
-		for(int j = 0; j < height; j++)
+		for(int j = 0; j < width; j++)
 		{
 			int r, g, b;
 			dst.pf->getRGB(&dst.bits[dst.pitch * i + j * dst.pf->size], &r, &g, &b);
@@ -597,6 +599,295 @@ void rgbBench(char *filename)
 }
 
 
+// Generate a bottom-up RGB reference image (for cmpFrame()) along with an
+// identical source frame that contains nColors distinct colors
+void makeLosslessImage(unsigned char *buf, Frame &src, int nColors,
+	int runWidth)
+{
+	int width = src.hdr.width, height = src.hdr.height;
+	bool srcbu = (src.flags & FRAME_BOTTOMUP);
+
+	for(int y = 0; y < height; y++)
+	{
+		unsigned char *bufRow = &buf[width * 3 * (height - y - 1)];
+		unsigned char *srcRow =
+			&src.bits[src.pitch * (srcbu ? height - y - 1 : y)];
+		for(int x = 0; x < width; x++)
+		{
+			int k = (x / runWidth + y * 7) % nColors;
+			int r = (k * 37) & 0xFF, g = (k * 91) & 0xFF, b = (k * 151) & 0xFF;
+			if(k == 256) r ^= 1;
+			bufRow[x * 3] = r;  bufRow[x * 3 + 1] = g;  bufRow[x * 3 + 2] = b;
+			src.pf->setRGB(&srcRow[x * src.pf->size], r, g, b);
+		}
+	}
+}
+
+
+// Decode a copy of the specified stream, allocated with the exact size of the
+// stream so that memory checkers can detect any read past the end of it, and
+// return true if the decoder rejected the stream
+bool decodeThrows(CompressedFrame &cf, unsigned char *stream,
+	unsigned int size, Frame &dst)
+{
+	unsigned char *bits = cf.bits, *copy = new unsigned char[size];
+	bool threw = false;
+
+	memcpy(copy, stream, size);
+	cf.bits = copy;
+	try
+	{
+		dst.decompressLossless(cf, size, cf.hdr.width, cf.hdr.height, false);
+	}
+	catch(std::exception &e)
+	{
+		threw = true;
+	}
+	cf.bits = bits;
+	delete [] copy;
+	return threw;
+}
+
+
+int losslessTest(void)
+{
+	static const int sizes[][2] = { { 1, 1 }, { 64, 48 }, { 301, 203 } };
+	static const int colors[][2] = { { 1, 1 }, { 16, 5 }, { 256, 1 } };
+	int retval = 0;
+
+	for(int srcformat = 0; srcformat < PIXELFORMATS - 1; srcformat++)
+	{
+		PF *srcpf = pf_get(srcformat);
+		if(srcpf->bpc != 8 || srcpf->size < 3) continue;
+
+		for(int dstformat = 0; dstformat < PIXELFORMATS - 1; dstformat++)
+		{
+			PF *dstpf = pf_get(dstformat);
+			if(dstpf->size < 3) continue;
+
+			for(int dstbu = 0; dstbu < 2; dstbu++)
+			{
+				fprintf(stderr, "%s -> LOSSLESS -> %s (%s): ", srcpf->name,
+					dstpf->name, dstbu ? "BOTTOM-UP" : "TOP-DOWN");
+				bool failed = false;
+				for(int s = 0; s < 3; s++)
+				{
+					for(int c = 0; c < 3; c++)
+					{
+						int width = sizes[s][0], height = sizes[s][1];
+						rrframeheader hdr;
+						memset(&hdr, 0, sizeof(hdr));
+						hdr.width = hdr.framew = width;
+						hdr.height = hdr.frameh = height;
+						hdr.size = width * 3 * height;
+						unsigned char *buf = new unsigned char[width * 3 * height];
+						Frame src, dst;  CompressedFrame cf;
+						src.init(hdr, srcpf->id, dstbu ? 0 : FRAME_BOTTOMUP);
+						makeLosslessImage(buf, src, colors[c][0], colors[c][1]);
+						dst.init(hdr, dstpf->id, dstbu ? FRAME_BOTTOMUP : 0);
+						memset(dst.bits, 0, dst.pitch * dst.hdr.frameh);
+						if(!cf.compressLossless(src, 1 + RR_MAXPALETTE * 3 + hdr.size))
+							failed = true;
+						else
+						{
+							dst.decompressLossless(cf, cf.hdr.size, width, height, false);
+							if(cmpFrame(buf, width, height, dst)) failed = true;
+						}
+						delete [] buf;
+					}
+				}
+				if(failed) { fprintf(stderr, "FAILED!\n");  retval = 1; }
+				else fprintf(stderr, "Passed.\n");
+			}
+		}
+		fprintf(stderr, "\n");
+	}
+
+	rrframeheader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.width = hdr.framew = 64;  hdr.height = hdr.frameh = 48;
+	hdr.size = 64 * 3 * 48;
+	unsigned char *buf = new unsigned char[64 * 3 * 48];
+	Frame src, dst;  CompressedFrame cf;
+	src.init(hdr, PF_RGB, 0);
+	dst.init(hdr, PF_RGB, 0);
+
+	fprintf(stderr, "Rejection of unsuitable images: ");
+	bool failed = false;
+	makeLosslessImage(buf, src, 257, 1);
+	if(cf.compressLossless(src, hdr.size)) failed = true;
+	makeLosslessImage(buf, src, 16, 1);
+	if(cf.compressLossless(src, 100)) failed = true;
+	if(failed) { fprintf(stderr, "FAILED!\n");  retval = 1; }
+	else fprintf(stderr, "Passed.\n");
+
+	// Every truncation of a valid stream must be rejected, since the runs in a
+	// valid stream cover the whole tile.
+	fprintf(stderr, "Truncated streams: ");
+	failed = false;
+	makeLosslessImage(buf, src, 16, 5);
+	if(!cf.compressLossless(src, hdr.size)) failed = true;
+	else
+	{
+		for(unsigned int size = 1; size < cf.hdr.size; size++)
+			if(!decodeThrows(cf, cf.bits, size, dst)) failed = true;
+		if(decodeThrows(cf, cf.bits, cf.hdr.size, dst)) failed = true;
+	}
+	if(failed) { fprintf(stderr, "FAILED!\n");  retval = 1; }
+	else fprintf(stderr, "Passed.\n");
+
+	fprintf(stderr, "Corrupt streams: ");
+	failed = false;
+	static const unsigned char badPalette[] = { 0xFF, 0, 0, 0, 0, 0x7F };
+	static const unsigned char badIndex[] = { 0x00, 0, 0, 0, 0x01, 0x7F };
+	static const unsigned char longRun[] = { 0x00, 0, 0, 0, 0x00, 0x80, 0x18 };
+	static const unsigned char hugeRun[] =
+		{ 0x00, 0, 0, 0, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F };
+	static const unsigned char longVarint[] =
+		{ 0x00, 0, 0, 0, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+	static const unsigned char lateIndex[] =
+		{ 0x01, 0, 0, 0, 255, 255, 255, 0x00, 0xFF, 0x0B, 0x02, 0x7F };
+	if(!decodeThrows(cf, (unsigned char *)badPalette, sizeof(badPalette), dst)
+		|| !decodeThrows(cf, (unsigned char *)badIndex, sizeof(badIndex), dst)
+		|| !decodeThrows(cf, (unsigned char *)longRun, sizeof(longRun), dst)
+		|| !decodeThrows(cf, (unsigned char *)hugeRun, sizeof(hugeRun), dst)
+		|| !decodeThrows(cf, (unsigned char *)longVarint, sizeof(longVarint),
+			dst)
+		|| !decodeThrows(cf, (unsigned char *)lateIndex, sizeof(lateIndex), dst))
+		failed = true;
+	if(failed) { fprintf(stderr, "FAILED!\n");  retval = 1; }
+	else fprintf(stderr, "Passed.\n");
+
+	delete [] buf;
+	return retval;
+}
+
+
+bool hdrEquals(const rrframeheader &h1, const rrframeheader &h2)
+{
+	return h1.size == h2.size && h1.winid == h2.winid
+		&& h1.framew == h2.framew && h1.frameh == h2.frameh
+		&& h1.width == h2.width && h1.height == h2.height && h1.x == h2.x
+		&& h1.y == h2.y && h1.qual == h2.qual && h1.subsamp == h2.subsamp
+		&& h1.flags == h2.flags && h1.compress == h2.compress
+		&& h1.dpynum == h2.dpynum;
+}
+
+
+// Decode a copy of the specified record, allocated with the exact size of the
+// record so that memory checkers can detect any read past the end of it, and
+// return true if the decoder rejected the record
+bool decodeRecordThrows(CompactHeader codec, const unsigned char *rec, int len)
+{
+	unsigned char *copy = new unsigned char[len > 0 ? len : 1];
+	rrframeheader h;
+	bool threw = false;
+
+	memcpy(copy, rec, len);
+	try
+	{
+		codec.decode(copy, len, h);
+	}
+	catch(std::exception &e)
+	{
+		threw = true;
+	}
+	delete [] copy;
+	return threw;
+}
+
+
+int compactHeaderTest(void)
+{
+	// A full header, tiles of the same size and of different sizes, a tile with
+	// a right-eye buffer and shared memory image data, End-of-Frame markers
+	// sent with and without a full record, a quality change, and the largest
+	// values that each field can hold
+	static const rrframeheader hdrs[] =
+	{
+		{ 1234, 0x2A00007, 1920, 1200, 64, 64, 0, 0, 80, 1, RR_LEFT,
+			RRCOMP_JPEG, 0 },
+		{ 2345, 0x2A00007, 1920, 1200, 64, 64, 64, 0, 80, 1, RR_LEFT,
+			RRCOMP_JPEG, 0 },
+		{ 200000, 0x2A00007, 1920, 1200, 1000, 17, 128, 640, 80, 1, RR_LEFT,
+			RRCOMP_JPEG, 0 },
+		{ 100, 0x2A00007, 1920, 1200, 1000, 17, 128, 640, 80, 1,
+			RR_RIGHT | RR_SHMDATA, RRCOMP_JPEG, 0 },
+		{ 0, 0x2A00007, 1920, 1200, 1920, 1200, 0, 0, 80, 1, RR_EOF,
+			RRCOMP_JPEG, 0 },
+		{ 0, 0x2A00007, 1920, 1200, 1920, 1200, 0, 0, 95, 1, RR_EOF,
+			RRCOMP_JPEG, 0 },
+		{ 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+			0xFFFF, 0xFF, 0xFF, 0, 0xFF, 0xFFFF },
+		{ 0, 0xFFFFFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0, 0, 0xFF, 0xFF,
+			RR_EOF, 0xFF, 0xFFFF }
+	};
+	int nHdrs = sizeof(hdrs) / sizeof(rrframeheader), retval = 0;
+	CompactHeader encoder, decoder;
+	unsigned char buf[RR_MAXRECORD + 1];
+	int len;
+	bool failed = false, truncFailed = false;
+
+	fprintf(stderr, "Compact header round trip: ");
+	for(int i = 0; i < nHdrs; i++)
+	{
+		rrframeheader h = hdrs[i], out;
+		len = encoder.encode(h, buf);
+		if(len < 2 || len > RR_MAXRECORD || buf[0] != len - 1)
+		{
+			failed = true;  break;
+		}
+
+		// Every truncation of a record, and a record with trailing garbage, must
+		// be rejected.
+		for(int trunc = 0; trunc < len - 1; trunc++)
+			if(!decodeRecordThrows(decoder, &buf[1], trunc)) truncFailed = true;
+		buf[len] = 0;
+		if(!decodeRecordThrows(decoder, &buf[1], len)) truncFailed = true;
+
+		memset(&out, 0, sizeof(out));
+		if(decoder.decode(&buf[1], len - 1, out) != 0 || !hdrEquals(h, out))
+			failed = true;
+	}
+	len = CompactHeader::encodeBatch(RR_MAXBATCH, buf);
+	rrframeheader out = hdrs[0];
+	if(decoder.decode(&buf[1], len - 1, out) != RR_MAXBATCH
+		|| !hdrEquals(out, hdrs[0]))
+		failed = true;
+	if(failed) { fprintf(stderr, "FAILED!\n");  retval = 1; }
+	else fprintf(stderr, "Passed.\n");
+
+	fprintf(stderr, "Truncated compact headers: ");
+	if(truncFailed) { fprintf(stderr, "FAILED!\n");  retval = 1; }
+	else fprintf(stderr, "Passed.\n");
+
+	fprintf(stderr, "Corrupt compact headers: ");
+	CompactHeader fresh;
+	// A partial record before any full record
+	static const unsigned char noRef[] = { RR_LEFT | RR_REC_SAMESIZE, 0, 0, 1 };
+	// An overlong varint
+	static const unsigned char longVarint[] =
+		{ RR_LEFT, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0, 0, 0 };
+	// A width that exceeds 16 bits
+	static const unsigned char bigWidth[] =
+		{ RR_LEFT, 0, 0, 0x80, 0x80, 0x04, 1, 1 };
+	// Batch records with a zero length or trailing data
+	static const unsigned char emptyBatch[] = { RR_REC_BATCH, 0 };
+	static const unsigned char longBatch[] = { RR_REC_BATCH, 1, 0 };
+	if(!decodeRecordThrows(fresh, noRef, sizeof(noRef))
+		|| !decodeRecordThrows(decoder, longVarint, sizeof(longVarint))
+		|| !decodeRecordThrows(decoder, bigWidth, sizeof(bigWidth))
+		|| !decodeRecordThrows(decoder, emptyBatch, sizeof(emptyBatch))
+		|| !decodeRecordThrows(decoder, longBatch, sizeof(longBatch)))
+	{
+		fprintf(stderr, "FAILED!\n");  retval = 1;
+	}
+	else fprintf(stderr, "Passed.\n");
+
+	return retval;
+}
+
+
 void usage(char **argv)
 {
 	fprintf(stderr, "\nUSAGE: %s [options]\n\n", argv[0]);
@@ -608,6 +899,10 @@ void usage(char **argv)
 	fprintf(stderr, "-anaglyph = Test anaglyph creation\n");
 	fprintf(stderr, "-rgbbench <filename> = Benchmark the decoding of RGB-encoded frames.\n");
 	fprintf(stderr, "                       <filename> should be a BMP or PPM file.\n");
+	fprintf(stderr, "-losslesstest = Test lossless encoding/decoding, including the rejection\n");
+	fprintf(stderr, "                of truncated and corrupt streams\n");
+	fprintf(stderr, "-compacttest = Test compact header encoding/decoding, including the\n");
+	fprintf(stderr, "               rejection of truncated and corrupt records\n");
 	fprintf(stderr, "-v = Verbose output (may affect benchmark results)\n");
 	fprintf(stderr, "-check = Check correctness of pixel paths (implies -rgb)\n\n");
 	exit(1);
@@ -648,6 +943,8 @@ int main(int argc, char **argv)
 		{
 			fileName = argv[++i];  doRgbBench = true;
 		}
+		else if(!stricmp(argv[i], "-losslesstest")) doLosslessTest = true;
+		else if(!stricmp(argv[i], "-compacttest")) doCompactTest = true;
 		else if(!stricmp(argv[i], "-v")) verbose = true;
 		else if(!stricmp(argv[i], "-check")) { check = true;  useRGB = true; }
 		else usage(argv);
@@ -656,6 +953,8 @@ int main(int argc, char **argv)
 	try
 	{
 		if(doRgbBench) { rgbBench(fileName);  exit(0); }
+		if(doLosslessTest) exit(losslessTest());
+		if(doCompactTest) exit(compactHeaderTest());
 
 		ERRIFNOT(XInitThreads());
 		if(!(dpy = XOpenDisplay(0)))
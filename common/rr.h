@@ -17,7 +17,7 @@
 #define __RR_H
 
 #define RR_MAJOR_VERSION  2
-#define RR_MINOR_VERSION  1
+#define RR_MINOR_VERSION  2
 
 /* Argh! */
 #if !defined(__SUNPRO_CC) && !defined(__SUNPRO_C)
@@ -57,6 +57,116 @@ typedef struct _rrversion
 } rrversion;
 #define sizeof_rrversion  5
 
+/* Capabilities message (protocol v2.2 and later.)  Immediately after the
+   version exchange, the server sends the capabilities that it would like to
+   use, and the client replies with the subset of those capabilities that it
+   accepts. */
+typedef struct _rrcaps
+{
+  unsigned int flags;      /* See enum below */
+  int shmid;               /* If RR_CAP_SHM is set, the ID of the shared memory
+                              segment that will carry the image data */
+  unsigned int shmkey[2];  /* If RR_CAP_SHM is set, a random key that is also
+                              stored in the shared memory segment, so the
+                              client can verify that it attached the correct
+                              segment */
+} rrcaps;
+#define sizeof_rrcaps  16
+
+/* Capability flags */
+enum
+{
+  RR_CAP_SHM = 1,    /* Image data for each tile is passed through a shared
+                        memory ring buffer rather than through the socket */
+  RR_CAP_TIMING = 2,  /* Each End-of-Frame header is followed by an
+                        rrframetiming structure */
+  RR_CAP_STREAMS = 4,  /* Tiles are striped across multiple TCP connections
+                        (see rrstreams below) */
+  RR_CAP_COMPACT = 8,  /* Tile headers are sent as compact records (see
+                        below) */
+  RR_CAP_LOSSLESS = 16  /* Individual tiles may be sent with RRCOMP_LOSSLESS
+                        (see below) */
+};
+
+/* Multi-stream setup (RR_CAP_STREAMS.)  After the capabilities exchange on
+   the primary connection, the server sends an rrstreams structure with index
+   0 and the number of connections that it would like to use, and the client
+   replies with the number that it accepts.  The server then opens the
+   additional connections.  Each goes through the version and capabilities
+   exchange, with only RR_CAP_STREAMS offered, and then the server sends an
+   rrstreams structure with the connection's index and the session key, which
+   the client echoes (or replies with index 0 to reject the connection.)
+   Finally, the server sends another rrstreams structure through the primary
+   connection with the number of connections that were actually established.
+   From then on, each tile (including both eyes of a stereo tile) is sent
+   through exactly one connection, and each End-of-Frame marker is sent
+   through all of them, so the client must receive an End-of-Frame marker
+   from every connection before drawing the frame. */
+typedef struct _rrstreams
+{
+  unsigned int count;      /* Total number of connections, including the
+                              primary connection */
+  unsigned int index;      /* 0 on the primary connection, or the index of
+                              an additional connection */
+  unsigned int key[2];     /* Random key that identifies the session */
+} rrstreams;
+#define sizeof_rrstreams  16
+
+#define RR_MAXSTREAMS  16
+
+/* Sent after each End-of-Frame header if RR_CAP_TIMING was negotiated.  All
+   times are in microseconds and are measured on the server, relative to the
+   time at which the application triggered the frame. */
+typedef struct _rrframetiming
+{
+  unsigned int frameID;    /* Sequence number of the frame, or 0 if the
+                              End-of-Frame marker does not complete a new
+                              frame (for instance, if it completes a
+                              refinement pass) */
+  unsigned int queued;     /* Time at which the frame was passed to the
+                              image transport */
+  unsigned int sent;       /* Time at which the last tile of the frame was
+                              sent */
+  unsigned int rtt;        /* Estimated round-trip time of the connection,
+                              or 0 if no estimate is available */
+} rrframetiming;
+#define sizeof_rrframetiming  16
+
+/* Sent in place of the image data for a tile whose header has the RR_SHMDATA
+   flag set */
+typedef struct _rrshmref
+{
+  unsigned int offset;     /* Offset of the image data within the ring */
+  unsigned int end;        /* Ring position that the client should report as
+                              consumed once it has copied the image data */
+} rrshmref;
+#define sizeof_rrshmref  8
+
+/* Compact tile headers (RR_CAP_COMPACT.)  Once this capability has been
+   negotiated, every header (on every connection, if RR_CAP_STREAMS is also
+   in use) is sent as a record:  one byte that specifies the length of the
+   record, followed by the record itself.  The first byte of the record
+   contains the header flags (RR_EOF, RR_LEFT, or RR_RIGHT, possibly combined
+   with RR_SHMDATA) along with the record flags below, and the remainder of
+   the record consists of unsigned LEB128 variable-length integers.
+
+   A full record (RR_REC_FULL) contains all of the fields of rrframeheader
+   other than flags, in the order in which they are declared.  Otherwise, the
+   record contains only the x, y, width, height, and size fields (width and
+   height are omitted if RR_REC_SAMESIZE is set), and the other fields are
+   the same as those of the previous header on the same connection.  An
+   End-of-Frame record contains no fields, and its x and y fields are 0, its
+   width and height are those of the frame, and its size is 0.
+
+   A batch record (RR_REC_BATCH) contains only a length, and it is followed by
+   that many bytes of records, each of which is followed by its image data (or
+   rrshmref structure.)  This allows many small tiles to be sent and received
+   with a single system call.  Batches cannot be nested, and End-of-Frame
+   records are never sent in a batch. */
+#define RR_REC_FULL      0x40
+#define RR_REC_SAMESIZE  0x20
+#define RR_REC_BATCH     0x10
+
 /* Header from version 1 of the VirtualGL protocol (used to communicate with
    older clients */
 typedef struct _rrframeheader_v1
@@ -91,6 +201,11 @@ enum
   RR_RIGHT     /* this tile goes to the right buffer of a stereo frame */
 };
 
+/* Header flag modifiers (protocol v2.2 and later) */
+#define RR_SHMDATA  0x80  /* the image data for this tile is in the shared
+                             memory ring, and the socket carries only an
+                             rrshmref structure */
+
 /* Transport types */
 #define RR_TRANSPORTOPT  3
 enum rrtrans
@@ -102,12 +217,23 @@ enum rrtrans
 #define RR_COMPRESSOPT  5
 enum rrcomp
 {
-  RRCOMP_PROXY = 0, RRCOMP_JPEG, RRCOMP_RGB, RRCOMP_XV, RRCOMP_YUV
+  RRCOMP_PROXY = 0, RRCOMP_JPEG, RRCOMP_RGB, RRCOMP_XV, RRCOMP_YUV,
+  RRCOMP_LOSSLESS
 };
 
+/* RRCOMP_LOSSLESS is never used as the compression type for a frame.  If
+   RR_CAP_LOSSLESS was negotiated, then the server may use it in place of
+   RRCOMP_JPEG for individual tiles that contain few colors.  The tile data
+   consists of one byte that specifies the number of palette entries minus 1,
+   the palette entries (3 bytes each, in R, G, B order), and a list of runs.
+   Each run is a one-byte palette index followed by the length of the run
+   minus 1, encoded as an unsigned LEB128 varint.  Runs proceed in top-down
+   raster order and may span rows. */
+#define RR_MAXPALETTE  256
+
 /* Readback types */
-#define RR_READBACKOPT  3
-enum rrread { RRREAD_NONE = 0, RRREAD_SYNC, RRREAD_PBO };
+#define RR_READBACKOPT  4
+enum rrread { RRREAD_NONE = 0, RRREAD_SYNC, RRREAD_PBO, RRREAD_THREAD };
 
 static const enum rrtrans _Trans[RR_COMPRESSOPT] =
 {
@@ -129,6 +255,12 @@ static const int _Maxsubsamp[RR_COMPRESSOPT] =
   -1, 4, -1, 4, 4
 };
 
+/* Capture modes (see VGL_CAPTURE) */
+enum rrcapture
+{
+  RRCAPTURE_STREAM = 1, RRCAPTURE_FRAMES = 2, RRCAPTURE_BOTH = 3
+};
+
 /* Stereo options */
 #define RR_STEREOOPT  9
 enum rrstereo
@@ -151,13 +283,21 @@ enum rrstereo
 /* Faker configuration */
 typedef struct _FakerConfig
 {
+  double adaptive;
+  double adaptivembps;
+  char affinity[MAXSTR];
   char allowindirect;
   char autotest;
+  char capture[MAXSTR];
+  int capturemode;
   char client[MAXSTR];
+  char compacthdr;
   int compress;
   char config[MAXSTR];
+  char damage;
   char defaultfbconfig[MAXSTR];
   char dlsymloader;
+  int drawpool;
   char egl;
   char egllib[MAXSTR];
   char eglxIgnorePixmapBit;
@@ -177,20 +317,30 @@ typedef struct _FakerConfig
   char interframe;
   char localdpystring[MAXSTR];
   char log[MAXSTR];
+  char logasync;
   char logo;
+  int logrepeat;
+  char lossless;
   int np;
+  char pace;
   int port;
   char probeglx;
   int qual;
   char readback;
+  int readstripe;
+  double refine;
   double refreshrate;
   int samples;
+  char sched[MAXSTR];
   char spoil;
   char spoillast;
   int stereo;
+  int streams;
   int subsamp;
+  char shmtrans;
   char sync;
   int tilesize;
+  char topdown;
   char trace;
   int transpixel;
   char transport[MAXSTR];
@@ -199,6 +349,7 @@ typedef struct _FakerConfig
   char vendor[MAXSTR];
   char verbose;
   char wm;
+  int workers;
   char x11lib[MAXSTR];
   char fakeXCB;
   char xcblib[MAXSTR];
@@ -35,6 +35,7 @@ namespace util
 			void get(void **item, bool nonBlocking = false);
 			void release(void);
 			int items(void);
+			bool waitForItems(double timeout);
 
 		private:
 
@@ -45,6 +46,7 @@ namespace util
 
 			Entry *start, *end;
 			Semaphore hasItem;
+			Event itemAdded;
 			CriticalSection mutex;
 			int deadYet;
 	};
@@ -1,6 +1,6 @@
 // Copyright (C)2004 Landmark Graphics Corporation
 // Copyright (C)2005, 2006 Sun Microsystems, Inc.
-// Copyright (C)2014, 2021 D. R. Commander
+// Copyright (C)2014, 2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -16,6 +16,8 @@
 #define __LOG_H__
 
 #include "Mutex.h"
+#include "Thread.h"
+#include <stdarg.h>
 #include <stdio.h>
 
 
@@ -33,22 +35,72 @@ namespace util
 			void PRINT(const char *format, ...);
 			void println(const char *format, ...);
 			void PRINTLN(const char *format, ...);
-			void flush(void) { fflush(logFile); }
-			FILE *getFile(void) { return logFile; }
+			// Wait until all messages have been written, and flush the log file
+			void flush(void);
+			FILE *getFile(void);
+
+			// In asynchronous mode, the calling thread formats each message into its
+			// own buffer and passes it through a lock-free ring to a writer thread,
+			// which performs all of the stdio calls.  The uppercase methods do not
+			// wait for the message to be written, but the writer thread flushes the
+			// log file as soon as it has written the message.  Asynchronous mode is
+			// not supported on Windows.
+			void setAsync(bool async);
+			// Print no more than maxRepeat consecutive copies of the same line,
+			// followed by the number of copies that were suppressed (0 = no limit)
+			void setRepeatLimit(int maxRepeat);
 
 		private:
 
-			Log()
+			Log();
+			~Log() {}
+
+			void write(const char *format, va_list arglist, bool newline,
+				bool flushNow);
+			void output(const char *buf, int len, bool whole);
+			void endRepeats(void);
+			#ifndef _WIN32
+			bool beginAsync(void);
+			void endAsync(void);
+			unsigned int enqueue(const char *buf, int len, int flushType);
+			void drain(void);
+			void wakeWriter(void);
+			void stopWriter(void);
+			static void atExit(void);
+			static void atForkPrepare(void);
+			static void atForkParent(void);
+			static void atForkChild(void);
+
+			class Writer : public Runnable
 			{
-				logFile = stderr;  newFile = false;
-			}
+				public:
 
-			~Log() {}
+					Writer(Log *log_) : log(log_) {}
+					void run(void) { log->drain(); }
+
+				private:
+
+					Log *log;
+			};
+
+			struct Slot;
+			Slot *slots;
+			volatile unsigned int head, tail, flushed;
+			volatile int writerIdle, producers;
+			volatile bool async, deadYet;
+			Event wake, flushDone;
+			CriticalSection flushMutex;
+			Writer *writer;
+			Thread *thread;
+			#endif
 
 			static Log *instance;
 			static CriticalSection mutex;
 			FILE *logFile;
 			bool newFile;
+			int maxRepeat, repeats, lastLen;
+			bool atLineStart;
+			char *last;
 	};
 }
 
@@ -32,6 +32,7 @@ namespace util
 			Event(void);
 			~Event(void);
 			void wait(void);
+			bool timedWait(double timeout);
 			void signal(void);
 			bool isLocked(void);
 
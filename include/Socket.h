@@ -75,6 +75,9 @@ namespace util
 			void send(char *buf, int len);
 			void recv(char *buf, int len);
 			const char *remoteName(void);
+			bool isLocal(void);
+			int sendQueue(void);
+			double rtt(void);
 
 		private:
 
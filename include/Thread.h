@@ -1,6 +1,6 @@
 // Copyright (C)2004 Landmark Graphics Corporation
 // Copyright (C)2005 Sun Microsystems, Inc.
-// Copyright (C)2014, 2019, 2021, 2025 D. R. Commander
+// Copyright (C)2014, 2019, 2021, 2025-2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -55,6 +55,15 @@ namespace util
 			void setError(std::exception &e);
 			void checkError(void);
 
+			// These apply to the calling thread.  setAffinity() accepts a
+			// comma-separated list of CPU numbers and ranges (for instance,
+			// "0-3,8"), and setScheduling() accepts a scheduling policy ("other",
+			// "batch", "idle", "fifo", or "rr"), optionally followed by a colon and
+			// a priority (for instance, "fifo:10".)  Both throw an error if the
+			// argument is invalid or the setting is not supported.
+			static void setAffinity(const char *cpuList);
+			static void setScheduling(const char *policy);
+
 			static unsigned long threadID(void)
 			{
 				#ifdef _WIN32
@@ -1,6 +1,6 @@
 // Copyright (C)2004 Landmark Graphics Corporation
 // Copyright (C)2005 Sun Microsystems, Inc.
-// Copyright (C)2014, 2018-2019, 2021 D. R. Commander
+// Copyright (C)2014, 2018-2019, 2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -15,72 +15,41 @@
 #ifndef __TIMER_H__
 #define __TIMER_H__
 
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <sys/time.h>
-#endif
 #include <stdlib.h>
-#include "vglinline.h"
+#include "vglutil.h"
 
 
 namespace util
 {
+	// Measures intervals using the monotonic clock (see GetTimeNS() in
+	// vglutil.h), so it is unaffected by changes to the system time.  The start
+	// time is kept as an integer number of nanoseconds, so short intervals lose
+	// no precision, no matter how long the system has been running.
+
 	class Timer
 	{
 		public:
 
-			Timer(void) : t1(0.0)
-			{
-				#ifdef _WIN32
-				highRes = false;  tick = 0.001;
-				LARGE_INTEGER frequency;
-				if(QueryPerformanceFrequency(&frequency) != 0)
-				{
-					tick = (double)1.0 / (double)(frequency.QuadPart);
-					highRes = true;
-				}
-				#endif
-			}
+			Timer(void) : t1(0) {}
 
 			void start(void)
 			{
-				t1 = time();
+				t1 = GetTimeNS();
 			}
 
 			double time(void)
 			{
-				#ifdef _WIN32
-
-				if(highRes)
-				{
-					LARGE_INTEGER Time;
-					QueryPerformanceCounter(&Time);
-					return (double)(Time.QuadPart) * tick;
-				}
-				else
-					return (double)GetTickCount() * tick;
-
-				#else
-
-				struct timeval tv;
-				gettimeofday(&tv, (struct timezone *)NULL);
-				return (double)(tv.tv_sec) + (double)(tv.tv_usec) * 0.000001;
-
-				#endif
+				return (double)GetTimeNS() * 0.000000001;
 			}
 
 			double elapsed(void)
 			{
-				return time() - t1;
+				return (double)(GetTimeNS() - t1) * 0.000000001;
 			}
 
 		private:
 
-			#ifdef _WIN32
-			bool highRes;  double tick;
-			#endif
-			double t1;
+			unsigned long long t1;
 	};
 }
 
@@ -0,0 +1,88 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+#include "Thread.h"
+#include "Mutex.h"
+
+
+namespace util
+{
+	// A pool of worker threads that can be shared by any number of clients.
+	// execute() runs a batch of jobs in parallel and returns once all of them
+	// have completed.  The calling thread always runs the first job in the
+	// batch, and it also runs any other jobs in the batch that no worker thread
+	// has picked up by the time it finishes, so a batch always makes progress
+	// even if all of the worker threads are busy with other batches.
+
+	class WorkerPool
+	{
+		public:
+
+			class Job
+			{
+				public:
+
+					virtual ~Job(void) {}
+					virtual void execute(void) = 0;
+			};
+
+			// If cpuList or schedPolicy is non-NULL, then it is passed to
+			// Thread::setAffinity() or Thread::setScheduling() in each worker
+			// thread.
+			WorkerPool(int nThreads, const char *cpuList = NULL,
+				const char *schedPolicy = NULL);
+			~WorkerPool(void);
+			void execute(Job **jobs, int nJobs);
+			int getNumThreads(void) { return nThreads; }
+
+			// Returns the first error that occurred when applying cpuList or
+			// schedPolicy in a worker thread, or NULL if none occurred.
+			const char *getSetupError(void);
+
+		private:
+
+			struct Batch;
+			struct Entry
+			{
+				Job *job;  Batch *batch;  Entry *next;
+			};
+
+			class Worker : public Runnable
+			{
+				public:
+
+					Worker(WorkerPool *parent_) : parent(parent_) {}
+					void run(void);
+
+				private:
+
+					WorkerPool *parent;
+			};
+
+			void cleanup(void);
+			void runJob(Job *job, Batch *batch);
+
+			int nThreads;
+			char cpuList[256], schedPolicy[256], setupError[257];
+			Entry *head, *tail;
+			CriticalSection mutex;
+			Semaphore pending;
+			bool deadYet;
+			Worker **workers;
+			Thread **threads;
+	};
+}
+
+#endif  // __WORKERPOOL_H__
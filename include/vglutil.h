@@ -1,6 +1,6 @@
 /* Copyright (C)2004 Landmark Graphics Corporation
  * Copyright (C)2005 Sun Microsystems, Inc.
- * Copyright (C)2010, 2014, 2017-2019 D. R. Commander
+ * Copyright (C)2010, 2014, 2017-2019, 2026 D. R. Commander
  *
  * This library is free software and may be redistributed and/or modified under
  * the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -21,7 +21,9 @@
 	#define sleep(t)  Sleep((t) * 1000)
 	#define usleep(t)  Sleep((t) / 1000)
 #else
+	#include <fcntl.h>
 	#include <sys/time.h>
+	#include <time.h>
 	#include <unistd.h>
 	#define stricmp  strcasecmp
 	#define strnicmp  strncasecmp
@@ -94,8 +96,28 @@ static INLINE int LittleEndian(void)
 	else return 0;
 }
 
+/* GetTime() returns a timestamp in seconds, and GetTimeNS() returns the same
+   timestamp as an integer number of nanoseconds.  Both use a monotonic clock
+   that is unaffected by changes to the system time, so only the differences
+   between timestamps are meaningful.  On Linux, the clock is read without
+   entering the kernel. */
+
 #ifdef _WIN32
 
+static INLINE unsigned long long GetTimeNS(void)
+{
+	LARGE_INTEGER frequency, time;
+	if(QueryPerformanceFrequency(&frequency) != 0)
+	{
+		QueryPerformanceCounter(&time);
+		return (unsigned long long)(time.QuadPart / frequency.QuadPart) *
+			1000000000ULL +
+			(unsigned long long)(time.QuadPart % frequency.QuadPart) *
+			1000000000ULL / (unsigned long long)frequency.QuadPart;
+	}
+	else return (unsigned long long)GetTickCount() * 1000000ULL;
+}
+
 static INLINE double GetTime(void)
 {
 	LARGE_INTEGER frequency, time;
@@ -109,13 +131,93 @@ static INLINE double GetTime(void)
 
 #else
 
+static INLINE unsigned long long GetTimeNS(void)
+{
+	#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (unsigned long long)ts.tv_sec * 1000000000ULL +
+			(unsigned long long)ts.tv_nsec;
+	#endif
+	{
+		struct timeval tv;
+		gettimeofday(&tv, (struct timezone *)NULL);
+		return (unsigned long long)tv.tv_sec * 1000000000ULL +
+			(unsigned long long)tv.tv_usec * 1000ULL;
+	}
+}
+
 static INLINE double GetTime(void)
 {
-	struct timeval tv;
-	gettimeofday(&tv, (struct timezone *)NULL);
-	return (double)tv.tv_sec + (double)tv.tv_usec * 0.000001;
+	#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (double)ts.tv_sec + (double)ts.tv_nsec * 0.000000001;
+	#endif
+	{
+		struct timeval tv;
+		gettimeofday(&tv, (struct timezone *)NULL);
+		return (double)tv.tv_sec + (double)tv.tv_usec * 0.000001;
+	}
 }
 
 #endif  /* _WIN32 */
 
+/* Fill buf with len random bytes, for use as a key that must be hard to guess.
+   The bytes are read from /dev/urandom if possible.  Otherwise, they are
+   derived from the wall-clock time, the monotonic clock, the process ID, and
+   the address of buf, which is much easier to guess.  Returns 1 if the bytes
+   came from /dev/urandom or 0 otherwise. */
+
+static INLINE int GetRandomBytes(void *buf, int len)
+{
+	unsigned char *ptr = (unsigned char *)buf;
+	unsigned long long seed, z = 0;
+	int i;
+
+	#ifndef _WIN32
+	int fd;
+	if((fd = open("/dev/urandom", O_RDONLY)) != -1)
+	{
+		ssize_t bytesRead = read(fd, buf, len);
+		close(fd);
+		if(bytesRead == (ssize_t)len) return 1;
+	}
+	{
+		struct timeval tv;
+		gettimeofday(&tv, (struct timezone *)NULL);
+		seed = (unsigned long long)tv.tv_sec * 1000000ULL +
+			(unsigned long long)tv.tv_usec;
+	}
+	seed ^= (unsigned long long)getpid() << 32;
+	#else
+	{
+		FILETIME ft;
+		GetSystemTimeAsFileTime(&ft);
+		seed = ((unsigned long long)ft.dwHighDateTime << 32) |
+			(unsigned long long)ft.dwLowDateTime;
+	}
+	seed ^= (unsigned long long)GetCurrentProcessId() << 32;
+	#endif
+	/* The wall-clock time alone is easy to guess, so mix in the nanosecond
+	   monotonic timestamp, which depends on the system uptime. */
+	seed ^= GetTimeNS() * 0x9E3779B97F4A7C15ULL;
+	seed ^= (unsigned long long)(size_t)buf;
+
+	/* SplitMix64 */
+	for(i = 0; i < len; i++)
+	{
+		if(i % 8 == 0)
+		{
+			seed += 0x9E3779B97F4A7C15ULL;
+			z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			z ^= z >> 31;
+		}
+		ptr[i] = (unsigned char)(z >> ((i % 8) * 8));
+	}
+	return 0;
+}
+
 #endif  /* __VGLUTIL_H__ */
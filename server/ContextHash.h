@@ -23,12 +23,14 @@ typedef struct
 {
 	VGLFBConfig config;
 	Bool direct;
+	GLXDrawable draw, read;  // Off-screen drawables to which ctx is bound
 } ContextAttribs;
 
 
 #define HASH  Hash<GLXContext, void *, ContextAttribs *>
 
-// This maps a GLXContext to a VGLFBConfig
+// This maps a GLXContext to a VGLFBConfig and tracks the off-screen drawables
+// to which the context is currently bound
 
 namespace faker
 {
@@ -55,9 +57,41 @@ namespace faker
 				attribs = new ContextAttribs;
 				attribs->config = config;
 				attribs->direct = direct;
+				attribs->draw = attribs->read = 0;
 				HASH::add(ctx, NULL, attribs);
 			}
 
+			// Called after ctx has been made current (or after newCtx has been
+			// made current in place of ctx, in which case draw and read are 0.)
+			// This does not change the hash generation, because none of the
+			// values that glXMakeCurrent() caches is affected.
+			void setCurrentDrawables(GLXContext ctx, GLXDrawable draw,
+				GLXDrawable read)
+			{
+				if(!ctx) return;
+				util::CriticalSection::SafeLock l(mutex);
+				HashEntry *entry = findEntry(ctx, NULL);
+				if(entry && entry->value)
+				{
+					entry->value->draw = draw;  entry->value->read = read;
+				}
+			}
+
+			// Returns true if any context is currently bound to the specified
+			// off-screen drawable
+			bool isCurrent(GLXDrawable draw)
+			{
+				if(!draw) return false;
+				util::CriticalSection::SafeLock l(mutex);
+				for(HashEntry *entry = start; entry; entry = entry->next)
+				{
+					if(entry->value && (entry->value->draw == draw
+						|| entry->value->read == draw))
+						return true;
+				}
+				return false;
+			}
+
 			VGLFBConfig findConfig(GLXContext ctx)
 			{
 				if(!ctx) THROW("Invalid argument");
@@ -26,7 +26,7 @@ GLXDrawable FakePbuffer::nextID = 1;
 
 FakePbuffer::FakePbuffer(Display *dpy_, VGLFBConfig config_,
 	const int *glxAttribs) : dpy(dpy_), config(config_), id(0), fbo(0),
-	rbod(0), width(0), height(0)
+	rbod(0), width(0), height(0), swapCount(0)
 {
 	for(int i = 0; i < 4; i++) rboc[i] = 0;
 
@@ -222,6 +222,9 @@ void FakePbuffer::swap(void)
 		rboc[3] = tmp;
 		changed = true;
 	}
+	// Swapping exchanges the front and back renderbuffers, so once the Pbuffer
+	// has been swapped twice, the back buffer contains the frame before last.
+	if(changed) swapCount++;
 	if(changed && _eglGetCurrentContext())
 	{
 		GLint drawFBO = -1, readFBO = -1;
@@ -40,6 +40,7 @@ namespace backend
 			void setDrawBuffers(GLsizei n, const GLenum *bufs, bool deferred);
 			void setReadBuffer(GLenum readBuf, bool deferred);
 			void swap(void);
+			int getBufferAge(void) { return swapCount >= 2 ? 2 : 0; }
 
 		private:
 
@@ -51,6 +52,7 @@ namespace backend
 			// 0 = front left, 1 = back left, 2 = front right, 3 = back right
 			GLuint fbo, rboc[4], rbod;
 			int width, height;
+			int swapCount;
 			static util::CriticalSection idMutex;
 			static GLXDrawable nextID;
 	};
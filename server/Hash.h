@@ -23,6 +23,17 @@
 
 namespace faker
 {
+	// Incremented whenever an entry is added to, modified in, or removed from
+	// any of the faker's hash tables.  This allows the results of hash lookups to
+	// be cached outside of the hash tables (see glXMakeCurrent()) and cheaply
+	// revalidated without acquiring any of the hash mutexes.
+	extern volatile unsigned int hashGeneration;
+
+	static inline void bumpHashGeneration(void)
+	{
+		__sync_add_and_fetch(&hashGeneration, 1);
+	}
+
 	template <class HashKeyType1, class HashKeyType2, class HashValueType>
 	class Hash
 	{
@@ -66,7 +77,7 @@ namespace faker
 
 				if((entry = findEntry(key1, key2)) != NULL)
 				{
-					if(value) entry->value = value;
+					if(value) { entry->value = value;  bumpHashGeneration(); }
 					if(useRef) entry->refCount++;
 					return 0;
 				}
@@ -78,6 +89,7 @@ namespace faker
 				end->key1 = key1;  end->key2 = key2;  end->value = value;
 				if(useRef) end->refCount = 1;
 				count++;
+				bumpHashGeneration();
 				return 1;
 			}
 
@@ -88,7 +100,11 @@ namespace faker
 
 				if((entry = findEntry(key1, key2)) != NULL)
 				{
-					if(!entry->value) entry->value = attach(key1, key2);
+					if(!entry->value)
+					{
+						entry->value = attach(key1, key2);
+						bumpHashGeneration();
+					}
 					return entry->value;
 				}
 				return (HashValueType)0;
@@ -138,6 +154,7 @@ namespace faker
 				memset(entry, 0, sizeof(HashEntry));
 				delete entry;
 				count--;
+				bumpHashGeneration();
 			}
 
 			virtual HashValueType attach(HashKeyType1 key1, HashKeyType2 key2)
@@ -0,0 +1,442 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "LoopbackReceiver.h"
+#include "vglutil.h"
+
+using namespace util;
+using namespace common;
+using namespace server;
+
+
+#define ENDIANIZE(h) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		h.size = BYTESWAP(h.size); \
+		h.winid = BYTESWAP(h.winid); \
+		h.framew = BYTESWAP16(h.framew); \
+		h.frameh = BYTESWAP16(h.frameh); \
+		h.width = BYTESWAP16(h.width); \
+		h.height = BYTESWAP16(h.height); \
+		h.x = BYTESWAP16(h.x); \
+		h.y = BYTESWAP16(h.y); \
+		h.dpynum = BYTESWAP16(h.dpynum); \
+	} \
+}
+
+#define ENDIANIZE_CAPS(c) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		c.flags = BYTESWAP(c.flags); \
+		c.shmid = BYTESWAP(c.shmid); \
+	} \
+}
+
+#define ENDIANIZE_STREAMS(s) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		s.count = BYTESWAP(s.count); \
+		s.index = BYTESWAP(s.index); \
+	} \
+}
+
+#define TJSUBSAMP(s) \
+	(s >= 4 ? TJ_420 : \
+		(s == 2 ? TJ_422 : \
+			(s == 1 ? TJ_444 : \
+				(s == 0 ? TJ_GRAYSCALE : TJ_444))))
+
+
+TileDecoder::TileDecoder(void) : frames(0), pixels(0.), tjhnd(NULL)
+{
+	if((tjhnd = tjInitDecompress()) == NULL) THROW(tjGetErrorStr());
+}
+
+
+TileDecoder::~TileDecoder(void)
+{
+	if(tjhnd) { tjDestroy(tjhnd);  tjhnd = NULL; }
+}
+
+
+void TileDecoder::decode(rrframeheader &h, const unsigned char *bits)
+{
+	if(h.flags == RR_EOF) { frames++;  return; }
+
+	bool rightEye = (h.flags == RR_RIGHT);
+	if(h.framew != frame.hdr.framew || h.frameh != frame.hdr.frameh
+		|| (rightEye && !frame.rbits))
+	{
+		rrframeheader fh = h;
+		fh.x = fh.y = 0;  fh.width = h.framew;  fh.height = h.frameh;
+		fh.size = 0;  fh.flags = 0;
+		frame.init(fh, PF_BGRX, 0, rightEye || frame.rbits != NULL);
+	}
+	if(h.x + h.width > frame.hdr.framew || h.y + h.height > frame.hdr.frameh)
+		THROW("Tile is out of bounds");
+	unsigned char *dst = rightEye ? frame.rbits : frame.bits;
+	dst = &dst[frame.pitch * h.y + h.x * frame.pf->size];
+
+	switch(h.compress)
+	{
+		case RRCOMP_JPEG:
+			TRY_TJ(tjDecompress2(tjhnd, bits, h.size, dst, h.width, frame.pitch,
+				h.height, TJPF_BGRX, 0));
+			break;
+		case RRCOMP_RGB:
+		{
+			Frame src(false);
+			src.init((unsigned char *)bits, h.width, h.width * 3, h.height, PF_RGB,
+				FRAME_BOTTOMUP);
+			src.hdr.x = h.x;  src.hdr.y = h.y;
+			if(rightEye) src.rbits = src.bits;
+			frame.decompressRGB(src, h.width, h.height, rightEye);
+			break;
+		}
+		case RRCOMP_LOSSLESS:
+		{
+			Frame src(false);
+			src.init((unsigned char *)bits, h.width, h.width * 3, h.height, PF_RGB,
+				0);
+			src.hdr.x = h.x;  src.hdr.y = h.y;
+			if(rightEye) src.rbits = src.bits;
+			frame.decompressLossless(src, h.size, h.width, h.height, rightEye);
+			break;
+		}
+		case RRCOMP_YUV:
+			#ifdef TJ_NUMCS
+			TRY_TJ(tjDecodeYUV(tjhnd, bits, 4, TJSUBSAMP(h.subsamp), dst, h.width,
+				frame.pitch, h.height, TJPF_BGRX, 0));
+			break;
+			#else
+			THROW("YUV decoding requires libjpeg-turbo 1.4 or later");
+			#endif
+		default:
+			THROW("Unsupported compression type");
+	}
+	pixels += (double)h.width * (double)h.height;
+}
+
+
+LoopbackReceiver::LoopbackReceiver(double mbps, bool decode_, bool v21_) :
+	port(0), frames(0), bytes(0.), bytesPerSec(mbps * 1000000. / 8.),
+	tokens(0.), decode(decode_), v21(v21_), caps(0), arrivalTimes(NULL),
+	nArrivalTimes(0), listener(NULL), thread(NULL), nStreams(0)
+{
+	memset(streams, 0, sizeof(Stream *) * RR_MAXSTREAMS);
+	listener = new Socket(false);
+	try
+	{
+		port = listener->listen(0);
+		thread = new Thread(this);
+		thread->start();
+	}
+	catch(...)
+	{
+		delete listener;  listener = NULL;
+		throw;
+	}
+}
+
+
+LoopbackReceiver::~LoopbackReceiver(void)
+{
+	if(listener) listener->close();
+	if(thread) { thread->stop();  delete thread;  thread = NULL; }
+	for(int i = 0; i < RR_MAXSTREAMS; i++)
+	{
+		delete streams[i];  streams[i] = NULL;
+	}
+	delete listener;  listener = NULL;
+}
+
+
+void LoopbackReceiver::setArrivalLog(double *times, int n)
+{
+	arrivalTimes = times;  nArrivalTimes = n;
+}
+
+
+void LoopbackReceiver::run(void)
+{
+	try
+	{
+		rrstreams streamInfo;
+		Socket *sd = listener->accept();
+		streams[0] = new Stream(this, sd, 0);
+		caps = handshake(sd, streamInfo);
+		if(caps & RR_CAP_STREAMS) openStreams(streamInfo);
+		else nStreams = 1;
+
+		shapeTimer.start();
+		for(int i = 1; i < nStreams; i++) streams[i]->start();
+		streams[0]->run();
+	}
+	catch(...)
+	{
+		// The connection was closed.
+	}
+}
+
+
+// Perform the version and capabilities exchange on a new connection, in the
+// same manner as the VirtualGL Client, and return the capabilities that were
+// accepted.  If RR_CAP_STREAMS was accepted, then the server's rrstreams
+// structure is returned in streamInfo.
+
+unsigned int LoopbackReceiver::handshake(Socket *sd, rrstreams &streamInfo)
+{
+	rrframeheader_v1 h1;  rrversion v;  rrcaps c;
+
+	sd->recv((char *)&h1, sizeof_rrframeheader_v1);
+	memset(&v, 0, sizeof(rrversion));
+	memcpy(v.id, "VGL", 3);
+	v.major = 2;  v.minor = v21 ? 1 : 2;
+	sd->send((char *)&v, sizeof_rrversion);
+	sd->recv((char *)&v, sizeof_rrversion);
+	if(strncmp(v.id, "VGL", 3) || v.major < 1)
+		THROW("Error reading server version");
+	if(v21 || v.major < 2 || (v.major == 2 && v.minor < 2)) return 0;
+
+	sd->recv((char *)&c, sizeof_rrcaps);
+	ENDIANIZE_CAPS(c);
+	c.flags &= RR_CAP_TIMING | RR_CAP_STREAMS | RR_CAP_COMPACT | RR_CAP_LOSSLESS;
+	unsigned int accepted = c.flags;
+	ENDIANIZE_CAPS(c);
+	sd->send((char *)&c, sizeof_rrcaps);
+
+	if(accepted & RR_CAP_STREAMS)
+	{
+		sd->recv((char *)&streamInfo, sizeof_rrstreams);
+		ENDIANIZE_STREAMS(streamInfo);
+	}
+	return accepted;
+}
+
+
+// See the description of rrstreams in rr.h.  The server opens the additional
+// connections one at a time, as soon as we accept the number of connections
+// that it asked for, so they can be accepted in order on this thread.
+
+void LoopbackReceiver::openStreams(rrstreams &streamInfo)
+{
+	unsigned int key[2] = { streamInfo.key[0], streamInfo.key[1] };
+	int count = min(max((int)streamInfo.count, 1), RR_MAXSTREAMS);
+
+	if(streamInfo.index != 0) THROW("Additional connection received first");
+	streamInfo.count = count;
+	ENDIANIZE_STREAMS(streamInfo);
+	streams[0]->sd->send((char *)&streamInfo, sizeof_rrstreams);
+
+	for(int i = 1; i < count; i++)
+	{
+		Socket *sd = listener->accept();
+		streams[i] = new Stream(this, sd, i);
+		if(!(handshake(sd, streamInfo) & RR_CAP_STREAMS))
+			THROW("Server did not offer multiple connections");
+		bool valid = (streamInfo.index == (unsigned int)i
+			&& streamInfo.key[0] == key[0] && streamInfo.key[1] == key[1]);
+		if(!valid) streamInfo.index = 0;
+		ENDIANIZE_STREAMS(streamInfo);
+		sd->send((char *)&streamInfo, sizeof_rrstreams);
+		if(!valid) THROW("Additional connection does not belong to the session");
+	}
+
+	// The server sends the final number of connections once it has finished
+	// opening them.
+	streams[0]->sd->recv((char *)&streamInfo, sizeof_rrstreams);
+	ENDIANIZE_STREAMS(streamInfo);
+	if((int)streamInfo.count != count)
+		THROW("Server did not open all of the additional connections");
+	nStreams = count;
+}
+
+
+void LoopbackReceiver::addTile(rrframeheader &h, unsigned char *bits)
+{
+	CriticalSection::SafeLock l(mutex);
+	bytes += (double)h.size;
+	if(decode) decoder.decode(h, bits);
+}
+
+
+// Every connection carries the End-of-Frame marker, so a frame has arrived
+// once the marker has been received from all of them.
+
+void LoopbackReceiver::endOfFrame(Stream *stream, rrframeheader &h)
+{
+	CriticalSection::SafeLock l(mutex);
+	int complete = ++stream->eofs;
+
+	for(int i = 0; i < nStreams; i++)
+		complete = min(complete, streams[i]->eofs);
+	if(complete <= frames) return;
+	if(decode) decoder.decode(h, NULL);
+	if(arrivalTimes && h.winid < (unsigned int)nArrivalTimes)
+		arrivalTimes[h.winid] = clock.time();
+	frames++;
+}
+
+
+// The token bucket is shared by all of the connections, since they emulate a
+// single link.  The tokens for each chunk are taken before the chunk is read,
+// so the mutex is never held while waiting for data.
+
+void LoopbackReceiver::recvShaped(Socket *sd, char *data, int len)
+{
+	if(bytesPerSec <= 0.) { sd->recv(data, len);  return; }
+
+	while(len > 0)
+	{
+		int chunk = min(len, 16384);  long usec = 0;
+		{
+			CriticalSection::SafeLock l(shapeMutex);
+			tokens = min(bytesPerSec * 0.002 + (double)chunk,
+				tokens + shapeTimer.elapsed() * bytesPerSec);
+			shapeTimer.start();
+			tokens -= (double)chunk;
+			if(tokens < 0.) usec = (long)(-tokens / bytesPerSec * 1000000.);
+		}
+		if(usec > 0) usleep(usec);
+		sd->recv(data, chunk);
+		data += chunk;  len -= chunk;
+	}
+}
+
+
+LoopbackReceiver::Stream::Stream(LoopbackReceiver *parent_, Socket *sd_,
+	int index_) : sd(sd_), eofs(0), parent(parent_), index(index_),
+	thread(NULL), buf(NULL), bufSize(0), batch(NULL), batchSize(0),
+	batchLen(0), batchPos(0)
+{
+}
+
+
+LoopbackReceiver::Stream::~Stream(void)
+{
+	if(thread) { thread->stop();  delete thread;  thread = NULL; }
+	delete sd;  sd = NULL;
+	free(buf);  buf = NULL;
+	free(batch);  batch = NULL;
+}
+
+
+void LoopbackReceiver::Stream::start(void)
+{
+	thread = new Thread(this);
+	thread->start();
+}
+
+
+void LoopbackReceiver::Stream::run(void)
+{
+	rrframeheader h;
+
+	try
+	{
+		while(true)
+		{
+			readHeader(h);
+			if(h.flags == RR_EOF)
+			{
+				if(index == 0 && (parent->caps & RR_CAP_TIMING))
+				{
+					rrframetiming timing;
+					read((char *)&timing, sizeof_rrframetiming);
+				}
+				parent->endOfFrame(this, h);
+				continue;
+			}
+			if(h.flags & RR_SHMDATA)
+				THROW("Server sent shared memory data without negotiating it");
+			if(h.size > bufSize)
+			{
+				free(buf);
+				if((buf = (unsigned char *)malloc(h.size)) == NULL)
+					THROW("Memory allocation error");
+				bufSize = h.size;
+			}
+			read((char *)buf, h.size);
+			parent->addTile(h, buf);
+		}
+	}
+	catch(...)
+	{
+		// The connection was closed.
+	}
+}
+
+
+// Read a header, either as-is or as a compact record.  Batches are read in
+// their entirety, and then the headers and image data are read from them.
+
+void LoopbackReceiver::Stream::readHeader(rrframeheader &h)
+{
+	if(!(parent->caps & RR_CAP_COMPACT))
+	{
+		read((char *)&h, sizeof_rrframeheader);
+		ENDIANIZE(h);
+		return;
+	}
+
+	while(true)
+	{
+		unsigned char rec[RR_MAXRECORD], *ptr = rec;  unsigned int len = 0;
+
+		if(batchPos < batchLen)
+		{
+			len = batch[batchPos++];
+			if(len < 1 || len > batchLen - batchPos)
+				THROW("Malformed batch received from server");
+			ptr = &batch[batchPos];  batchPos += len;
+		}
+		else
+		{
+			unsigned char len8 = 0;
+			parent->recvShaped(sd, (char *)&len8, 1);
+			if((len = len8) < 1 || len > RR_MAXRECORD)
+				THROW("Malformed header received from server");
+			parent->recvShaped(sd, (char *)rec, len);
+		}
+
+		unsigned int n = codec.decode(ptr, len, h);
+		if(n == 0) return;
+
+		if(batchPos < batchLen) THROW("Nested batch received from server");
+		if(n > RR_MAXBATCH) THROW("Batch received from server is too large");
+		if(n > batchSize)
+		{
+			unsigned char *newBatch = (unsigned char *)realloc(batch, n);
+			if(!newBatch) THROW("Memory allocation error");
+			batch = newBatch;  batchSize = n;
+		}
+		batchLen = batchPos = 0;
+		parent->recvShaped(sd, (char *)batch, n);
+		batchLen = n;
+	}
+}
+
+
+void LoopbackReceiver::Stream::read(char *data, int len)
+{
+	if(batchPos < batchLen)
+	{
+		if(len < 0 || (unsigned int)len > batchLen - batchPos)
+			THROW("Malformed batch received from server");
+		memcpy(data, &batch[batchPos], len);
+		batchPos += len;
+	}
+	else parent->recvShaped(sd, data, len);
+}
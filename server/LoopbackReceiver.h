@@ -0,0 +1,135 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __LOOPBACKRECEIVER_H__
+#define __LOOPBACKRECEIVER_H__
+
+#include "Socket.h"
+#include "Thread.h"
+#include "Timer.h"
+#include "Frame.h"
+#include "CompactHeader.h"
+
+
+namespace server
+{
+	// Decodes VGL Transport tiles into an off-screen BGRX frame, in the same
+	// manner as the VirtualGL Client but without an X server
+
+	class TileDecoder
+	{
+		public:
+
+			TileDecoder(void);
+			~TileDecoder(void);
+			void decode(rrframeheader &h, const unsigned char *bits);
+
+			int frames;
+			double pixels;
+
+		private:
+
+			common::Frame frame;
+			tjhandle tjhnd;
+	};
+
+
+	// In-process VGL Transport receiver, used by the unit tests and benchmarks
+	// in place of the VirtualGL Client.  It listens on a loopback port,
+	// optionally decodes the tiles that it receives, and optionally emulates a
+	// bandwidth-limited network link (similar to a tc token bucket filter) by
+	// reading from the socket no faster than the specified rate.
+	//
+	// The receiver negotiates protocol v2.2 and accepts the same capabilities
+	// as the VirtualGL Client, except for the shared-memory transport (which
+	// would bypass the emulated link.)  If v21 is true, then it acts as a v2.1
+	// client, so that the server's fallback path can be tested.
+
+	class LoopbackReceiver : public util::Runnable
+	{
+		public:
+
+			LoopbackReceiver(double mbps = 0., bool decode = false,
+				bool v21 = false);
+			virtual ~LoopbackReceiver(void);
+			unsigned short getPort(void) { return port; }
+			int getFrames(void) { return frames; }
+			double getBytes(void) { return bytes; }
+			const TileDecoder &getDecoder(void) { return decoder; }
+
+			// Return the capabilities (RR_CAP_*) that were negotiated with the
+			// server and the number of connections that the server opened.  These
+			// are valid once the first frame has arrived.
+			unsigned int getCaps(void) { return caps; }
+			int getStreams(void) { return nStreams; }
+
+			// Record the time (as returned by util::Timer::time()) at which the
+			// end-of-frame marker for window ID i arrives in times[i], for
+			// 0 <= i < n.  Benchmarks can use this to measure latency by using a
+			// sequence number as the window ID.
+			void setArrivalLog(double *times, int n);
+
+			void run(void);
+
+		private:
+
+			// Reads headers and tiles from one of the server's connections
+			class Stream : public util::Runnable
+			{
+				public:
+
+					Stream(LoopbackReceiver *parent, util::Socket *sd, int index);
+					virtual ~Stream(void);
+					void start(void);
+					void run(void);
+
+					util::Socket *sd;
+					int eofs;
+
+				private:
+
+					void readHeader(rrframeheader &h);
+					void read(char *data, int len);
+
+					LoopbackReceiver *parent;
+					int index;
+					util::Thread *thread;
+					common::CompactHeader codec;
+					unsigned char *buf;  unsigned int bufSize;
+					unsigned char *batch;
+					unsigned int batchSize, batchLen, batchPos;
+			};
+
+			unsigned int handshake(util::Socket *sd, rrstreams &streamInfo);
+			void openStreams(rrstreams &streamInfo);
+			void addTile(rrframeheader &h, unsigned char *bits);
+			void endOfFrame(Stream *stream, rrframeheader &h);
+			void recvShaped(util::Socket *sd, char *data, int len);
+
+			unsigned short port;
+			volatile int frames;
+			volatile double bytes;
+			double bytesPerSec, tokens;
+			bool decode, v21;
+			volatile unsigned int caps;
+			TileDecoder decoder;
+			util::Timer shapeTimer, clock;
+			double *arrivalTimes;  int nArrivalTimes;
+			util::Socket *listener;
+			util::Thread *thread;
+			Stream *streams[RR_MAXSTREAMS];
+			volatile int nStreams;
+			util::CriticalSection mutex, shapeMutex;
+	};
+}
+
+#endif  // __LOOPBACKRECEIVER_H__
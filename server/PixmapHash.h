@@ -16,12 +16,13 @@
 
 #include "VirtualPixmap.h"
 #include "Hash.h"
+#include "faker.h"
 #ifdef USEHELGRIND
 	#include <valgrind/helgrind.h>
 #endif
 
 
-#define HASH  Hash<char *, Pixmap, VirtualPixmap *>
+#define HASH  Hash<DisplayID, Pixmap, VirtualPixmap *>
 
 // This maps a 2D pixmap ID on the 2D X Server to a VirtualPixmap instance,
 // which encapsulates the corresponding 3D pixmap on the 3D X Server
@@ -50,15 +51,13 @@ namespace faker
 			void add(Display *dpy, Pixmap pm, VirtualPixmap *vpm)
 			{
 				if(!dpy || !pm) THROW("Invalid argument");
-				char *dpystring = strdup(DisplayString(dpy));
-				if(!HASH::add(dpystring, pm, vpm))
-					free(dpystring);
+				HASH::add(getDisplayID(dpy), pm, vpm);
 			}
 
 			VirtualPixmap *find(Display *dpy, Pixmap pm)
 			{
 				if(!dpy || !pm) return NULL;
-				return HASH::find(DisplayString(dpy), pm);
+				return HASH::find(getDisplayID(dpy), pm);
 			}
 
 			Pixmap reverseFind(GLXDrawable glxd)
@@ -66,7 +65,7 @@ namespace faker
 				if(!glxd) return 0;
 				HashEntry *ptr = NULL;
 				util::CriticalSection::SafeLock l(mutex);
-				if((ptr = HASH::findEntry(NULL, glxd)) != NULL)
+				if((ptr = HASH::findEntry(0, glxd)) != NULL)
 					return ptr->key2;
 				return 0;
 			}
@@ -74,7 +73,7 @@ namespace faker
 			void remove(Display *dpy, GLXPixmap glxpm)
 			{
 				if(!dpy || !glxpm) THROW("Invalid argument");
-				HASH::remove(DisplayString(dpy), glxpm);
+				HASH::remove(getDisplayID(dpy), glxpm);
 			}
 
 		private:
@@ -86,20 +85,16 @@ namespace faker
 
 			void detach(HashEntry *entry)
 			{
-				if(entry)
-				{
-					free(entry->key1);
-					delete entry->value;
-				}
+				if(entry) delete entry->value;
 			}
 
-			bool compare(char *key1, Pixmap key2, HashEntry *entry)
+			bool compare(DisplayID key1, Pixmap key2, HashEntry *entry)
 			{
 				VirtualPixmap *vpm = entry->value;
 				return (
-					(key1 && !strcasecmp(key1, entry->key1)
+					(key1 && key1 == entry->key1
 						&& (key2 == entry->key2 || (vpm && key2 == vpm->getGLXDrawable())))
-					|| (key1 == NULL && key2 == vpm->getGLXDrawable())
+					|| (key1 == 0 && key2 == vpm->getGLXDrawable())
 				);
 			}
 
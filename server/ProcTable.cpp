@@ -0,0 +1,461 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ProcTable.h"
+#include "faker-sym.h"
+
+using namespace faker;
+
+
+// For optional libGL symbols, the interposed function is returned only if the
+// underlying function actually exists in libGL.
+
+#define DEFINE_OPT_CHECK(f) \
+	static bool check_##f(void) \
+	{ \
+		CHECKSYM_NONFATAL(f) \
+		return __##f != NULL; \
+	}
+
+DEFINE_OPT_CHECK(glXCreateContextAttribsARB)
+DEFINE_OPT_CHECK(glXFreeContextEXT)
+DEFINE_OPT_CHECK(glXImportContextEXT)
+DEFINE_OPT_CHECK(glXQueryContextInfoEXT)
+DEFINE_OPT_CHECK(glXBindTexImageEXT)
+DEFINE_OPT_CHECK(glXReleaseTexImageEXT)
+
+
+typedef struct
+{
+	const char *name;
+	ProcAddr addr;
+	int apis;
+	bool (*isAvailable)(void);
+} ProcEntry;
+
+#define PROC(f, apis)  { #f, (ProcAddr)f, apis, NULL }
+#define OPT_PROC(f, apis)  { #f, (ProcAddr)f, apis, check_##f }
+
+// If the 3D application requests the address of a function that we are
+// interposing, then we need to return the address of the interposed function.
+
+static const ProcEntry procs[] =
+{
+	// GLX 1.0
+	PROC(glXChooseVisual, PROC_GLX),
+	PROC(glXCopyContext, PROC_GLX),
+	PROC(glXCreateContext, PROC_GLX),
+	PROC(glXCreateGLXPixmap, PROC_GLX),
+	PROC(glXDestroyContext, PROC_GLX),
+	PROC(glXDestroyGLXPixmap, PROC_GLX),
+	PROC(glXGetConfig, PROC_GLX),
+	PROC(glXGetCurrentContext, PROC_GLX),
+	PROC(glXGetCurrentDrawable, PROC_GLX),
+	PROC(glXIsDirect, PROC_GLX),
+	PROC(glXMakeCurrent, PROC_GLX),
+	PROC(glXQueryExtension, PROC_GLX),
+	PROC(glXQueryVersion, PROC_GLX),
+	PROC(glXSwapBuffers, PROC_GLX),
+	PROC(glXUseXFont, PROC_GLX),
+	PROC(glXWaitGL, PROC_GLX),
+
+	// GLX 1.1
+	PROC(glXGetClientString, PROC_GLX),
+	PROC(glXQueryServerString, PROC_GLX),
+	PROC(glXQueryExtensionsString, PROC_GLX),
+
+	// GLX 1.2
+	PROC(glXGetCurrentDisplay, PROC_GLX),
+
+	// GLX 1.3
+	PROC(glXChooseFBConfig, PROC_GLX),
+	PROC(glXCreateNewContext, PROC_GLX),
+	PROC(glXCreatePbuffer, PROC_GLX),
+	PROC(glXCreatePixmap, PROC_GLX),
+	PROC(glXCreateWindow, PROC_GLX),
+	PROC(glXDestroyPbuffer, PROC_GLX),
+	PROC(glXDestroyPixmap, PROC_GLX),
+	PROC(glXDestroyWindow, PROC_GLX),
+	PROC(glXGetCurrentReadDrawable, PROC_GLX),
+	PROC(glXGetFBConfigAttrib, PROC_GLX),
+	PROC(glXGetFBConfigs, PROC_GLX),
+	PROC(glXGetSelectedEvent, PROC_GLX),
+	PROC(glXGetVisualFromFBConfig, PROC_GLX),
+	PROC(glXMakeContextCurrent, PROC_GLX),
+	PROC(glXQueryContext, PROC_GLX),
+	PROC(glXQueryDrawable, PROC_GLX),
+	PROC(glXSelectEvent, PROC_GLX),
+
+	// GLX 1.4
+	PROC(glXGetProcAddress, PROC_GLX),
+
+	// GLX_ARB_create_context
+	OPT_PROC(glXCreateContextAttribsARB, PROC_GLX),
+
+	// GLX_ARB_get_proc_address
+	PROC(glXGetProcAddressARB, PROC_GLX),
+
+	// GLX_EXT_import_context
+	OPT_PROC(glXFreeContextEXT, PROC_GLX),
+	PROC(glXGetCurrentDisplayEXT, PROC_GLX),
+	OPT_PROC(glXImportContextEXT, PROC_GLX),
+	OPT_PROC(glXQueryContextInfoEXT, PROC_GLX),
+
+	// GLX_EXT_swap_control
+	PROC(glXSwapIntervalEXT, PROC_GLX),
+
+	// GLX_EXT_texture_from_pixmap
+	OPT_PROC(glXBindTexImageEXT, PROC_GLX),
+	OPT_PROC(glXReleaseTexImageEXT, PROC_GLX),
+
+	// GLX_SGI_make_current_read
+	PROC(glXGetCurrentReadDrawableSGI, PROC_GLX),
+	PROC(glXMakeCurrentReadSGI, PROC_GLX),
+
+	// GLX_SGI_swap_control
+	PROC(glXSwapIntervalSGI, PROC_GLX),
+
+	// GLX_SGIX_fbconfig
+	PROC(glXChooseFBConfigSGIX, PROC_GLX),
+	PROC(glXCreateContextWithConfigSGIX, PROC_GLX),
+	PROC(glXCreateGLXPixmapWithConfigSGIX, PROC_GLX),
+	PROC(glXGetFBConfigAttribSGIX, PROC_GLX),
+	PROC(glXGetFBConfigFromVisualSGIX, PROC_GLX),
+	PROC(glXGetVisualFromFBConfigSGIX, PROC_GLX),
+
+	// GLX_SGIX_pbuffer
+	PROC(glXCreateGLXPbufferSGIX, PROC_GLX),
+	PROC(glXDestroyGLXPbufferSGIX, PROC_GLX),
+	PROC(glXGetSelectedEventSGIX, PROC_GLX),
+	PROC(glXQueryGLXPbufferSGIX, PROC_GLX),
+	PROC(glXSelectEventSGIX, PROC_GLX),
+
+	// EGL 1.0
+	PROC(eglChooseConfig, PROC_EGL),
+	PROC(eglCopyBuffers, PROC_EGL),
+	PROC(eglCreateContext, PROC_EGL),
+	PROC(eglCreatePbufferSurface, PROC_EGL),
+	PROC(eglCreatePixmapSurface, PROC_EGL),
+	PROC(eglCreateWindowSurface, PROC_EGL),
+	PROC(eglDestroyContext, PROC_EGL),
+	PROC(eglDestroySurface, PROC_EGL),
+	PROC(eglGetConfigAttrib, PROC_EGL),
+	PROC(eglGetConfigs, PROC_EGL),
+	PROC(eglGetCurrentDisplay, PROC_EGL),
+	PROC(eglGetCurrentSurface, PROC_EGL),
+	PROC(eglGetDisplay, PROC_EGL),
+	PROC(eglGetError, PROC_EGL),
+	PROC(eglGetProcAddress, PROC_EGL),
+	PROC(eglInitialize, PROC_EGL),
+	PROC(eglMakeCurrent, PROC_EGL),
+	PROC(eglQueryContext, PROC_EGL),
+	PROC(eglQueryString, PROC_EGL),
+	PROC(eglQuerySurface, PROC_EGL),
+	PROC(eglSwapBuffers, PROC_EGL),
+	PROC(eglTerminate, PROC_EGL),
+
+	// EGL 1.1
+	PROC(eglBindTexImage, PROC_EGL),
+	PROC(eglReleaseTexImage, PROC_EGL),
+	PROC(eglSurfaceAttrib, PROC_EGL),
+	PROC(eglSwapInterval, PROC_EGL),
+
+	// EGL 1.2
+	PROC(eglCreatePbufferFromClientBuffer, PROC_EGL),
+
+	// EGL 1.5
+	PROC(eglClientWaitSync, PROC_EGL),
+	PROC(eglCreateImage, PROC_EGL),
+	PROC(eglCreatePlatformPixmapSurface, PROC_EGL),
+	PROC(eglCreatePlatformWindowSurface, PROC_EGL),
+	PROC(eglCreateSync, PROC_EGL),
+	PROC(eglDestroyImage, PROC_EGL),
+	PROC(eglDestroySync, PROC_EGL),
+	PROC(eglGetPlatformDisplay, PROC_EGL),
+	PROC(eglGetSyncAttrib, PROC_EGL),
+	PROC(eglWaitSync, PROC_EGL),
+
+	// EGL_EXT_device_query
+	PROC(eglQueryDisplayAttribEXT, PROC_EGL),
+
+	// EGL_EXT_platform_base
+	PROC(eglCreatePlatformPixmapSurfaceEXT, PROC_EGL),
+	PROC(eglCreatePlatformWindowSurfaceEXT, PROC_EGL),
+	PROC(eglGetPlatformDisplayEXT, PROC_EGL),
+
+	// EGL_EXT_swap_buffers_with_damage
+	PROC(eglSwapBuffersWithDamageEXT, PROC_EGL),
+
+	// EGL_KHR_cl_event2
+	PROC(eglCreateSync64KHR, PROC_EGL),
+
+	// EGL_KHR_fence_sync
+	PROC(eglClientWaitSyncKHR, PROC_EGL),
+	PROC(eglCreateSyncKHR, PROC_EGL),
+	PROC(eglDestroySyncKHR, PROC_EGL),
+	PROC(eglGetSyncAttribKHR, PROC_EGL),
+
+	// EGL_KHR_image
+	PROC(eglCreateImageKHR, PROC_EGL),
+	PROC(eglDestroyImageKHR, PROC_EGL),
+
+	// EGL_KHR_reusable_sync
+	PROC(eglSignalSyncKHR, PROC_EGL),
+
+	// EGL_KHR_swap_buffers_with_damage
+	PROC(eglSwapBuffersWithDamageKHR, PROC_EGL),
+
+	// EGL_KHR_wait_sync
+	PROC(eglWaitSyncKHR, PROC_EGL),
+
+	// OpenGL
+	PROC(glBindFramebuffer, PROC_GLX | PROC_EGL),
+	PROC(glBindFramebufferEXT, PROC_GLX | PROC_EGL),
+	PROC(glDeleteFramebuffers, PROC_GLX | PROC_EGL),
+	PROC(glDeleteFramebuffersEXT, PROC_GLX | PROC_EGL),
+	PROC(glFinish, PROC_GLX | PROC_EGL),
+	PROC(glFlush, PROC_GLX | PROC_EGL),
+	PROC(glDrawBuffer, PROC_GLX | PROC_EGL),
+	PROC(glDrawBuffers, PROC_GLX | PROC_EGL),
+	PROC(glDrawBuffersARB, PROC_GLX | PROC_EGL),
+	PROC(glDrawBuffersATI, PROC_GLX | PROC_EGL),
+	PROC(glFramebufferDrawBufferEXT, PROC_GLX | PROC_EGL),
+	PROC(glFramebufferDrawBuffersEXT, PROC_GLX | PROC_EGL),
+	PROC(glFramebufferReadBufferEXT, PROC_GLX | PROC_EGL),
+	PROC(glGetBooleanv, PROC_GLX | PROC_EGL),
+	PROC(glGetDoublev, PROC_GLX | PROC_EGL),
+	PROC(glGetFloatv, PROC_GLX | PROC_EGL),
+	PROC(glGetFramebufferAttachmentParameteriv, PROC_GLX | PROC_EGL),
+	PROC(glGetFramebufferParameteriv, PROC_GLX | PROC_EGL),
+	PROC(glGetIntegerv, PROC_GLX | PROC_EGL),
+	PROC(glGetInteger64v, PROC_GLX | PROC_EGL),
+	PROC(glGetNamedFramebufferParameteriv, PROC_GLX | PROC_EGL),
+	PROC(glGetString, PROC_GLX | PROC_EGL),
+	PROC(glGetStringi, PROC_GLX | PROC_EGL),
+	PROC(glNamedFramebufferDrawBuffer, PROC_GLX | PROC_EGL),
+	PROC(glNamedFramebufferDrawBuffers, PROC_GLX | PROC_EGL),
+	PROC(glNamedFramebufferReadBuffer, PROC_GLX | PROC_EGL),
+	PROC(glPopAttrib, PROC_GLX | PROC_EGL),
+	PROC(glReadBuffer, PROC_GLX | PROC_EGL),
+	PROC(glReadPixels, PROC_GLX | PROC_EGL),
+	PROC(glScissor, PROC_GLX | PROC_EGL),
+	PROC(glViewport, PROC_GLX | PROC_EGL),
+};
+
+#define NPROCS  (int)(sizeof(procs) / sizeof(ProcEntry))
+
+
+// The table of interposed functions is indexed using a perfect hash
+// (hash-and-displace.)  Each name is hashed once, and the first half of the
+// hash selects a bucket.  The displacement stored for that bucket is combined
+// with the second half of the hash to select a slot, and the displacements are
+// chosen when the table is built such that no two names occupy the same slot.
+// Thus, a lookup never has to compare the name against more than one entry.
+
+#define NBUCKETS  64
+#define SLOTBITS  9
+#define NSLOTS  (1 << SLOTBITS)
+#define MAXDISP  65535
+
+static unsigned short disp[NBUCKETS];
+static const ProcEntry *slots[NSLOTS];
+static pthread_once_t tableOnce = PTHREAD_ONCE_INIT;
+static bool tableError = false;
+
+
+static void hashName(const char *name, unsigned int &h1, unsigned int &h2)
+{
+	// 64-bit FNV-1a
+	unsigned long long h = 14695981039346656037ULL;
+	for(const unsigned char *ptr = (const unsigned char *)name; *ptr; ptr++)
+	{
+		h ^= *ptr;  h *= 1099511628211ULL;
+	}
+	h1 = (unsigned int)h;  h2 = (unsigned int)(h >> 32);
+}
+
+
+static inline int getSlot(unsigned int h2, unsigned int d)
+{
+	return (int)(((h2 + d * 0x9E3779B9U) * 0x85EBCA6BU) >> (32 - SLOTBITS));
+}
+
+
+static void buildTable(void)
+{
+	int bucketOf[NPROCS], order[NBUCKETS], count[NBUCKETS];
+	unsigned int h1[NPROCS], h2[NPROCS];
+
+	memset(count, 0, sizeof(count));
+	for(int i = 0; i < NPROCS; i++)
+	{
+		hashName(procs[i].name, h1[i], h2[i]);
+		bucketOf[i] = h1[i] & (NBUCKETS - 1);
+		count[bucketOf[i]]++;
+	}
+
+	// Place the largest buckets first, since they are the hardest to place.
+	for(int b = 0; b < NBUCKETS; b++) order[b] = b;
+	for(int b = 1; b < NBUCKETS; b++)
+	{
+		int tmp = order[b], j = b;
+		for(; j > 0 && count[order[j - 1]] < count[tmp]; j--)
+			order[j] = order[j - 1];
+		order[j] = tmp;
+	}
+
+	memset(disp, 0, sizeof(disp));
+	memset(slots, 0, sizeof(slots));
+	for(int b = 0; b < NBUCKETS && count[order[b]] > 0; b++)
+	{
+		int bucket = order[b];
+		unsigned int d;
+
+		for(d = 1; d <= MAXDISP; d++)
+		{
+			int i, j;
+			for(i = 0; i < NPROCS; i++)
+			{
+				if(bucketOf[i] != bucket) continue;
+				int slot = getSlot(h2[i], d);
+				if(slots[slot]) break;
+				// Check for a collision with another name in the same bucket
+				for(j = 0; j < i; j++)
+					if(bucketOf[j] == bucket && getSlot(h2[j], d) == slot) break;
+				if(j < i) break;
+			}
+			if(i == NPROCS) break;
+		}
+		// An exception must not propagate through pthread_once(), so the caller
+		// throws it.
+		if(d > MAXDISP) { tableError = true;  return; }
+
+		disp[bucket] = (unsigned short)d;
+		for(int i = 0; i < NPROCS; i++)
+			if(bucketOf[i] == bucket) slots[getSlot(h2[i], d)] = &procs[i];
+	}
+}
+
+
+namespace faker
+{
+	ProcAddr getFakedProcAddress(const char *name, int api)
+	{
+		if(!name) return NULL;
+
+		pthread_once(&tableOnce, buildTable);
+		if(tableError) THROW("Could not build table of interposed functions");
+
+		unsigned int h1, h2;
+		hashName(name, h1, h2);
+		unsigned int d = disp[h1 & (NBUCKETS - 1)];
+		if(!d) return NULL;
+		const ProcEntry *entry = slots[getSlot(h2, d)];
+		if(!entry || !(entry->apis & api) || strcmp(entry->name, name))
+			return NULL;
+		if(entry->isAvailable && !entry->isAvailable()) return NULL;
+		return entry->addr;
+	}
+
+
+	// The results of the underlying glXGetProcAddress() and eglGetProcAddress()
+	// functions are cached in an open-addressed hash table that grows as
+	// needed.  The table is read without locking, so an entry's name is stored
+	// (with release semantics) only after the rest of the entry, and a new
+	// table is published only after it has been filled in.  Tables that have
+	// been outgrown are never freed, because another thread may still be
+	// reading them.  (They occupy less memory in total than the current table.)
+
+	typedef struct
+	{
+		char *name;
+		unsigned int hash;
+		int api;
+		ProcAddr addr;
+	} CacheEntry;
+
+	typedef struct
+	{
+		int size;
+		CacheEntry *entries;
+	} Cache;
+
+	static Cache *cache = NULL;
+	static int cacheEntries = 0;
+
+
+	static CacheEntry *findCacheEntry(Cache *table, const char *name,
+		unsigned int hash, int api)
+	{
+		int size = table->size;
+		for(int i = hash & (size - 1); ; i = (i + 1) & (size - 1))
+		{
+			CacheEntry *entry = &table->entries[i];
+			char *entryName = __atomic_load_n(&entry->name, __ATOMIC_ACQUIRE);
+			if(!entryName
+				|| (entry->hash == hash && entry->api == api
+					&& !strcmp(entryName, name)))
+				return entry;
+		}
+	}
+
+
+	ProcAddr getRealProcAddress(const char *name, int api)
+	{
+		unsigned int hash, h2;
+		ProcAddr addr;
+
+		if(!name) return NULL;
+		hashName(name, hash, h2);
+
+		Cache *table = __atomic_load_n(&cache, __ATOMIC_ACQUIRE);
+		if(table)
+		{
+			CacheEntry *entry = findCacheEntry(table, name, hash, api);
+			if(entry->name) return entry->addr;
+		}
+
+		if(api == PROC_EGL) addr = _eglGetProcAddress(name);
+		else addr = _glXGetProcAddress((const GLubyte *)name);
+
+		GlobalCriticalSection::SafeLock l(globalMutex);
+		if(!cache || (cacheEntries + 1) * 2 > cache->size)
+		{
+			Cache *newCache = (Cache *)malloc(sizeof(Cache));
+			if(!newCache) return addr;
+			newCache->size = cache ? cache->size * 2 : 1024;
+			newCache->entries =
+				(CacheEntry *)calloc(newCache->size, sizeof(CacheEntry));
+			if(!newCache->entries) { free(newCache);  return addr; }
+			for(int i = 0; cache && i < cache->size; i++)
+			{
+				CacheEntry *old = &cache->entries[i];
+				if(!old->name) continue;
+				*findCacheEntry(newCache, old->name, old->hash, old->api) = *old;
+			}
+			__atomic_store_n(&cache, newCache, __ATOMIC_RELEASE);
+		}
+		CacheEntry *entry = findCacheEntry(cache, name, hash, api);
+		if(!entry->name)
+		{
+			char *entryName = strdup(name);
+			if(!entryName) return addr;
+			entry->hash = hash;  entry->api = api;  entry->addr = addr;
+			__atomic_store_n(&entry->name, entryName, __ATOMIC_RELEASE);
+			cacheEntries++;
+		}
+		return entry->addr;
+	}
+}
@@ -0,0 +1,40 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __PROCTABLE_H__
+#define __PROCTABLE_H__
+
+
+// APIs through which an interposed function can be obtained
+#define PROC_GLX  1  // glXGetProcAddress[ARB]()
+#define PROC_EGL  2  // eglGetProcAddress()
+
+
+namespace faker
+{
+	typedef void (*ProcAddr)(void);
+
+	// Return the address of the interposed function with the specified name, or
+	// NULL if the function is not interposed (or is not available through the
+	// specified API.)  The table of interposed functions is shared by the GLX
+	// and EGL front ends and is indexed using a perfect hash, so each lookup
+	// requires only one hash computation and one string comparison.
+	ProcAddr getFakedProcAddress(const char *name, int api);
+
+	// Return the address of the underlying function with the specified name,
+	// as reported by the underlying glXGetProcAddress() or eglGetProcAddress()
+	// function.  The result is cached, so subsequent lookups of the same name
+	// do not call down to the underlying implementation.
+	ProcAddr getRealProcAddress(const char *name, int api);
+}
+
+#endif  // __PROCTABLE_H__
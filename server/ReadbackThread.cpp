@@ -0,0 +1,175 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "ReadbackThread.h"
+#include "VirtualWin.h"
+#include "backend.h"
+#include "faker.h"
+#include "fakerconfig.h"
+
+using namespace util;
+using namespace faker;
+
+
+ReadbackThread::ReadbackThread(VirtualWin *vw_, Display *dpy_,
+	VGLFBConfig config_, Bool direct_) : vw(vw_), dpy(dpy_), config(config_),
+	direct(direct_), ctx(0), shareCtx(0), pbo(0), fence(0), useFence(false),
+	busy(false), deadYet(false), draw(0), boundDraw(0), thread(NULL)
+{
+	if(!vw || !dpy || !config) THROW("Invalid argument");
+	ready.wait();  bound.wait();  done.wait();
+	thread = new Thread(this);
+	try
+	{
+		thread->start();
+	}
+	catch(...)
+	{
+		delete thread;  thread = NULL;
+		throw;
+	}
+}
+
+
+ReadbackThread::~ReadbackThread(void)
+{
+	try
+	{
+		wait();
+	}
+	catch(std::exception &e)
+	{
+		if(fconfig.verbose)
+			vglout.println("[VGL] WARNING: %s", e.what());
+	}
+	deadYet = true;
+	ready.signal();
+	if(thread) { thread->stop();  delete thread;  thread = NULL; }
+	// The fence belongs to the application's share group, so it can only be
+	// deleted while one of the application's contexts is current.
+	if(fence && shareCtx && backend::getCurrentContext() == shareCtx)
+		_glDeleteSync(fence);
+	fence = 0;
+	if(ctx) { backend::destroyContext(dpy, ctx);  ctx = 0; }
+}
+
+
+// Ensure that the readback thread cannot read the off-screen drawable before
+// the GPU has finished rendering the frame.  This must be called before the
+// off-screen drawable is swapped.
+
+void ReadbackThread::insertFence(void)
+{
+	GLXContext appCtx = backend::getCurrentContext();
+
+	if(!ctx)
+	{
+		// Sync objects are shared among contexts in the same share group, so the
+		// readback context must share objects with the application's context.
+		if((ctx = backend::createContext(dpy, config, appCtx, direct,
+			NULL)) == 0)
+			THROW("Could not create OpenGL context for threaded readback");
+		shareCtx = appCtx;
+		if(appCtx)
+		{
+			const char *version = (const char *)_glGetString(GL_VERSION);
+			const char *ext = (const char *)_glGetString(GL_EXTENSIONS);
+			int major = 0, minor = 0;
+			if(version) sscanf(version, "%d.%d", &major, &minor);
+			useFence = (major > 3 || (major == 3 && minor >= 2)
+				|| (ext && strstr(ext, "GL_ARB_sync")));
+		}
+		if(fconfig.verbose)
+			vglout.println("[VGL] Using threaded readback (%s)",
+				useFence ? "fence" : "glFinish()");
+	}
+
+	if(fence) { _glDeleteSync(fence);  fence = 0; }
+	if(!appCtx) return;
+	if(appCtx == shareCtx && useFence)
+		fence = _glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// A fence that has not been flushed might never be signaled, from the point
+	// of view of another context.
+	if(fence) _glFlush();
+	else _glFinish();
+}
+
+
+void ReadbackThread::post(GLXDrawable draw_)
+{
+	if(!ctx) THROW("insertFence() must be called before post()");
+	wait();
+	draw = draw_;
+	bool rebind = (draw != boundDraw);
+	busy = true;
+	ready.signal();
+	// Binding the context involves an X request on the 3D X server connection,
+	// which is not thread-safe, so the rendering thread waits for it.
+	if(rebind) bound.wait();
+}
+
+
+void ReadbackThread::wait(void)
+{
+	if(!busy) return;
+	done.wait();
+	busy = false;
+	if(error)
+	{
+		Error e = error;
+		error = Error();
+		throw e;
+	}
+}
+
+
+void ReadbackThread::run(void)
+{
+	while(true)
+	{
+		ready.wait();
+		if(deadYet) break;
+
+		try
+		{
+			if(draw != boundDraw)
+			{
+				XLockDisplay(DPY3D);
+				Bool ret = backend::makeCurrent(dpy, draw, draw, ctx);
+				XUnlockDisplay(DPY3D);
+				boundDraw = ret ? draw : 0;
+				bound.signal();
+				if(!ret)
+					THROW("Could not bind OpenGL context to off-screen drawable");
+			}
+			if(fence)
+			{
+				_glClientWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+				_glDeleteSync(fence);
+				fence = 0;
+			}
+			vw->readbackFromThread();
+		}
+		catch(std::exception &e)
+		{
+			error = e;
+		}
+		done.signal();
+	}
+
+	if(boundDraw)
+	{
+		XLockDisplay(DPY3D);
+		backend::makeCurrent(dpy, 0, 0, 0);
+		XUnlockDisplay(DPY3D);
+	}
+}
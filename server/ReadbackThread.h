@@ -0,0 +1,83 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __READBACKTHREAD_H__
+#define __READBACKTHREAD_H__
+
+#include "glxvisual.h"
+#include "Thread.h"
+
+
+namespace faker
+{
+	class VirtualWin;
+
+	// With VGL_READBACK=thread, each VirtualWin that uses the VGL Transport owns
+	// one of these.  The thread keeps its own OpenGL context, which shares
+	// objects with the application's context, permanently bound to the
+	// off-screen drawable, so the rendering thread never has to switch contexts
+	// in order to read back a frame.  When the application swaps buffers, the
+	// rendering thread inserts a fence into its command stream (insertFence()),
+	// swaps the off-screen drawable, and hands off the frame (post()).  This
+	// thread then waits on the fence and calls VirtualWin::readbackFromThread(),
+	// which reads back the front buffer, applies gamma correction, and passes
+	// the frame to the image transport.
+	//
+	// All methods other than run() must be called from the rendering thread.
+	// The rendering thread must call wait() before it modifies any state that
+	// readbackFromThread() uses.  This thread never acquires the VirtualWin
+	// mutex, so it is safe to call wait() with the mutex held.
+	//
+	// This thread makes no requests on the 2D X server connection.  Its only
+	// requests on the 3D X server connection are the GLX requests that bind and
+	// unbind its context, and the rendering thread is blocked while those are
+	// made.  They are also made with the 3D X display locked, but that protects
+	// them from the application's other threads only if the application called
+	// XInitThreads(), which it must do anyway if more than one of its threads
+	// uses GLX.
+
+	class ReadbackThread : public util::Runnable
+	{
+		public:
+
+			ReadbackThread(VirtualWin *vw, Display *dpy, VGLFBConfig config,
+				Bool direct);
+			virtual ~ReadbackThread(void);
+			void insertFence(void);
+			void post(GLXDrawable draw);
+			void wait(void);
+			bool isCurrent(void)
+			{
+				return thread && threadID == util::Thread::threadID();
+			}
+			GLXContext getContext(void) { return ctx; }
+			GLuint *getPBO(void) { return &pbo; }
+			void run(void);
+
+		private:
+
+			VirtualWin *vw;
+			Display *dpy;
+			VGLFBConfig config;
+			Bool direct;
+			GLXContext ctx, shareCtx;
+			GLuint pbo;
+			GLsync fence;
+			bool useFence, busy, deadYet;
+			GLXDrawable draw, boundDraw;
+			util::Event ready, bound, done;
+			util::Error error;
+			util::Thread *thread;
+	};
+}
+
+#endif  // __READBACKTHREAD_H__
@@ -0,0 +1,126 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "ResizeWatcher.h"
+#include "fakerconfig.h"
+#include "faker-sym.h"
+#include <poll.h>
+#include <unistd.h>
+
+using namespace util;
+using namespace faker;
+
+
+ResizeWatcher::ResizeWatcher(Display *eventdpy_, Window win_) :
+	eventdpy(eventdpy_), win(win_), thread(NULL), deadYet(false),
+	newWidth(-1), newHeight(-1)
+{
+	wakeFD[0] = wakeFD[1] = -1;
+	if(!eventdpy || !win) THROW("Invalid argument");
+	TRY_UNIX(pipe(wakeFD));
+	try
+	{
+		thread = new Thread(this);
+		thread->start();
+	}
+	catch(...)
+	{
+		delete thread;  thread = NULL;
+		close(wakeFD[0]);  close(wakeFD[1]);
+		throw;
+	}
+}
+
+
+ResizeWatcher::~ResizeWatcher(void)
+{
+	deadYet = true;
+	if(wakeFD[1] >= 0)
+	{
+		char c = 0;
+		if(write(wakeFD[1], &c, 1) < 0) {}
+	}
+	if(thread) { thread->stop();  delete thread;  thread = NULL; }
+	if(wakeFD[0] >= 0) close(wakeFD[0]);
+	if(wakeFD[1] >= 0) close(wakeFD[1]);
+	if(eventdpy) { _XCloseDisplay(eventdpy);  eventdpy = NULL; }
+}
+
+
+// Called by the rendering thread.  Returns true (and the most recent size
+// that the watcher has read) if the window has been resized since the last
+// call.
+
+bool ResizeWatcher::getNewSize(int &width, int &height)
+{
+	CriticalSection::SafeLock l(mutex);
+	if(newWidth <= 0 || newHeight <= 0) return false;
+	width = newWidth;  height = newHeight;
+	newWidth = newHeight = -1;
+	return true;
+}
+
+
+void ResizeWatcher::run(void)
+{
+	struct pollfd fds[2];
+
+	fds[0].fd = ConnectionNumber(eventdpy);  fds[0].events = POLLIN;
+	fds[1].fd = wakeFD[0];  fds[1].events = POLLIN;
+
+	try
+	{
+		while(!deadYet)
+		{
+			fds[0].revents = fds[1].revents = 0;
+			if(poll(fds, 2, -1) < 0)
+			{
+				if(errno == EINTR) continue;
+				THROW_UNIX();
+			}
+			if(deadYet) break;
+			if(fds[1].revents)
+			{
+				char buf[64];
+				if(read(wakeFD[0], buf, 64) < 0 && errno != EINTR) THROW_UNIX();
+			}
+			if(fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+				THROW("X display connection was closed");
+
+			// Only the most recent size in a burst of ConfigureNotify events
+			// matters.
+			int width = -1, height = -1;
+			while(XPending(eventdpy) > 0)
+			{
+				XEvent event;
+				_XNextEvent(eventdpy, &event);
+				if(event.type == ConfigureNotify && event.xconfigure.window == win
+					&& event.xconfigure.width > 0 && event.xconfigure.height > 0)
+				{
+					width = event.xconfigure.width;
+					height = event.xconfigure.height;
+				}
+			}
+			if(width > 0 && height > 0)
+			{
+				CriticalSection::SafeLock l(mutex);
+				newWidth = width;  newHeight = height;
+			}
+		}
+	}
+	catch(std::exception &e)
+	{
+		if(fconfig.verbose)
+			vglout.println("[VGL] WARNING: Resize watcher for window 0x%.8x exited:\n[VGL]    %s",
+				win, e.what());
+	}
+}
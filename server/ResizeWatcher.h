@@ -0,0 +1,56 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __RESIZEWATCHER_H__
+#define __RESIZEWATCHER_H__
+
+#include <X11/Xlib.h>
+#include "Mutex.h"
+#include "Thread.h"
+
+
+namespace faker
+{
+	// If the 3D application does not select StructureNotify events on a window,
+	// then VirtualWin opens a private X display connection (eventdpy) in order
+	// to receive ConfigureNotify events for the window.  This class watches that
+	// connection in a background thread and records the most recent size from
+	// each burst of ConfigureNotify events.  VirtualWin::checkResize() picks up
+	// that size without blocking, so the rendering thread never has to read
+	// events or synchronize with the X server in order to detect that the
+	// window has been resized.  The tradeoff is that a resize is not guaranteed
+	// to be seen by the glViewport() call that immediately follows it, only by
+	// a subsequent one after the watcher has read the event.
+
+	class ResizeWatcher : public util::Runnable
+	{
+		public:
+
+			// The watcher takes ownership of eventdpy.
+			ResizeWatcher(Display *eventdpy, Window win);
+			virtual ~ResizeWatcher(void);
+			bool getNewSize(int &width, int &height);
+			void run(void);
+
+		private:
+
+			Display *eventdpy;
+			Window win;
+			int wakeFD[2];
+			util::Thread *thread;
+			bool deadYet;
+			util::CriticalSection mutex;
+			int newWidth, newHeight;
+	};
+}
+
+#endif  // __RESIZEWATCHER_H__
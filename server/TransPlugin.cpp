@@ -1,4 +1,4 @@
-// Copyright (C)2009-2011, 2014, 2019, 2021 D. R. Commander
+// Copyright (C)2009-2011, 2014, 2019, 2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -15,6 +15,7 @@
 #include <dlfcn.h>
 #include <string.h>
 #include "Error.h"
+#include "Log.h"
 
 using namespace util;
 using namespace server;
@@ -38,8 +39,11 @@ static void *loadsym(void *dllhnd, const char *symbol)
 }
 
 
-TransPlugin::TransPlugin(Display *dpy, Window win, char *name)
+TransPlugin::TransPlugin(Display *dpy, Window win, char *name) :
+	_RRTransGetFrame2(NULL), _RRTransSendFrame2(NULL), version(1), frameID(0),
+	inFlight(0), failed(false)
 {
+	idle.wait();
 	if(!name || strlen(name) < 1) THROW("Transport name is empty or NULL!");
 	const char *err = NULL;
 	CriticalSection::SafeLock l(mutex);
@@ -63,6 +67,19 @@ TransPlugin::TransPlugin(Display *dpy, Window win, char *name)
 		(_RRTransSendFrameType)loadsym(dllhnd, "RRTransSendFrame");
 	_RRTransDestroy = (_RRTransDestroyType)loadsym(dllhnd, "RRTransDestroy");
 	_RRTransGetError = (_RRTransGetErrorType)loadsym(dllhnd, "RRTransGetError");
+	_RRTransGetVersionType _RRTransGetVersion =
+		(_RRTransGetVersionType)dlsym(dllhnd, "RRTransGetVersion");
+	if(_RRTransGetVersion && _RRTransGetVersion() >= 2)
+	{
+		_RRTransGetFrame2 =
+			(_RRTransGetFrame2Type)loadsym(dllhnd, "RRTransGetFrame2");
+		_RRTransSendFrame2 =
+			(_RRTransSendFrame2Type)loadsym(dllhnd, "RRTransSendFrame2");
+		version = 2;
+	}
+	if(fconfig.verbose)
+		vglout.println("[VGL] Using transport plugin %s (API version %d)", filename,
+			version);
 	if(!(handle = _RRTransInit(dpy, win, &fconfig))) THROW(_RRTransGetError());
 }
 
@@ -71,6 +88,17 @@ TransPlugin::~TransPlugin(void)
 {
 	CriticalSection::SafeLock l(mutex);
 	destroy();
+	// The plugin may call the completion function from one of its own threads,
+	// so this instance (and the plugin's code) must not go away until the
+	// function has been called for every frame that is in flight.
+	while(true)
+	{
+		{
+			CriticalSection::SafeLock l2(completeMutex);
+			if(inFlight <= 0) break;
+		}
+		idle.wait();
+	}
 	if(dllhnd) dlclose(dllhnd);
 }
 
@@ -96,6 +124,11 @@ int TransPlugin::ready(void)
 	CriticalSection::SafeLock l(mutex);
 	int ret = _RRTransReady(handle);
 	if(ret < 0) THROW(_RRTransGetError());
+	if(ret > 0)
+	{
+		CriticalSection::SafeLock l2(completeMutex);
+		if(inFlight >= RRTRANS_MAXINFLIGHT) ret = 0;
+	}
 	return ret;
 }
 
@@ -123,3 +156,55 @@ void TransPlugin::sendFrame(RRFrame *frame, bool sync)
 	int ret = _RRTransSendFrame(handle, frame, sync);
 	if(ret < 0) THROW(_RRTransGetError());
 }
+
+
+RRFrame2 *TransPlugin::getFrame2(int width, int height, int format,
+	bool stereo)
+{
+	CriticalSection::SafeLock l(mutex);
+	if(version < 2) THROW("Plugin does not support API version 2");
+	RRFrame2 *ret = _RRTransGetFrame2(handle, width, height, format, stereo);
+	if(!ret) THROW(_RRTransGetError());
+	return ret;
+}
+
+
+void TransPlugin::sendFrame2(RRFrame2 *frame, RRFrameInfo &info, bool sync)
+{
+	CriticalSection::SafeLock l(mutex);
+	if(version < 2) THROW("Plugin does not support API version 2");
+	if(!frame) THROW("Invalid argument");
+	{
+		CriticalSection::SafeLock l2(completeMutex);
+		// The error string may belong to another thread, so it is not used here.
+		if(failed)
+		{
+			failed = false;
+			THROW("Plugin could not deliver a previous frame");
+		}
+		if(frame->flags & RRTRANS_COMPLETION) inFlight++;
+	}
+	info.frameID = ++frameID;
+	info.complete = complete;
+	info.completeData = this;
+	int ret = _RRTransSendFrame2(handle, frame, &info, sync);
+	if(ret < 0)
+	{
+		CriticalSection::SafeLock l2(completeMutex);
+		if((frame->flags & RRTRANS_COMPLETION) && --inFlight == 0) idle.signal();
+		THROW(_RRTransGetError());
+	}
+}
+
+
+void TransPlugin::complete(void *completeData, unsigned long long, int status)
+{
+	TransPlugin *plugin = (TransPlugin *)completeData;
+	if(!plugin) return;
+	CriticalSection::SafeLock l(plugin->completeMutex);
+	if(plugin->inFlight > 0) plugin->inFlight--;
+	if(status < 0) plugin->failed = true;
+	// The destructor cannot proceed until we release the mutex, so the Event is
+	// still valid.
+	if(plugin->inFlight == 0) plugin->idle.signal();
+}
@@ -1,4 +1,4 @@
-// Copyright (C)2009-2011, 2014, 2021 D. R. Commander
+// Copyright (C)2009-2011, 2014, 2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -26,6 +26,10 @@ typedef int (*_RRTransSynchronizeType)(void *);
 typedef int (*_RRTransSendFrameType)(void *, RRFrame *, int);
 typedef int (*_RRTransDestroyType)(void *);
 typedef const char *(*_RRTransGetErrorType)(void);
+typedef int (*_RRTransGetVersionType)(void);
+typedef RRFrame2 *(*_RRTransGetFrame2Type)(void *, int, int, int, int);
+typedef int (*_RRTransSendFrame2Type)(void *, RRFrame2 *, const RRFrameInfo *,
+	int);
 
 
 namespace server
@@ -43,8 +47,19 @@ namespace server
 			RRFrame *getFrame(int width, int height, int format, bool stereo);
 			void sendFrame(RRFrame *frame, bool sync);
 
+			// Version 2 API.  getVersion() returns 1 if the plugin does not export
+			// RRTransGetVersion(), in which case getFrame2() and sendFrame2() cannot
+			// be used.  sendFrame2() assigns the frame ID and the completion
+			// function in info.
+			int getVersion(void) { return version; }
+			RRFrame2 *getFrame2(int width, int height, int format, bool stereo);
+			void sendFrame2(RRFrame2 *frame, RRFrameInfo &info, bool sync);
+
 		private:
 
+			static void complete(void *completeData, unsigned long long frameID,
+				int status);
+
 			_RRTransInitType _RRTransInit;
 			_RRTransConnectType _RRTransConnect;
 			_RRTransGetFrameType _RRTransGetFrame;
@@ -53,8 +68,20 @@ namespace server
 			_RRTransSendFrameType _RRTransSendFrame;
 			_RRTransDestroyType _RRTransDestroy;
 			_RRTransGetErrorType _RRTransGetError;
+			_RRTransGetFrame2Type _RRTransGetFrame2;
+			_RRTransSendFrame2Type _RRTransSendFrame2;
 			util::CriticalSection mutex;
 			void *dllhnd, *handle;
+			int version;
+			unsigned long long frameID;
+
+			// The completion function can be called from any thread, including
+			// from within RRTransSendFrame2(), so it uses a separate mutex.  idle is
+			// signaled whenever inFlight drops to 0.
+			util::CriticalSection completeMutex;
+			util::Event idle;
+			int inFlight;
+			bool failed;
 	};
 }
 
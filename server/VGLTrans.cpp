@@ -13,6 +13,7 @@
 // wxWindows Library License for more details.
 
 #include "VGLTrans.h"
+#include "transworkers.h"
 #include "Timer.h"
 #include "fakerconfig.h"
 #include "vglutil.h"
@@ -56,6 +57,44 @@ using namespace server;
 	} \
 }
 
+#define ENDIANIZE_CAPS(c) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		c.flags = BYTESWAP(c.flags); \
+		c.shmid = BYTESWAP(c.shmid); \
+	} \
+}
+
+#define ENDIANIZE_TIMING(t) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		t.frameID = BYTESWAP(t.frameID); \
+		t.queued = BYTESWAP(t.queued); \
+		t.sent = BYTESWAP(t.sent); \
+		t.rtt = BYTESWAP(t.rtt); \
+	} \
+}
+
+#define ENDIANIZE_STREAMS(s) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		s.count = BYTESWAP(s.count); \
+		s.index = BYTESWAP(s.index); \
+	} \
+}
+
+#define ENDIANIZE_SHMREF(r) \
+{ \
+	if(!LittleEndian()) \
+	{ \
+		r.offset = BYTESWAP(r.offset); \
+		r.end = BYTESWAP(r.end); \
+	} \
+}
+
 #define CONVERT_HEADER(h, h1) \
 { \
 	h1.size = h.size; \
@@ -73,44 +112,202 @@ using namespace server;
 }
 
 
-void VGLTrans::sendHeader(rrframeheader h, bool eof)
+void VGLTrans::handshake(rrframeheader &h)
 {
-	if(version.major == 0 && version.minor == 0)
+	// Fake up an old (protocol v1.0) EOF packet and see if the client sends
+	// back a CTS signal.  If so, it needs protocol 1.0
+	rrframeheader_v1 h1;  char reply = 0;
+	CONVERT_HEADER(h, h1);
+	h1.flags = RR_EOF;
+	ENDIANIZE_V1(h1);
+	if(socket)
 	{
-		// Fake up an old (protocol v1.0) EOF packet and see if the client sends
-		// back a CTS signal.  If so, it needs protocol 1.0
-		rrframeheader_v1 h1;  char reply = 0;
-		CONVERT_HEADER(h, h1);
-		h1.flags = RR_EOF;
-		ENDIANIZE_V1(h1);
-		if(socket)
+		send((char *)&h1, sizeof_rrframeheader_v1);
+		recv(&reply, 1);
+		if(reply == 1)
+		{
+			version.major = 1;  version.minor = 0;
+		}
+		else if(reply == 'V')
+		{
+			rrversion v;
+			version.id[0] = reply;
+			recv(&version.id[1], sizeof_rrversion - 1);
+			if(strncmp(version.id, "VGL", 3) || version.major < 1)
+				THROW("Error reading client version");
+			v = version;
+			v.major = RR_MAJOR_VERSION;  v.minor = RR_MINOR_VERSION;
+			send((char *)&v, sizeof_rrversion);
+		}
+		if(fconfig.verbose)
+			vglout.println("[VGL] Client version: %d.%d", version.major,
+				version.minor);
+		if(version.major > 2 || (version.major == 2 && version.minor >= 2))
+			negotiateCaps();
+	}
+}
+
+
+void VGLTrans::negotiateCaps(void)
+{
+	rrcaps caps;
+
+	memset(&caps, 0, sizeof(rrcaps));
+	if(fconfig.shmtrans && socket->isLocal())
+	{
+		try
+		{
+			shmRing = new ShmRing();
+			caps.flags |= RR_CAP_SHM;
+			caps.shmid = shmRing->getID();
+			shmRing->getKey(caps.shmkey);
+		}
+		catch(std::exception &e)
+		{
+			if(fconfig.verbose)
+				vglout.println("[VGL] WARNING: Could not create shared memory ring:\n[VGL]    %s",
+					e.what());
+			delete shmRing;  shmRing = NULL;
+		}
+	}
+	caps.flags |= RR_CAP_TIMING;
+	if(fconfig.compacthdr) caps.flags |= RR_CAP_COMPACT;
+	if(fconfig.lossless) caps.flags |= RR_CAP_LOSSLESS;
+	// Striping tiles across multiple connections is pointless if the image data
+	// is passed through shared memory.
+	if(fconfig.streams > 1 && !shmRing && hostName)
+		caps.flags |= RR_CAP_STREAMS;
+	ENDIANIZE_CAPS(caps);
+	send((char *)&caps, sizeof_rrcaps);
+	recv((char *)&caps, sizeof_rrcaps);
+	ENDIANIZE_CAPS(caps);
+	sendTiming = (caps.flags & RR_CAP_TIMING) != 0;
+	compactHeaders = (caps.flags & RR_CAP_COMPACT) != 0;
+	lossless = (caps.flags & RR_CAP_LOSSLESS) != 0;
+
+	if(shmRing)
+	{
+		if(caps.flags & RR_CAP_SHM)
+		{
+			// The client has attached to the segment, so it can be marked for
+			// destruction.  It will go away once both processes detach from it.
+			shmRing->remove();
+			if(fconfig.verbose)
+				vglout.println("[VGL] Using shared memory to transfer image data");
+		}
+		else
+		{
+			delete shmRing;  shmRing = NULL;
+		}
+	}
+	if(caps.flags & RR_CAP_STREAMS) openStreams();
+}
+
+
+// A single TCP connection cannot fill a link with a high bandwidth-delay
+// product, since its throughput is limited by its congestion window, so open
+// additional connections to the client and stripe the tiles across them.  If
+// an additional connection cannot be established, then we make do with the
+// connections that we already have.
+
+void VGLTrans::openStreams(void)
+{
+	rrstreams streamInfo;
+
+	streamInfo.count = fconfig.streams;  streamInfo.index = 0;
+	// The key is what proves to the client that an additional connection
+	// belongs to this session, so make it hard to guess.
+	GetRandomBytes(streamInfo.key, sizeof(streamInfo.key));
+	unsigned int key[2] = { streamInfo.key[0], streamInfo.key[1] };
+	ENDIANIZE_STREAMS(streamInfo);
+	send((char *)&streamInfo, sizeof_rrstreams);
+	recv((char *)&streamInfo, sizeof_rrstreams);
+	ENDIANIZE_STREAMS(streamInfo);
+	int count = min((int)streamInfo.count, fconfig.streams);
+
+	for(int i = 1; i < count; i++)
+	{
+		Socket *stream = NULL;
+		try
+		{
+			stream = new Socket(true);
+			stream->connect(hostName, hostPort);
+			streamInfo.count = count;  streamInfo.index = i;
+			streamInfo.key[0] = key[0];  streamInfo.key[1] = key[1];
+			joinStream(stream, streamInfo);
+		}
+		catch(std::exception &e)
 		{
-			send((char *)&h1, sizeof_rrframeheader_v1);
-			recv(&reply, 1);
-			if(reply == 1)
-			{
-				version.major = 1;  version.minor = 0;
-			}
-			else if(reply == 'V')
-			{
-				rrversion v;
-				version.id[0] = reply;
-				recv(&version.id[1], sizeof_rrversion - 1);
-				if(strncmp(version.id, "VGL", 3) || version.major < 1)
-					THROW("Error reading client version");
-				v = version;
-				v.major = RR_MAJOR_VERSION;  v.minor = RR_MINOR_VERSION;
-				send((char *)&v, sizeof_rrversion);
-			}
 			if(fconfig.verbose)
-				vglout.println("[VGL] Client version: %d.%d", version.major,
-					version.minor);
+				vglout.println("[VGL] WARNING: Could not open additional connection to client:\n[VGL]    %s",
+					e.what());
+			delete stream;
+			break;
 		}
+		streams[nStreams++] = stream;
 	}
+
+	streamInfo.count = nStreams;  streamInfo.index = 0;
+	streamInfo.key[0] = key[0];  streamInfo.key[1] = key[1];
+	ENDIANIZE_STREAMS(streamInfo);
+	send((char *)&streamInfo, sizeof_rrstreams);
+	if(fconfig.verbose && nStreams > 1)
+		vglout.println("[VGL] Using %d connections to transfer image data",
+			nStreams);
+}
+
+
+// Perform the protocol handshake on an additional connection and attach it to
+// the client's session
+
+void VGLTrans::joinStream(Socket *stream, rrstreams &streamInfo)
+{
+	rrframeheader_v1 h1;  rrversion v;  rrcaps caps;
+	unsigned int index = streamInfo.index;
+
+	memset(&h1, 0, sizeof(rrframeheader_v1));
+	h1.flags = RR_EOF;
+	stream->send((char *)&h1, sizeof_rrframeheader_v1);
+	stream->recv((char *)&v, sizeof_rrversion);
+	if(strncmp(v.id, "VGL", 3) || v.major < 1)
+		THROW("Error reading client version");
+	memcpy(v.id, "VGL", 3);
+	v.major = RR_MAJOR_VERSION;  v.minor = RR_MINOR_VERSION;
+	stream->send((char *)&v, sizeof_rrversion);
+
+	memset(&caps, 0, sizeof(rrcaps));
+	caps.flags = RR_CAP_STREAMS;
+	ENDIANIZE_CAPS(caps);
+	stream->send((char *)&caps, sizeof_rrcaps);
+	stream->recv((char *)&caps, sizeof_rrcaps);
+	ENDIANIZE_CAPS(caps);
+	if(!(caps.flags & RR_CAP_STREAMS))
+		THROW("Client does not support multiple connections");
+
+	ENDIANIZE_STREAMS(streamInfo);
+	stream->send((char *)&streamInfo, sizeof_rrstreams);
+	stream->recv((char *)&streamInfo, sizeof_rrstreams);
+	ENDIANIZE_STREAMS(streamInfo);
+	if(streamInfo.index != index) THROW("Client rejected additional connection");
+}
+
+
+// If the client accepted RR_CAP_TIMING, then each End-of-Frame header is
+// followed by the timing information for the frame that it completes, or by
+// a zeroed structure if timing is NULL.
+
+void VGLTrans::sendHeader(rrframeheader h, bool eof, rrframetiming *timing)
+{
+	if(version.major == 0 && version.minor == 0) handshake(h);
 	if((version.major < 2 || (version.major == 2 && version.minor < 1))
 		&& h.compress != RRCOMP_JPEG)
 		THROW("This compression mode requires VirtualGL Client v2.1 or later");
-	if(eof) h.flags = RR_EOF;
+	if(eof)
+	{
+		h.flags = RR_EOF;
+		if(capture && (fconfig.capturemode & RRCAPTURE_STREAM))
+			recordTile(h, NULL);
+	}
 	if(version.major == 1 && version.minor == 0)
 	{
 		rrframeheader_v1 h1;
@@ -129,6 +326,39 @@ void VGLTrans::sendHeader(rrframeheader h, bool eof)
 		}
 	}
 	else
+	{
+		// The client cannot draw the frame until it has received all of its
+		// tiles, so every stream carries the End-of-Frame marker.
+		if(eof && curStream == 0)
+		{
+			for(curStream = 1; curStream < nStreams; curStream++) writeHeader(h);
+			curStream = 0;
+		}
+		writeHeader(h);
+		if(eof && sendTiming)
+		{
+			rrframetiming t;
+			if(timing) t = *timing;
+			else memset(&t, 0, sizeof(rrframetiming));
+			ENDIANIZE_TIMING(t);
+			send((char *)&t, sizeof_rrframetiming);
+		}
+	}
+}
+
+
+// Send a (protocol v2.0 or later) header through the current stream, either
+// as-is or as a compact record
+
+void VGLTrans::writeHeader(rrframeheader h)
+{
+	if(compactHeaders)
+	{
+		unsigned char rec[RR_MAXRECORD];
+		flushBatch();
+		send((char *)rec, headerCodecs[curStream].encode(h, rec));
+	}
+	else
 	{
 		ENDIANIZE(h);
 		send((char *)&h, sizeof_rrframeheader);
@@ -136,11 +366,69 @@ void VGLTrans::sendHeader(rrframeheader h, bool eof)
 }
 
 
-VGLTrans::VGLTrans(void) : nprocs(fconfig.np), socket(NULL), thread(NULL),
-	deadYet(false), dpynum(0)
+// With compact headers, small tiles (or tiles whose image data is passed
+// through shared memory) are accumulated, along with their headers, into a
+// batch for each stream, so that many of them can be sent with a single
+// system call.  The batch is sent when it fills up or before any other data is
+// sent through the same stream.
+
+#define BATCH_MAXTILE  (16 * 1024)
+#define BATCH_SIZE     (64 * 1024)
+#define BATCH_HDRSIZE  8
+
+void VGLTrans::batchTile(rrframeheader &h, char *data, int len)
+{
+	unsigned char rec[RR_MAXRECORD];
+
+	if(!batches[curStream])
+	{
+		if((batches[curStream] =
+			(unsigned char *)malloc(BATCH_HDRSIZE + BATCH_SIZE)) == NULL)
+			THROW("Memory allocation error");
+		batchLens[curStream] = 0;
+	}
+	int recLen = headerCodecs[curStream].encode(h, rec);
+	if(batchLens[curStream] + recLen + len > BATCH_SIZE) flushBatch();
+	unsigned char *ptr = &batches[curStream][BATCH_HDRSIZE + batchLens[curStream]];
+	memcpy(ptr, rec, recLen);
+	memcpy(&ptr[recLen], data, len);
+	batchLens[curStream] += recLen + len;
+}
+
+
+void VGLTrans::flushBatch(void)
+{
+	int len = batchLens[curStream];
+	if(len < 1) return;
+
+	unsigned char rec[RR_MAXRECORD];
+	int recLen = CompactHeader::encodeBatch(len, rec);
+	unsigned char *ptr = &batches[curStream][BATCH_HDRSIZE - recLen];
+	memcpy(ptr, rec, recLen);
+	batchLens[curStream] = 0;
+	send((char *)ptr, recLen + len);
+}
+
+
+VGLTrans::VGLTrans(void) : nprocs(fconfig.np), socket(NULL), nStreams(1),
+	curStream(0), tileStream(0), hostName(NULL), hostPort(0),
+	compactHeaders(false), thread(NULL),
+	deadYet(false), dpynum(0), shmRing(NULL), sendTiming(false), frameID(0),
+	lossless(false), adaptQual(-1),
+	refineQual(0), refineSubsamp(0), avgFrameTime(-1.), spoiled(0),
+	tileStates(NULL), nTiles(0), tileFrameW(0), tileFrameH(0),
+	tileStateSize(0), lastQueued(NULL), lastQueuedW(0), lastQueuedH(0),
+	lastQueuedPF(-1), lastQueuedStereo(false), lastQueuedBottomUp(false),
+	bwEst(0.), rttEst(0.), bytesWritten(0), sampleAcked(-1), sampleBusy(false),
+	sampleSendTime(0.), paceTokens(0.), capture(NULL)
 {
 	memset(&version, 0, sizeof(rrversion));
+	for(int i = 0; i < RR_MAXSTREAMS; i++)
+	{
+		streams[i] = NULL;  batches[i] = NULL;  batchLens[i] = 0;
+	}
 	profTotal.setName("Total     ");
+	if(strlen(fconfig.capture) > 0) capture = acquireCapture();
 	#ifdef USEHELGRIND
 	ANNOTATE_BENIGN_RACE_SIZED(&deadYet, sizeof(bool), );
 	// NOTE: Without this line, helgrind reports a data race on the class
@@ -154,50 +442,91 @@ void VGLTrans::run(void)
 {
 	Frame *lastf = NULL, *f = NULL;
 	long bytes = 0;
-	Timer timer, sleepTimer;  double err = 0.;  bool first = true;
+	Timer timer, sleepTimer, sendTimer;  double err = 0.;  bool first = true;
 	int i;
 
 	try
 	{
-		VGLTrans::Compressor *comp[MAXPROCS];  Thread *cthread[MAXPROCS];
+		VGLTrans::Compressor *comp[MAXPROCS];
+		initTransportThread();
 		if(fconfig.verbose)
 			vglout.println("[VGL] Using %d compression threads on %d CPU cores",
 				nprocs, NumProcs());
 		for(i = 0; i < nprocs; i++)
 			comp[i] = new VGLTrans::Compressor(i, this);
-		if(nprocs > 1) for(i = 1; i < nprocs; i++)
-		{
-			cthread[i] = new Thread(comp[i]);
-			cthread[i]->start();
-		}
 
 		while(!deadYet)
 		{
-			int np;
 			void *ftemp = NULL;
 
+			double refineTime = fconfig.refine > 0. ? fconfig.refine :
+				(fconfig.adaptive > 0. ? ADAPT_IDLETIME : 0.);
+			// Tiles can only be refined from a JPEG frame, so if the last frame used
+			// a different compression type, then any remaining debt is left until
+			// the next JPEG frame rather than waking up every refineTime seconds
+			// to no avail.
+			if(refineTime > 0. && lastf && lastf->hdr.compress == RRCOMP_JPEG
+				&& hasQualityDebt())
+			{
+				// If some of the tiles on the client's screen were sent at less than
+				// the target quality and no new frame arrives for a while, then the
+				// scene has probably gone idle, so resend those tiles.
+				bool gotFrame = q.waitForItems(refineTime);
+				if(deadYet) break;
+				if(!gotFrame)
+				{
+					refine(lastf);
+					continue;
+				}
+			}
+
 			q.get(&ftemp);  f = (Frame *)ftemp;  if(deadYet) break;
 			if(!f) THROW("Queue has been shut down");
+			// Callers that synchronize with us are not released until the network
+			// has caught up, so only frames from callers that spoil are dropped
+			// here.
+			if(fconfig.pace && fconfig.spoil && waitForBacklog())
+			{
+				// A newer frame arrived while we were waiting for the network to
+				// catch up, so drop this one without compressing it.
+				f->signalComplete();
+				CriticalSection::SafeLock l(mutex);
+				spoiled++;
+				continue;
+			}
 			ready.signal();
-			np = nprocs;  if(f->hdr.compress == RRCOMP_YUV) np = 1;
-			if(np > 1)
+			if(capture && (fconfig.capturemode & RRCAPTURE_FRAMES))
 			{
-				for(i = 1; i < np; i++)
-				{
-					cthread[i]->checkError();  comp[i]->go(f, lastf);
-				}
+				f->waitForRows(0, f->hdr.height);
+				recordFrame(f);
 			}
-			comp[0]->compressSend(f, lastf);
-			bytes += comp[0]->bytes;
-			if(np > 1)
+			initTileStates(f);
+			if(f->hdr.compress == RRCOMP_JPEG)
 			{
-				for(i = 1; i < np; i++)
-				{
-					comp[i]->stop();  cthread[i]->checkError();  comp[i]->send();
-					bytes += comp[i]->bytes;
-				}
+				// The quality specified by the user is the target for refinement,
+				// unless VGL_REFINE is set, in which case we refine to the highest
+				// quality that JPEG can provide.
+				refineQual = fconfig.refine > 0. ? 100 : f->hdr.qual;
+				refineSubsamp = (fconfig.refine > 0. && f->hdr.subsamp != 0) ?
+					1 : f->hdr.subsamp;
 			}
-			sendHeader(f->hdr, true);
+			if(fconfig.adaptive > 0.) adaptQuality(f);
+			sendTimer.start();
+			bytes = compressFrame(f, lastf, comp);
+			if(sendTiming && f->timestamp > 0.)
+			{
+				rrframetiming timing = f->timing;
+				if(++frameID == 0) frameID = 1;
+				timing.frameID = frameID;
+				timing.sent = (unsigned int)((GetTime() - f->timestamp) * 1000000.);
+				timing.rtt = (unsigned int)(getRTT() * 1000000.);
+				sendHeader(f->hdr, true, &timing);
+			}
+			else sendHeader(f->hdr, true);
+			// The quality is adapted only for JPEG frames, so the time taken to
+			// send other frames says nothing about it.
+			if(fconfig.adaptive > 0. && f->hdr.compress == RRCOMP_JPEG)
+				updateQuality(sendTimer.elapsed(), bytes);
 
 			profTotal.endFrame(f->hdr.width * f->hdr.height, bytes, 1);
 			bytes = 0;
@@ -231,13 +560,6 @@ void VGLTrans::run(void)
 			lastf = f;
 		}
 
-		for(i = 0; i < nprocs; i++) comp[i]->shutdown();
-		if(nprocs > 1) for(i = 1; i < nprocs; i++)
-		{
-			cthread[i]->stop();
-			cthread[i]->checkError();
-			delete cthread[i];
-		}
 		for(i = 0; i < nprocs; i++) delete comp[i];
 
 	}
@@ -250,6 +572,87 @@ void VGLTrans::run(void)
 }
 
 
+// Compress and send all of the tiles in a frame, using all of the compressors,
+// and return the number of compressed bytes sent.  The first compressor runs in
+// this thread and sends its tiles as it goes, and the others run on the shared
+// worker pool and store their tiles so that they can be sent afterwards.  The
+// caller is responsible for sending the EOF header.
+long VGLTrans::compressFrame(Frame *f, Frame *lastf, Compressor **comp)
+{
+	WorkerPool::Job *jobs[MAXPROCS];
+	long bytes = 0;
+	int i, np = nprocs;
+
+	if(f->hdr.compress == RRCOMP_YUV) np = 1;
+	for(i = 0; i < np; i++)
+	{
+		comp[i]->setFrame(f, lastf);  jobs[i] = comp[i];
+	}
+	if(np > 1) getWorkerPool()->execute(jobs, np);
+	else comp[0]->execute();
+	bytes += comp[0]->bytes;
+	for(i = 1; i < np; i++)
+	{
+		comp[i]->send();
+		bytes += comp[i]->bytes;
+	}
+	return bytes;
+}
+
+
+// The adaptive quality controller treats the JPEG quality and chrominance
+// subsampling specified by the user as a ceiling.  It reduces the quality when
+// the frames aren't getting to the client quickly enough to sustain the target
+// frame rate (or would exceed the target bit rate), and it raises the quality
+// again when there is headroom.  The tiles that were sent at reduced quality
+// are refined by refine() once the scene goes idle.
+
+void VGLTrans::adaptQuality(Frame *f)
+{
+	if(f->hdr.compress != RRCOMP_JPEG) return;
+
+	int maxQual = f->hdr.qual, maxSubsamp = f->hdr.subsamp;
+
+	if(adaptQual < 0 || adaptQual > maxQual) adaptQual = maxQual;
+	f->hdr.qual = adaptQual;
+	if(maxSubsamp >= 1 && maxSubsamp < 4 && adaptQual < ADAPT_SUBSAMPQUAL)
+		f->hdr.subsamp = 4;
+}
+
+
+void VGLTrans::updateQuality(double elapsed, long bytes)
+{
+	double targetTime = 1. / fconfig.adaptive, frameTime = elapsed;
+	int spoiledFrames;
+
+	// If a target bit rate was specified, then also account for how long this
+	// frame would take to transmit at that bit rate.
+	if(fconfig.adaptivembps > 0.)
+		frameTime = max(frameTime,
+			(double)bytes * 8. / (fconfig.adaptivembps * 1000000.));
+	else if(fconfig.pace)
+	{
+		double bw = getBandwidth();
+		if(bw > 0.) frameTime = max(frameTime, (double)bytes / bw);
+	}
+	if(avgFrameTime < 0.) avgFrameTime = frameTime;
+	else avgFrameTime = 0.75 * avgFrameTime + 0.25 * frameTime;
+
+	mutex.lock(false);
+	spoiledFrames = spoiled;  spoiled = 0;
+	mutex.unlock(false);
+
+	// Spoiled frames indicate that the application is producing frames faster
+	// than we can send them, which only matters if we are also close to missing
+	// the target.
+	if(avgFrameTime > targetTime * 1.1
+		|| (spoiledFrames > 0 && avgFrameTime > targetTime * 0.9))
+		adaptQual = max(ADAPT_MINQUAL, adaptQual * 85 / 100);
+	else if(avgFrameTime < targetTime * 0.7 && spoiledFrames == 0)
+		adaptQual = min(100, adaptQual + 5);
+}
+
+
 Frame *VGLTrans::getFrame(int width, int height, int pixelFormat, int flags,
 	bool stereo)
 {
@@ -273,6 +676,8 @@ Frame *VGLTrans::getFrame(int width, int height, int pixelFormat, int flags,
 	hdr.width = hdr.framew = width;
 	hdr.height = hdr.frameh = height;
 	f->init(hdr, pixelFormat, flags, stereo);
+	f->timestamp = 0.;
+	memset(&f->timing, 0, sizeof(rrframetiming));
 	return f;
 }
 
@@ -280,7 +685,8 @@ Frame *VGLTrans::getFrame(int width, int height, int pixelFormat, int flags,
 bool VGLTrans::isReady(void)
 {
 	if(thread) thread->checkError();
-	return q.items() <= 0;
+	if(q.items() > 0) return false;
+	return !fconfig.pace || getBacklog() <= PACE_MAXBACKLOG + getRTT();
 }
 
 
@@ -290,6 +696,101 @@ void VGLTrans::synchronize(void)
 }
 
 
+// Keep track of the position and quality of each tile that was last sent to the
+// client, so that tiles that were sent at less than the target quality can be
+// refined later, even if interframe comparison prevents them from being sent
+// again as part of a new frame.
+
+void VGLTrans::initTileStates(Frame *f)
+{
+	int tileSize = fconfig.tilesize;
+
+	if(f->hdr.compress == RRCOMP_YUV) tileSize = 0;
+	if(tileStates && f->hdr.framew == tileFrameW && f->hdr.frameh == tileFrameH
+		&& tileSize == tileStateSize)
+		return;
+
+	int tilesx = tileSize ? (f->hdr.width + tileSize - 1) / tileSize : 1;
+	int tilesy = tileSize ? (f->hdr.height + tileSize - 1) / tileSize : 1;
+	free(tileStates);
+	nTiles = tilesx * tilesy;
+	if((tileStates = (TileState *)calloc(nTiles, sizeof(TileState))) == NULL)
+	{
+		nTiles = 0;  THROW("Memory allocation error");
+	}
+	tileFrameW = f->hdr.framew;  tileFrameH = f->hdr.frameh;
+	tileStateSize = tileSize;
+}
+
+
+void VGLTrans::setTileState(int n, rrframeheader &h)
+{
+	if(n < 0 || n >= nTiles) return;
+	TileState &ts = tileStates[n];
+	ts.x = h.x;  ts.y = h.y;  ts.width = h.width;  ts.height = h.height;
+	ts.qual = h.qual;  ts.subsamp = h.subsamp;  ts.compress = h.compress;
+}
+
+
+bool VGLTrans::isDebt(TileState &ts)
+{
+	return ts.width > 0 && ts.compress == RRCOMP_JPEG
+		&& (ts.qual < refineQual || ts.subsamp != refineSubsamp);
+}
+
+
+bool VGLTrans::hasQualityDebt(void)
+{
+	for(int i = 0; i < nTiles; i++)
+		if(isDebt(tileStates[i])) return true;
+	return false;
+}
+
+
+// Progressively resend the tiles that were sent at less than the target
+// quality, a few at a time, so that a new frame can preempt the refinement
+void VGLTrans::refine(Frame *f)
+{
+	long bytes = 0, pixels = 0;  int sent = 0;
+
+	if(f->hdr.compress != RRCOMP_JPEG) return;
+
+	for(int i = 0; i < nTiles && !deadYet; i++)
+	{
+		TileState &ts = tileStates[i];
+		if(!isDebt(ts)) continue;
+		if(sent > 0 && sent % REFINE_TILES == 0)
+		{
+			sendHeader(f->hdr, true);
+			if(q.items() > 0) { sent = 0;  break; }
+		}
+
+		CompressedFrame ctile;
+		Frame *tile = f->getTile(ts.x, ts.y, ts.width, ts.height);
+		tile->hdr.qual = refineQual;  tile->hdr.subsamp = refineSubsamp;
+		ctile = *tile;
+		delete tile;
+		sendTile(ctile.hdr, (char *)ctile.bits);
+		bytes += ctile.hdr.size;
+		if(ctile.stereo && ctile.rbits)
+		{
+			sendTile(ctile.rhdr, (char *)ctile.rbits);
+			bytes += ctile.rhdr.size;
+		}
+		ts.qual = refineQual;  ts.subsamp = refineSubsamp;
+		pixels += ts.width * ts.height;  sent++;
+	}
+	if(sent > 0) sendHeader(f->hdr, true);
+
+	if(pixels > 0)
+	{
+		profTotal.endFrame(pixels, bytes,
+			(double)pixels / (double)(f->hdr.framew * f->hdr.frameh));
+		profTotal.startFrame();
+	}
+}
+
+
 static void _VGLTrans_spoilfct(void *f)
 {
 	if(f) ((Frame *)f)->signalComplete();
@@ -300,10 +801,53 @@ void VGLTrans::sendFrame(Frame *f)
 {
 	if(thread) thread->checkError();
 	f->hdr.dpynum = dpynum;
+	if(f->timestamp > 0.)
+		f->timing.queued = (unsigned int)((GetTime() - f->timestamp) * 1000000.);
+	if(q.items() > 0)
+	{
+		CriticalSection::SafeLock l(mutex);
+		spoiled++;
+	}
+	lastQueued = f;
+	lastQueuedW = f->hdr.framew;  lastQueuedH = f->hdr.frameh;
+	lastQueuedPF = f->pf->id;  lastQueuedStereo = f->rbits != NULL;
+	lastQueuedBottomUp = (f->flags & FRAME_BOTTOMUP) != 0;
 	q.spoil((void *)f, _VGLTrans_spoilfct);
 }
 
 
+// Copy the pixels from the frame that was most recently passed to sendFrame()
+// into f, so that the caller need only read back the portion of f that has
+// changed.  The previous frame may still be in the process of being
+// compressed, but the compressor threads never modify it, and it cannot be
+// returned by getFrame() again until they have finished with it.  Returns
+// false if the previous frame is unavailable or has a different geometry or
+// pixel format.
+
+bool VGLTrans::copyLastFrame(Frame *f)
+{
+	if(!lastQueued || !f || !f->bits || f->hdr.framew != lastQueuedW
+		|| f->hdr.frameh != lastQueuedH || f->pf->id != lastQueuedPF
+		|| (f->rbits != NULL) != lastQueuedStereo
+		|| ((f->flags & FRAME_BOTTOMUP) != 0) != lastQueuedBottomUp)
+		return false;
+	if(f == lastQueued) return true;
+	if(lastQueued->hdr.framew != lastQueuedW
+		|| lastQueued->hdr.frameh != lastQueuedH
+		|| lastQueued->pf->id != lastQueuedPF)
+		return false;
+	memcpy(f->bits, lastQueued->bits, f->pitch * f->hdr.frameh);
+	if(f->rbits && lastQueued->rbits)
+		memcpy(f->rbits, lastQueued->rbits, f->pitch * f->hdr.frameh);
+	return true;
+}
+
+
+// A tile is sent losslessly only if doing so requires no more than this many
+// bits per pixel, which is roughly what JPEG requires for text at the default
+// quality.
+#define LOSSLESS_MAXBPP  4
+
 void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 {
 	CompressedFrame cframe;
@@ -315,11 +859,17 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 
 	if(f->hdr.compress == RRCOMP_YUV)
 	{
+		// A YUV frame is sent as a single tile, so the other compressors are
+		// idle.  Divide the encoding into stripes on the worker pool instead.
+		if(!yuvEncoder)
+			yuvEncoder = new YUVEncoder(nprocs,
+				nprocs > 1 ? getWorkerPool() : NULL);
+		cframe.setYUVEncoder(yuvEncoder);
+		f->waitForRows(0, f->hdr.height);
 		profComp.startFrame();
 		cframe = *f;
 		profComp.endFrame(f->hdr.framew * f->hdr.frameh, 0, 1);
-		parent->sendHeader(cframe.hdr);
-		parent->send((char *)cframe.bits, cframe.hdr.size);
+		parent->sendTile(cframe.hdr, (char *)cframe.bits);
 		return;
 	}
 
@@ -341,6 +891,9 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 				width = f->hdr.width - j;  j += tilesizex;
 			}
 			if(n % nprocs != myRank) continue;
+			// If the frame is still being read back, then wait for the stripes
+			// that contain this tile.
+			f->waitForRows(y, height);
 			if(fconfig.interframe)
 			{
 				if(f->tileEquals(lastf, x, y, width, height)) continue;
@@ -350,7 +903,17 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 			if(myRank > 0) { ctile = new CompressedFrame(); }
 			else ctile = &cframe;
 			profComp.startFrame();
-			*ctile = *tile;
+			// Tiles that contain few colors (text, lines, and flat-shaded regions)
+			// are usually both smaller and sharper when compressed losslessly.
+			// compressLossless() gives up quickly on tiles that are not suited to
+			// it, in which case they are compressed as usual.
+			if(!parent->lossless || tile->hdr.compress != RRCOMP_JPEG
+				|| !ctile->compressLossless(*tile,
+					tile->hdr.width * tile->hdr.height * LOSSLESS_MAXBPP / 8))
+				*ctile = *tile;
+			// The tile state records the compression type that was actually used,
+			// so tiles that were sent losslessly are never refined.
+			parent->setTileState(n, ctile->hdr);
 			double frames = (double)(tile->hdr.width * tile->hdr.height) /
 				(double)(tile->hdr.framew * tile->hdr.frameh);
 			profComp.endFrame(tile->hdr.width * tile->hdr.height, 0, frames);
@@ -359,13 +922,9 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 			delete tile;
 			if(myRank == 0)
 			{
-				parent->sendHeader(ctile->hdr);
-				parent->send((char *)ctile->bits, ctile->hdr.size);
+				parent->sendTile(ctile->hdr, (char *)ctile->bits);
 				if(ctile->stereo && ctile->rbits)
-				{
-					parent->sendHeader(ctile->rhdr);
-					parent->send((char *)ctile->rbits, ctile->rhdr.size);
-				}
+					parent->sendTile(ctile->rhdr, (char *)ctile->rbits);
 			}
 			else
 			{
@@ -376,11 +935,57 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 }
 
 
+// Send a tile header along with its image data.  If the client is using the
+// shared-memory transport, then the image data is passed through the shared
+// memory ring, and only its location is sent through the socket.
+void VGLTrans::sendTile(rrframeheader h, char *bits)
+{
+	rrshmref ref;
+
+	if(version.major == 0 && version.minor == 0) handshake(h);
+	if(capture && (fconfig.capturemode & RRCAPTURE_STREAM)) recordTile(h, bits);
+	// The right-eye tile of a stereo pair is sent through the same stream as
+	// the left-eye tile, so the client can pair them up.
+	if(nStreams > 1)
+	{
+		if(h.flags != RR_RIGHT) tileStream = (tileStream + 1) % nStreams;
+		curStream = tileStream;
+	}
+	if(shmRing && shmRing->write(bits, h.size, ref))
+	{
+		h.flags |= RR_SHMDATA;
+		ENDIANIZE_SHMREF(ref);
+		if(compactHeaders) batchTile(h, (char *)&ref, sizeof_rrshmref);
+		else
+		{
+			sendHeader(h);
+			send((char *)&ref, sizeof_rrshmref);
+		}
+	}
+	else if(compactHeaders && h.size <= BATCH_MAXTILE)
+		batchTile(h, bits, h.size);
+	else
+	{
+		sendHeader(h);
+		send(bits, h.size);
+	}
+	curStream = 0;
+}
+
+
 void VGLTrans::send(char *buf, int len)
 {
 	try
 	{
-		if(socket) socket->send(buf, len);
+		if(socket)
+		{
+			Timer sendTimer;
+			if(fconfig.pace && !shmRing) pace(len);
+			sendTimer.start();
+			if(curStream > 0) streams[curStream]->send(buf, len);
+			else socket->send(buf, len);
+			updateBandwidth(len, sendTimer.elapsed());
+		}
 	}
 	catch(...)
 	{
@@ -390,6 +995,223 @@ void VGLTrans::send(char *buf, int len)
 }
 
 
+// The bandwidth estimator measures the rate at which the client acknowledges
+// the data that we send it.  On Linux, the number of unacknowledged bytes is
+// obtained from the kernel, so the delivery rate can be measured directly.
+// Elsewhere, we assume that the connection was busy for the whole interval if
+// we spent most of it blocked in send().  Any delivery rate sample is a lower
+// bound on the available bandwidth, so samples that exceed the current
+// estimate are always accepted, but samples below the estimate are accepted
+// only if the connection never went idle during the sampling interval (if it
+// did, then we, not the network, were the bottleneck.)
+
+void VGLTrans::updateBandwidth(int len, double sendTime)
+{
+	bytesWritten += len;  sampleSendTime += sendTime;
+
+	double elapsed = sampleTimer.elapsed();
+	if(elapsed < max(BW_MININTERVAL, rttEst)) return;
+	double rtt = socket->rtt();
+
+	// Data that was just sent, or that is merely in flight, is always
+	// unacknowledged, so the connection is considered busy only if there is a
+	// standing queue beyond that.
+	int queued = sendQueue();  bool busy;
+	if(queued >= 0)
+		busy = queued > len + (int)(bwEst * max(rttEst, BW_MININTERVAL));
+	else
+	{
+		busy = sampleSendTime > elapsed * 0.5;  queued = 0;
+	}
+	long long acked = bytesWritten - queued;
+
+	// The first sampling interval begins with the first send, so discard it.
+	if(sampleAcked >= 0)
+	{
+		double sample = (double)(acked - sampleAcked) / elapsed;
+		CriticalSection::SafeLock l(bwMutex);
+		if(bwEst <= 0.) bwEst = sample;
+		else if(sample > bwEst || (busy && sampleBusy))
+			bwEst = 0.75 * bwEst + 0.25 * sample;
+		if(rtt > 0.) rttEst = rtt;
+	}
+	sampleAcked = acked;  sampleBusy = busy;  sampleSendTime = 0.;
+	sampleTimer.start();
+}
+
+
+// Token bucket that limits the rate at which data is passed to the socket, so
+// that it does not pile up in the kernel's send buffer (where it can no longer
+// be spoiled) when the network is slower than the compressor
+
+void VGLTrans::pace(int len)
+{
+	double rate = getBandwidth() * PACE_GAIN;
+	if(rate <= 0.) return;
+
+	double burst = max((double)PACE_MINBURST, rate * PACE_BURSTTIME);
+	paceTokens = min(burst, paceTokens + paceTimer.elapsed() * rate);
+	paceTimer.start();
+	if(paceTokens < (double)len)
+	{
+		long usec = (long)(((double)len - paceTokens) / rate * 1000000.);
+		if(usec > 0) usleep(usec);
+		paceTokens += paceTimer.elapsed() * rate;
+		paceTimer.start();
+	}
+	paceTokens -= (double)len;
+}
+
+
+double VGLTrans::getBandwidth(void)
+{
+	CriticalSection::SafeLock l(bwMutex);
+	return bwEst;
+}
+
+
+double VGLTrans::getRTT(void)
+{
+	CriticalSection::SafeLock l(bwMutex);
+	return rttEst;
+}
+
+
+// Return the time (in seconds) that it will take to deliver the data that is
+// already in the socket's send queue, based on the current bandwidth estimate
+double VGLTrans::getBacklog(void)
+{
+	double bw = getBandwidth();
+	if(!socket || shmRing || bw <= 0.) return 0.;
+	int queued = sendQueue();
+	return queued > 0 ? (double)queued / bw : 0.;
+}
+
+
+// Return the number of bytes in the send queues of all streams, or -1 if the
+// operating system cannot report it
+int VGLTrans::sendQueue(void)
+{
+	int queued = socket->sendQueue();
+	if(queued < 0) return -1;
+	for(int i = 1; i < nStreams; i++)
+	{
+		int streamQueued = streams[i]->sendQueue();
+		if(streamQueued > 0) queued += streamQueued;
+	}
+	return queued;
+}
+
+
+// Wait until the socket's send queue has drained enough that a new frame can
+// be delivered without excessive latency.  Returns true if a newer frame was
+// queued in the meantime.
+bool VGLTrans::waitForBacklog(void)
+{
+	while(!deadYet)
+	{
+		// At the estimated bandwidth, the excess backlog will take this long to
+		// drain.  The estimate may be off, so check again afterward.
+		double excess = getBacklog() - (PACE_MAXBACKLOG + getRTT());
+		if(excess <= 0.) break;
+		if(q.waitForItems(max(excess, 0.001))) break;
+	}
+	return q.items() > 0;
+}
+
+
+// All instances of VGLTrans in a process share a capture file, which is
+// finalized whenever the last of them is destroyed.  A child process created
+// with fork() does not inherit the capture.
+
+static CaptureWriter *captureWriter = NULL;
+static int captureRefCount = 0;
+static pid_t capturePID = 0;
+static CriticalSection captureMutex;
+
+
+CaptureWriter *VGLTrans::acquireCapture(void)
+{
+	CriticalSection::SafeLock l(captureMutex);
+
+	if(captureWriter && capturePID != getpid()) return NULL;
+	if(!captureWriter)
+	{
+		try
+		{
+			captureWriter = new CaptureWriter(fconfig.capture);
+			capturePID = getpid();
+			if(fconfig.verbose)
+				vglout.println("[VGL] Capturing %s%s%s to %s",
+					fconfig.capturemode & RRCAPTURE_FRAMES ? "uncompressed frames" : "",
+					fconfig.capturemode == RRCAPTURE_BOTH ? " and " : "",
+					fconfig.capturemode & RRCAPTURE_STREAM ? "VGL Transport stream" : "",
+					fconfig.capture);
+		}
+		catch(std::exception &e)
+		{
+			vglout.println("[VGL] WARNING: Could not open capture file %s:\n[VGL]    %s",
+				fconfig.capture, e.what());
+			return NULL;
+		}
+	}
+	captureRefCount++;
+	return captureWriter;
+}
+
+
+void VGLTrans::releaseCapture(void)
+{
+	CriticalSection::SafeLock l(captureMutex);
+
+	if(captureRefCount > 0 && --captureRefCount == 0 && captureWriter)
+	{
+		try
+		{
+			captureWriter->finalize();
+		}
+		catch(std::exception &e)
+		{
+			vglout.println("[VGL] WARNING: Could not finalize capture file:\n[VGL]    %s",
+				e.what());
+		}
+	}
+}
+
+
+// An error writing to the capture file (such as a full disk) should not
+// disrupt the 3D application, so stop capturing if one occurs.
+
+void VGLTrans::recordFrame(Frame *f)
+{
+	try
+	{
+		capture->writeFrame(*f);
+	}
+	catch(std::exception &e)
+	{
+		vglout.println("[VGL] WARNING: Could not write to capture file:\n[VGL]    %s",
+			e.what());
+		releaseCapture();  capture = NULL;
+	}
+}
+
+
+void VGLTrans::recordTile(rrframeheader &h, char *bits)
+{
+	try
+	{
+		capture->writeTile(h, (unsigned char *)bits);
+	}
+	catch(std::exception &e)
+	{
+		vglout.println("[VGL] WARNING: Could not write to capture file:\n[VGL]    %s",
+			e.what());
+		releaseCapture();  capture = NULL;
+	}
+}
+
+
 void VGLTrans::recv(char *buf, int len)
 {
 	try
@@ -451,6 +1273,7 @@ void VGLTrans::connect(char *displayName, unsigned short port)
 		try
 		{
 			socket->connect(serverName, port);
+			hostName = strdup(serverName);  hostPort = port;
 		}
 		catch(...)
 		{
@@ -477,13 +1300,9 @@ void VGLTrans::Compressor::send(void)
 	{
 		CompressedFrame *cf = cframes[i];
 		ERRIFNOT(cf);
-		parent->sendHeader(cf->hdr);
-		parent->send((char *)cf->bits, cf->hdr.size);
+		parent->sendTile(cf->hdr, (char *)cf->bits);
 		if(cf->stereo && cf->rbits)
-		{
-			parent->sendHeader(cf->rhdr);
-			parent->send((char *)cf->rbits, cf->rhdr.size);
-		}
+			parent->sendTile(cf->rhdr, (char *)cf->rbits);
 		delete cf;
 	}
 	storedFrames = 0;
@@ -17,15 +17,55 @@
 
 #include "Socket.h"
 #include "Thread.h"
+#include "WorkerPool.h"
+#include "Timer.h"
 #include "rr.h"
 #include "Frame.h"
 #include "GenericQ.h"
 #include "Profiler.h"
+#include "ShmRing.h"
+#include "CompactHeader.h"
+#include "FrameCapture.h"
 #ifdef USEHELGRIND
 	#include <valgrind/helgrind.h>
 #endif
 
 
+// Lowest JPEG quality that the adaptive quality controller will use
+#define ADAPT_MINQUAL  20
+
+// The adaptive quality controller switches to 4:2:0 subsampling below this
+// JPEG quality
+#define ADAPT_SUBSAMPQUAL  60
+
+// Seconds of inactivity after which the adaptive quality controller refines
+// the tiles that it sent at reduced quality (unless VGL_REFINE is set)
+#define ADAPT_IDLETIME  0.25
+
+// Number of tiles to refine before sending an end-of-frame marker and checking
+// for a new frame
+#define REFINE_TILES  16
+
+// Minimum interval (in seconds) over which the bandwidth estimator measures
+// the delivery rate
+#define BW_MININTERVAL  0.01
+
+// The send pacer transmits at this multiple of the estimated bandwidth, so
+// that the estimate can grow if more bandwidth becomes available.
+#define PACE_GAIN  1.25
+
+// Largest burst (in seconds' worth of data at the pacing rate, but no less
+// than PACE_MINBURST bytes) that the send pacer will allow
+#define PACE_BURSTTIME  0.002
+#define PACE_MINBURST  65536
+
+// When VGL_PACE is enabled, frames are not compressed until the data that is
+// already in the socket's send queue can be delivered within this many seconds
+// (plus one round-trip time.)  A frame that is superseded while waiting is
+// spoiled without being compressed.
+#define PACE_MAXBACKLOG  0.02
+
+
 namespace server
 {
 	class VGLTrans : public util::Runnable
@@ -38,25 +78,90 @@ namespace server
 			{
 				deadYet = true;  q.release();
 				if(thread) { thread->stop();  delete thread;  thread = NULL; }
+				if(capture) { releaseCapture();  capture = NULL; }
+				delete shmRing;  shmRing = NULL;
+				for(int i = 1; i < nStreams; i++)
+				{
+					delete streams[i];  streams[i] = NULL;
+				}
 				delete socket;  socket = NULL;
+				free(hostName);  hostName = NULL;
+				for(int i = 0; i < RR_MAXSTREAMS; i++)
+				{
+					free(batches[i]);  batches[i] = NULL;
+				}
+				free(tileStates);  tileStates = NULL;
 			}
 
 			common::Frame *getFrame(int, int, int, int, bool stereo);
 			bool isReady(void);
 			void synchronize(void);
 			void sendFrame(common::Frame *);
+			bool copyLastFrame(common::Frame *f);
 			void run(void);
-			void sendHeader(rrframeheader h, bool eof = false);
+			void sendHeader(rrframeheader h, bool eof = false,
+				rrframetiming *timing = NULL);
+			void sendTile(rrframeheader h, char *bits);
 			void send(char *, int);
-			void save(char *, int);
 			void recv(char *, int);
 			void connect(char *, unsigned short);
 
+			// Return the estimated bandwidth (in bytes/second) and round-trip time
+			// (in seconds) of the connection to the client, or 0 if no estimate is
+			// available yet
+			double getBandwidth(void);
+			double getRTT(void);
+
 			int nprocs;
 
 		private:
 
+			class Compressor;
+
+			typedef struct
+			{
+				unsigned short x, y, width, height;
+				unsigned char qual, subsamp, compress;
+			} TileState;
+
+			void handshake(rrframeheader &h);
+			void negotiateCaps(void);
+			void writeHeader(rrframeheader h);
+			void batchTile(rrframeheader &h, char *data, int len);
+			void flushBatch(void);
+			void openStreams(void);
+			void joinStream(util::Socket *stream, rrstreams &streamInfo);
+			int sendQueue(void);
+			long compressFrame(common::Frame *f, common::Frame *lastf,
+				Compressor **comp);
+			void adaptQuality(common::Frame *f);
+			void updateQuality(double elapsed, long bytes);
+			void initTileStates(common::Frame *f);
+			void setTileState(int n, rrframeheader &h);
+			bool isDebt(TileState &ts);
+			bool hasQualityDebt(void);
+			void refine(common::Frame *f);
+			void updateBandwidth(int len, double sendTime);
+			void pace(int len);
+			double getBacklog(void);
+			bool waitForBacklog(void);
+			void recordFrame(common::Frame *f);
+			void recordTile(rrframeheader &h, char *bits);
+			static common::CaptureWriter *acquireCapture(void);
+			static void releaseCapture(void);
+
 			util::Socket *socket;
+			// With VGL_STREAMS, the additional connections to the client (streams[0]
+			// is unused, since the primary connection is socket), and the stream
+			// through which send() is currently sending
+			util::Socket *streams[RR_MAXSTREAMS];
+			int nStreams, curStream, tileStream;
+			char *hostName;  unsigned short hostPort;
+			// With compact headers, the encoder state and the pending batch of small
+			// tiles for each stream
+			bool compactHeaders;
+			common::CompactHeader headerCodecs[RR_MAXSTREAMS];
+			unsigned char *batches[RR_MAXSTREAMS];  int batchLens[RR_MAXSTREAMS];
 			static const int NFRAMES = 4;
 			util::CriticalSection mutex;
 			common::Frame frames[NFRAMES];
@@ -66,60 +171,50 @@ namespace server
 			common::Profiler profTotal;
 			int dpynum;
 			rrversion version;
-
-		class Compressor : public util::Runnable
+			common::ShmRing *shmRing;
+			bool sendTiming;  unsigned int frameID;
+			// With RR_CAP_LOSSLESS, tiles that contain few colors are sent with
+			// RRCOMP_LOSSLESS rather than RRCOMP_JPEG.
+			bool lossless;
+			int adaptQual, refineQual, refineSubsamp;
+			double avgFrameTime;  int spoiled;
+			TileState *tileStates;
+			int nTiles, tileFrameW, tileFrameH, tileStateSize;
+			common::Frame *lastQueued;
+			int lastQueuedW, lastQueuedH, lastQueuedPF;
+			bool lastQueuedStereo, lastQueuedBottomUp;
+			util::CriticalSection bwMutex;  double bwEst, rttEst;
+			long long bytesWritten, sampleAcked;  bool sampleBusy;
+			double sampleSendTime;  util::Timer sampleTimer;
+			double paceTokens;  util::Timer paceTimer;
+			common::CaptureWriter *capture;
+
+		class Compressor : public util::WorkerPool::Job
 		{
 			public:
 
 				Compressor(int myRank_, VGLTrans *parent_) : bytes(0),
 					storedFrames(0), cframes(NULL), frame(NULL), lastFrame(NULL),
-					myRank(myRank_), deadYet(false), parent(parent_)
+					myRank(myRank_), yuvEncoder(NULL), parent(parent_)
 				{
 					if(parent) nprocs = parent->nprocs;
-					ready.wait();  complete.wait();
 					char temps[20];
 					snprintf(temps, 20, "Compress %d", myRank);
 					profComp.setName(temps);
-					#ifdef USEHELGRIND
-					ANNOTATE_BENIGN_RACE_SIZED(&deadYet, sizeof(bool), );
-					#endif
 				}
 
 				virtual ~Compressor(void)
 				{
-					shutdown();
 					free(cframes);  cframes = NULL;
+					delete yuvEncoder;  yuvEncoder = NULL;
 				}
 
-				void run(void)
-				{
-					while(!deadYet)
-					{
-						try
-						{
-							ready.wait();  if(deadYet) break;
-							compressSend(frame, lastFrame);
-							complete.signal();
-						}
-						catch(...)
-						{
-							complete.signal();  throw;
-						}
-					}
-				}
-
-				void go(common::Frame *frame_, common::Frame *lastFrame_)
+				void setFrame(common::Frame *frame_, common::Frame *lastFrame_)
 				{
 					frame = frame_;  lastFrame = lastFrame_;
-					ready.signal();
-				}
-
-				void stop(void)
-				{
-					complete.wait();
 				}
 
-				void shutdown(void) { deadYet = true;  ready.signal(); }
+				void execute(void) { compressSend(frame, lastFrame); }
 				void compressSend(common::Frame *frame, common::Frame *lastFrame);
 				void send(void);
 
@@ -139,9 +234,8 @@ namespace server
 				int storedFrames;  common::CompressedFrame **cframes;
 				common::Frame *frame, *lastFrame;
 				int myRank, nprocs;
-				util::Event ready, complete;  bool deadYet;
-				util::CriticalSection mutex;
 				common::Profiler profComp;
+				common::YUVEncoder *yuvEncoder;
 				VGLTrans *parent;
 		};
 	};
@@ -18,6 +18,8 @@
 #include <string.h>
 #include "glxvisual.h"
 #include "TempContext.h"
+#include "ContextHash.h"
+#include "ReadbackThread.h"
 #include "vglutil.h"
 #include "faker.h"
 #include "glpf.h"
@@ -50,8 +52,9 @@ static Window create_window(Display *dpy, XVisualInfo *vis, int width,
 
 VirtualDrawable::OGLDrawable::OGLDrawable(Display *dpy_, int width_,
 	int height_, VGLFBConfig config_) : cleared(false), stereo(false),
-	glxDraw(0), dpy(dpy_), edpy(EGL_NO_DISPLAY), width(width_), height(height_),
-	depth(0), config(config_), glFormat(0), pm(0), win(0), isPixmap(false)
+	swapCount(0), glxDraw(0), dpy(dpy_), edpy(EGL_NO_DISPLAY), width(width_),
+	height(height_), depth(0), config(config_), glFormat(0), pm(0), win(0),
+	isPixmap(false)
 {
 	if(!config_ || width_ < 1 || height_ < 1) THROW("Invalid argument");
 
@@ -68,9 +71,9 @@ VirtualDrawable::OGLDrawable::OGLDrawable(Display *dpy_, int width_,
 
 VirtualDrawable::OGLDrawable::OGLDrawable(EGLDisplay edpy_, int width_,
 	int height_, EGLConfig config_, const EGLint *pbAttribs_) : cleared(false),
-	stereo(false), glxDraw(0), dpy(NULL), edpy(edpy_), width(width_),
-	height(height_), depth(0), config((VGLFBConfig)config_), glFormat(0), pm(0),
-	win(0), isPixmap(false)
+	stereo(false), swapCount(0), glxDraw(0), dpy(NULL), edpy(edpy_),
+	width(width_), height(height_), depth(0), config((VGLFBConfig)config_),
+	glFormat(0), pm(0), win(0), isPixmap(false)
 {
 	if(!edpy_ || width_ < 1 || height_ < 1 || !config_ || !pbAttribs_)
 		THROW("Invalid argument");
@@ -96,8 +99,9 @@ VirtualDrawable::OGLDrawable::OGLDrawable(EGLDisplay edpy_, int width_,
 
 VirtualDrawable::OGLDrawable::OGLDrawable(int width_, int height_, int depth_,
 	VGLFBConfig config_, const int *attribs) : cleared(false), stereo(false),
-	glxDraw(0), edpy(EGL_NO_DISPLAY), width(width_), height(height_),
-	depth(depth_), config(config_), glFormat(0), pm(0), win(0), isPixmap(true)
+	swapCount(0), glxDraw(0), edpy(EGL_NO_DISPLAY), width(width_),
+	height(height_), depth(depth_), config(config_), glFormat(0), pm(0), win(0),
+	isPixmap(true)
 {
 	if(!config_ || width_ < 1 || height_ < 1 || depth_ < 0)
 		THROW("Invalid argument");
@@ -208,6 +212,7 @@ void VirtualDrawable::OGLDrawable::clear(void)
 
 void VirtualDrawable::OGLDrawable::swap(void)
 {
+	swapCount++;
 	if(edpy != EGL_NO_DISPLAY) return;
 	if(isPixmap)
 		_glXSwapBuffers(DPY3D, glxDraw);
@@ -216,6 +221,38 @@ void VirtualDrawable::OGLDrawable::swap(void)
 }
 
 
+// Return the number of frames ago that the contents of the back buffer were
+// rendered (GLX_EXT_buffer_age/EGL_EXT_buffer_age), or 0 if the contents are
+// undefined.
+
+int VirtualDrawable::OGLDrawable::getBufferAge(void)
+{
+	unsigned int age = 0;
+
+	// The EGL/X11 front end uses single-buffered Pbuffers, and the AMDGPU hack
+	// copies the back buffer to the front buffer, so in both cases, swapping
+	// leaves the contents of the back buffer intact.
+	if(edpy != EGL_NO_DISPLAY || fconfig.amdgpuHack) return swapCount ? 1 : 0;
+	if(isPixmap || !swapCount) return 0;
+
+	if(!fconfig.egl)
+	{
+		static int hasBufferAge = -1;
+		if(hasBufferAge < 0)
+		{
+			const char *exts = _glXQueryExtensionsString(DPY3D,
+				DefaultScreen(DPY3D));
+			hasBufferAge = (exts && strstr(exts, "GLX_EXT_buffer_age")) ? 1 : 0;
+		}
+		if(!hasBufferAge) return 0;
+	}
+	backend::queryDrawable(dpy, glxDraw, GLX_BACK_BUFFER_AGE_EXT, &age);
+	// If the drawable was recycled from the drawable pool, then the back buffer
+	// may contain a frame that was rendered for a different window.
+	return age > swapCount ? 0 : age;
+}
+
+
 // This class encapsulates the relationship between an X11 drawable and the
 // 3D off-screen drawable that backs it.
 
@@ -232,10 +269,15 @@ VirtualDrawable::VirtualDrawable(Display *dpy_, Drawable x11Draw_)
 	ctx = 0;
 	direct = -1;
 	pbo = 0;
+	memset(stripePBOs, 0, sizeof(GLuint) * MAXSTRIPES);
+	rbThread = NULL;
 	numSync = numFrames = 0;
 	lastFormat = -1;
-	usePBO = (fconfig.readback == RRREAD_PBO);
+	stripeFence = -1;
+	usePBO = (fconfig.readback == RRREAD_PBO
+		|| fconfig.readback == RRREAD_THREAD);
 	alreadyPrinted = alreadyWarned = alreadyWarnedRenderMode = false;
+	alreadyWarnedTopDown = alreadyPrintedStripes = false;
 	ext = NULL;
 	eventMask = 0;
 }
@@ -268,7 +310,7 @@ int VirtualDrawable::init(int width, int height, VGLFBConfig config_)
 	if(oglDraw && oglDraw->getWidth() == width && oglDraw->getHeight() == height
 		&& FBCID(oglDraw->getFBConfig()) == FBCID(config_))
 		return 0;
-	oglDraw = new OGLDrawable(dpy, width, height, config_);
+	oglDraw = acquireDrawable(dpy, width, height, config_);
 	if(config && FBCID(config_) != FBCID(config) && ctx)
 	{
 		backend::destroyContext(dpy, ctx);  ctx = 0;
@@ -278,6 +320,125 @@ int VirtualDrawable::init(int width, int height, VGLFBConfig config_)
 }
 
 
+size_t VirtualDrawable::OGLDrawable::getSize(void)
+{
+	GLXAttrib &attr = config->attr;
+	size_t colorBytes = max((attr.redSize + attr.greenSize + attr.blueSize +
+		attr.alphaSize + 7) / 8, 4);
+	// Depth and stencil are usually stored together, with 24-bit depth and
+	// 8-bit stencil occupying 32 bits.
+	size_t depthStencilBytes =
+		(max(attr.depthSize, 0) + max(attr.stencilSize, 0) + 31) / 32 * 4;
+	int nBuffers = (attr.doubleBuffer ? 2 : 1) * (stereo ? 2 : 1);
+	size_t bytesPerPixel = colorBytes * nBuffers + depthStencilBytes;
+
+	// A multisampled drawable also needs single-sampled color buffers into
+	// which to resolve the samples.
+	if(attr.samples > 1)
+		bytesPerPixel = bytesPerPixel * attr.samples + colorBytes * nBuffers;
+	return (size_t)width * height * bytesPerPixel;
+}
+
+
+VirtualDrawable::OGLDrawable *VirtualDrawable::pool[MAXPOOLED];
+int VirtualDrawable::poolCount = 0;
+size_t VirtualDrawable::poolBytes = 0;
+CriticalSection VirtualDrawable::poolMutex;
+
+
+// Return a pooled Pbuffer with the specified size and FB config, or create a
+// new one if there is no such Pbuffer in the pool.  Reusing a larger Pbuffer
+// would change the default viewport and the values returned by
+// glXQueryDrawable(), so only an exact match will do.
+
+VirtualDrawable::OGLDrawable *VirtualDrawable::acquireDrawable(Display *dpy,
+	int width, int height, VGLFBConfig config)
+{
+	if(fconfig.drawpool > 0)
+	{
+		CriticalSection::SafeLock l(poolMutex);
+		for(int i = poolCount - 1; i >= 0; i--)
+		{
+			OGLDrawable *draw = pool[i];
+			if(draw->getDisplay() == dpy && draw->getWidth() == width
+				&& draw->getHeight() == height
+				&& FBCID(draw->getFBConfig()) == FBCID(config))
+			{
+				poolBytes -= draw->getSize();
+				for(int j = i; j < poolCount - 1; j++) pool[j] = pool[j + 1];
+				poolCount--;
+				draw->reset();
+				return draw;
+			}
+		}
+	}
+	return new OGLDrawable(dpy, width, height, config);
+}
+
+
+// Return a Pbuffer that is no longer needed to the pool, evicting the least
+// recently released Pbuffers if necessary to stay within the limits of the
+// pool.  A Pbuffer that is still bound to a context (because the window was
+// destroyed while a context was current) is destroyed instead, since another
+// window could otherwise receive a Pbuffer that a context is rendering into.
+
+void VirtualDrawable::releaseDrawable(OGLDrawable *draw)
+{
+	OGLDrawable *evicted[MAXPOOLED];  int nEvicted = 0;
+
+	if(!draw) return;
+	if(fconfig.drawpool <= 0 || !draw->isPoolable()
+		|| CTXHASH.isCurrent(draw->getGLXDrawable()))
+	{
+		delete draw;  return;
+	}
+	size_t size = draw->getSize(), limit = (size_t)fconfig.drawpool * 1048576;
+	if(size > limit)
+	{
+		delete draw;  return;
+	}
+
+	{
+		CriticalSection::SafeLock l(poolMutex);
+		while(poolCount > 0
+			&& (poolCount >= MAXPOOLED || poolBytes + size > limit))
+		{
+			evicted[nEvicted++] = pool[0];
+			poolBytes -= pool[0]->getSize();
+			for(int j = 0; j < poolCount - 1; j++) pool[j] = pool[j + 1];
+			poolCount--;
+		}
+		pool[poolCount++] = draw;
+		poolBytes += size;
+	}
+
+	for(int i = 0; i < nEvicted; i++) delete evicted[i];
+}
+
+
+void VirtualDrawable::purgeDrawablePool(Display *dpy)
+{
+	OGLDrawable *purged[MAXPOOLED];  int nPurged = 0;
+
+	{
+		CriticalSection::SafeLock l(poolMutex);
+		int j = 0;
+		for(int i = 0; i < poolCount; i++)
+		{
+			if(!dpy || pool[i]->getDisplay() == dpy)
+			{
+				poolBytes -= pool[i]->getSize();
+				purged[nPurged++] = pool[i];
+			}
+			else pool[j++] = pool[i];
+		}
+		poolCount = j;
+	}
+
+	for(int i = 0; i < nPurged; i++) delete purged[i];
+}
+
+
 void VirtualDrawable::setDirect(Bool direct_)
 {
 	if(edpy != EGL_NO_DISPLAY)
@@ -311,6 +472,13 @@ GLXDrawable VirtualDrawable::getGLXDrawable(void)
 }
 
 
+int VirtualDrawable::getBufferAge(void)
+{
+	CriticalSection::SafeLock l(mutex);
+	return oglDraw ? oglDraw->getBufferAge() : 0;
+}
+
+
 Display *VirtualDrawable::getX11Display(void)
 {
 	return dpy;
@@ -398,7 +566,7 @@ bool VirtualDrawable::checkRenderMode(void)
 
 void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 	GLint height, GLenum glFormat, PF *pf, GLubyte *bits, GLint readBuf,
-	bool stereo)
+	bool stereo, bool topDown)
 {
 	double t0 = 0.0, tRead, tTotal;
 	GLenum type = GL_UNSIGNED_BYTE;
@@ -416,7 +584,8 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 		(glFormat == GL_GREEN || glFormat == GL_BLUE) ? GL_RED : glFormat;
 	if(lastFormat >= 0 && lastFormat != currentFormat)
 	{
-		usePBO = (fconfig.readback == RRREAD_PBO);
+		usePBO = (fconfig.readback == RRREAD_PBO
+			|| fconfig.readback == RRREAD_THREAD);
 		numSync = numFrames = 0;
 		alreadyPrinted = alreadyWarned = false;
 	}
@@ -424,34 +593,53 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 
 	if(!checkRenderMode()) return;
 
-	initReadbackContext();
+	// The readback thread's context is already bound to the off-screen
+	// drawable, and the readback thread must not acquire the mutex.
+	GLXContext readCtx;  GLuint *readPBO = &pbo;
+	GLXDrawable readDraw;
+	if(rbThread && rbThread->isCurrent())
+	{
+		readCtx = rbThread->getContext();  readPBO = rbThread->getPBO();
+		readDraw = oglDraw->getGLXDrawable();
+	}
+	else
+	{
+		initReadbackContext();
+		readCtx = ctx;  readDraw = getGLXDrawable();
+	}
 	TempContext tc(edpy != EGL_NO_DISPLAY ? (Display *)edpy : dpy,
-		getGLXDrawable(), getGLXDrawable(), ctx, edpy != EGL_NO_DISPLAY);
+		readDraw, readDraw, readCtx, edpy != EGL_NO_DISPLAY);
 
 	backend::readBuffer(readBuf);
 
-	if(pitch % 8 == 0) _glPixelStorei(GL_PACK_ALIGNMENT, 8);
-	else if(pitch % 4 == 0) _glPixelStorei(GL_PACK_ALIGNMENT, 4);
-	else if(pitch % 2 == 0) _glPixelStorei(GL_PACK_ALIGNMENT, 2);
-	else if(pitch % 1 == 0) _glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	int align = 1;
+	if(pitch % 8 == 0) align = 8;
+	else if(pitch % 4 == 0) align = 4;
+	else if(pitch % 2 == 0) align = 2;
+	_glPixelStorei(GL_PACK_ALIGNMENT, align);
+
+	// When reading back a sub-rectangle of a larger frame, the row stride is
+	// wider than the rectangle.
+	int rowSize = (width * pf->size + align - 1) & (~(align - 1));
+	bool strided = (pitch != rowSize && pitch % pf->size == 0);
+	_glPixelStorei(GL_PACK_ROW_LENGTH, strided ? pitch / pf->size : 0);
+
+	if((usePBO || topDown) && !ext)
+		ext = (const char *)_glGetString(GL_EXTENSIONS);
 
 	if(usePBO)
 	{
-		if(!ext)
-		{
-			ext = (const char *)_glGetString(GL_EXTENSIONS);
-			if(!ext || !strstr(ext, "GL_ARB_pixel_buffer_object"))
-				THROW("GL_ARB_pixel_buffer_object extension not available");
-		}
-		if(!pbo) _glGenBuffers(1, &pbo);
-		if(!pbo) THROW("Could not generate pixel buffer object");
+		if(!ext || !strstr(ext, "GL_ARB_pixel_buffer_object"))
+			THROW("GL_ARB_pixel_buffer_object extension not available");
+		if(!*readPBO) _glGenBuffers(1, readPBO);
+		if(!*readPBO) THROW("Could not generate pixel buffer object");
 		if(!alreadyPrinted && fconfig.verbose)
 		{
 			vglout.println("[VGL] Using pixel buffer objects for readback (%s --> %s)",
 				formatString(oglDraw->getFormat()), formatString(glFormat));
 			alreadyPrinted = true;
 		}
-		_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, pbo);
+		_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, *readPBO);
 		int size = 0;
 		_glGetBufferParameteriv(GL_PIXEL_PACK_BUFFER_EXT, GL_BUFFER_SIZE, &size);
 		if(size != pitch * height)
@@ -471,11 +659,24 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 		}
 	}
 
+	// If a top-down image was requested, then let OpenGL reverse the row order,
+	// either while packing the pixels (GL_MESA_pack_invert) or by blitting the
+	// region upside down into a temporary renderbuffer.  The rows are flipped
+	// on the CPU only if neither is possible.
+	bool packInvert = topDown && ext && strstr(ext, "GL_MESA_pack_invert");
+	bool cpuFlip = false;
+
 	TRY_GL();
 	profReadback.startFrame();
 	if(usePBO) t0 = GetTime();
-	backend::readPixels(x, y, width, height, glFormat, type,
-		usePBO ? NULL : bits);
+	if(packInvert) _glPixelStorei(GL_PACK_INVERT_MESA, GL_TRUE);
+	if(topDown && !packInvert)
+		cpuFlip = !backend::readPixelsFlipped(x, y, width, height, glFormat, type,
+			usePBO ? NULL : bits, oglDraw->getRGBSize() > 24);
+	if(!topDown || packInvert || cpuFlip)
+		backend::readPixels(x, y, width, height, glFormat, type,
+			usePBO ? NULL : bits);
+	if(packInvert) _glPixelStorei(GL_PACK_INVERT_MESA, GL_FALSE);
 
 	if(usePBO)
 	{
@@ -484,7 +685,12 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 		pboBits = (unsigned char *)_glMapBuffer(GL_PIXEL_PACK_BUFFER_EXT,
 			GL_READ_ONLY);
 		if(!pboBits) THROW("Could not map pixel buffer object");
-		memcpy(bits, pboBits, pitch * height);
+		if(strided)
+		{
+			for(int i = 0; i < height; i++)
+				memcpy(&bits[pitch * i], &pboBits[pitch * i], width * pf->size);
+		}
+		else memcpy(bits, pboBits, pitch * height);
 		if(!_glUnmapBuffer(GL_PIXEL_PACK_BUFFER_EXT))
 			THROW("Could not unmap pixel buffer object");
 		_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, 0);
@@ -515,11 +721,173 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 		}
 	}
 
+	if(cpuFlip)
+	{
+		if(!alreadyWarnedTopDown && fconfig.verbose)
+		{
+			vglout.println("[VGL] NOTICE: Could not read back pixels in top-down order using OpenGL.");
+			vglout.println("[VGL]    Flipping the rows on the CPU instead.");
+			alreadyWarnedTopDown = true;
+		}
+		flipRows(bits, pitch, width * pf->size, height);
+	}
+
 	profReadback.endFrame(width * height, 0, stereo ? 0.5 : 1);
 	CATCH_GL("Could not read pixels");
 
-	// If automatic faker testing is enabled, store the FB color in an
-	// environment variable so the test program can verify it
+	autotest(bits, width, pitch, height, pf, readBuf);
+}
+
+
+// Read back a region of the off-screen drawable in horizontal stripes, from
+// the top of the region to the bottom.  Each stripe is read into its own PBO,
+// followed by a fence, so the GPU can transfer the later stripes while the
+// earlier ones are being copied out.  As each stripe lands, it is passed to
+// stripeReady() and then signaled in f, so an image transport that already
+// has f can start compressing the stripe.  Returns false, without reading
+// anything, if striped readback cannot be used, in which case the caller
+// should use readPixels() instead.
+
+bool VirtualDrawable::readPixelsStriped(GLint x, GLint y, GLint width,
+	GLint pitch, GLint height, GLint stripeHeight, GLenum glFormat, PF *pf,
+	GLubyte *bits, GLint readBuf, bool topDown, common::Frame *f)
+{
+	GLenum type = GL_UNSIGNED_BYTE;
+
+	if(glFormat == GL_NONE)
+	{
+		glFormat = pf_glformat[pf->id];  type = pf_gldatatype[pf->id];
+	}
+	if(glFormat == GL_NONE) THROW("Unsupported pixel format");
+
+	if(!f || stripeHeight < 1) return false;
+	int nStripes = (height + stripeHeight - 1) / stripeHeight;
+	if(!usePBO || nStripes < 2 || nStripes > MAXSTRIPES) return false;
+	// The readback thread's context does not share objects with ctx.
+	if(rbThread && rbThread->isCurrent()) return false;
+	// A multisampled drawable would be resolved once for every stripe.
+	if(edpy == EGL_NO_DISPLAY && config && config->attr.samples > 1)
+		return false;
+	if(!checkRenderMode()) return false;
+
+	initReadbackContext();
+	TempContext tc(edpy != EGL_NO_DISPLAY ? (Display *)edpy : dpy,
+		getGLXDrawable(), getGLXDrawable(), ctx, edpy != EGL_NO_DISPLAY);
+
+	if(!ext) ext = (const char *)_glGetString(GL_EXTENSIONS);
+	if(!ext || !strstr(ext, "GL_ARB_pixel_buffer_object")) return false;
+	// Reversing the row order with a blit would require a temporary
+	// renderbuffer for each stripe.
+	if(topDown && !strstr(ext, "GL_MESA_pack_invert")) return false;
+	if(stripeFence < 0)
+	{
+		const char *version = (const char *)_glGetString(GL_VERSION);
+		int major = 0, minor = 0;
+		if(version) sscanf(version, "%d.%d", &major, &minor);
+		stripeFence = (major > 3 || (major == 3 && minor >= 2)
+			|| strstr(ext, "GL_ARB_sync"));
+	}
+
+	backend::readBuffer(readBuf);
+
+	int align = 1;
+	if(pitch % 8 == 0) align = 8;
+	else if(pitch % 4 == 0) align = 4;
+	else if(pitch % 2 == 0) align = 2;
+	_glPixelStorei(GL_PACK_ALIGNMENT, align);
+
+	int rowSize = (width * pf->size + align - 1) & (~(align - 1));
+	bool strided = (pitch != rowSize && pitch % pf->size == 0);
+	_glPixelStorei(GL_PACK_ROW_LENGTH, strided ? pitch / pf->size : 0);
+
+	if(!alreadyPrintedStripes && fconfig.verbose)
+	{
+		vglout.println("[VGL] Using striped PBO readback (%d stripes, %s --> %s)",
+			nStripes, formatString(oglDraw->getFormat()), formatString(glFormat));
+		alreadyPrintedStripes = true;
+	}
+
+	GLsync fences[MAXSTRIPES];
+	memset(fences, 0, sizeof(GLsync) * MAXSTRIPES);
+	try
+	{
+		TRY_GL();
+		profReadback.startFrame();
+
+		if(topDown) _glPixelStorei(GL_PACK_INVERT_MESA, GL_TRUE);
+		for(int i = 0; i < nStripes; i++)
+		{
+			int sy = i * stripeHeight, sh = min(stripeHeight, height - sy);
+			if(!stripePBOs[i]) _glGenBuffers(1, &stripePBOs[i]);
+			if(!stripePBOs[i]) THROW("Could not generate pixel buffer object");
+			_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, stripePBOs[i]);
+			int size = 0;
+			_glGetBufferParameteriv(GL_PIXEL_PACK_BUFFER_EXT, GL_BUFFER_SIZE, &size);
+			if(size != pitch * sh)
+				_glBufferData(GL_PIXEL_PACK_BUFFER_EXT, pitch * sh, NULL,
+					GL_STREAM_READ);
+			_glGetBufferParameteriv(GL_PIXEL_PACK_BUFFER_EXT, GL_BUFFER_SIZE, &size);
+			if(size != pitch * sh)
+				THROW("Could not set PBO size");
+			// Stripe i covers the rows sy through sy + sh - 1, counting from the
+			// top of the region.
+			backend::readPixels(x, y + height - sy - sh, width, sh, glFormat, type,
+				NULL);
+			if(stripeFence)
+				fences[i] = _glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		if(topDown) _glPixelStorei(GL_PACK_INVERT_MESA, GL_FALSE);
+		_glFlush();
+
+		for(int i = 0; i < nStripes; i++)
+		{
+			int sy = i * stripeHeight, sh = min(stripeHeight, height - sy);
+			unsigned char *dst = &bits[pitch * (topDown ? sy : height - sy - sh)];
+			if(fences[i])
+			{
+				_glClientWaitSync(fences[i], 0, GL_TIMEOUT_IGNORED);
+				_glDeleteSync(fences[i]);  fences[i] = 0;
+			}
+			_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, stripePBOs[i]);
+			unsigned char *pboBits = (unsigned char *)_glMapBuffer(
+				GL_PIXEL_PACK_BUFFER_EXT, GL_READ_ONLY);
+			if(!pboBits) THROW("Could not map pixel buffer object");
+			if(strided)
+			{
+				for(int j = 0; j < sh; j++)
+					memcpy(&dst[pitch * j], &pboBits[pitch * j], width * pf->size);
+			}
+			else memcpy(dst, pboBits, pitch * sh);
+			if(!_glUnmapBuffer(GL_PIXEL_PACK_BUFFER_EXT))
+				THROW("Could not unmap pixel buffer object");
+			stripeReady(dst, width, pitch, sh, pf);
+			f->signalStripe(i);
+		}
+		_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, 0);
+
+		profReadback.endFrame(width * height, 0, 1);
+		CATCH_GL("Could not read pixels");
+	}
+	catch(...)
+	{
+		for(int i = 0; i < nStripes; i++)
+			if(fences[i]) _glDeleteSync(fences[i]);
+		if(topDown) _glPixelStorei(GL_PACK_INVERT_MESA, GL_FALSE);
+		_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, 0);
+		throw;
+	}
+
+	autotest(bits, width, pitch, height, pf, readBuf);
+	return true;
+}
+
+
+// If automatic faker testing is enabled, store the FB color in an environment
+// variable so the test program can verify it
+
+void VirtualDrawable::autotest(GLubyte *bits, GLint width, GLint pitch,
+	GLint height, PF *pf, GLint readBuf)
+{
 	if(fconfig.autotest)
 	{
 		unsigned char *rowptr, *pixel;  int match = 1;
@@ -555,6 +923,24 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 }
 
 
+// Reverse the order of the rows in a region of a frame buffer
+
+void VirtualDrawable::flipRows(unsigned char *bits, int pitch, int rowSize,
+	int height)
+{
+	unsigned char *tmp = new unsigned char[rowSize];
+	unsigned char *top = bits, *bottom = &bits[pitch * (height - 1)];
+	while(top < bottom)
+	{
+		memcpy(tmp, top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, tmp, rowSize);
+		top += pitch;  bottom -= pitch;
+	}
+	delete [] tmp;
+}
+
+
 void VirtualDrawable::copyPixels(GLint srcX, GLint srcY, GLint width,
 	GLint height, GLint destX, GLint destY, GLXDrawable draw, GLint readBuf,
 	GLint drawBuf)
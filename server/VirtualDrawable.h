@@ -22,8 +22,15 @@
 #include "Frame.h"
 
 
+// Largest number of stripes into which VirtualDrawable::readPixelsStriped()
+// will divide a frame
+#define MAXSTRIPES  32
+
+
 namespace faker
 {
+	class ReadbackThread;
+
 	class VirtualDrawable
 	{
 		public:
@@ -42,9 +49,14 @@ namespace faker
 			int getWidth(void) { return oglDraw ? oglDraw->getWidth() : -1; }
 			int getHeight(void) { return oglDraw ? oglDraw->getHeight() : -1; }
 			bool isInit(void) { return direct == True || direct == False; }
+			int getBufferAge(void);
 			void setEventMask(unsigned long mask) { eventMask = mask; }
 			unsigned long getEventMask(void) { return eventMask; }
 
+			// Destroy all pooled drawables associated with the specified display (or
+			// all pooled drawables, if dpy is NULL)
+			static void purgeDrawablePool(Display *dpy);
+
 		protected:
 
 			// A container class for the actual off-screen drawable
@@ -73,14 +85,33 @@ namespace faker
 					VGLFBConfig getFBConfig(void) { return config; }
 					void clear(void);
 					void swap(void);
+					void setSwapped(void) { swapCount++; }
+					int getBufferAge(void);
 					bool isStereo(void) { return stereo; }
 					GLenum getFormat(void) { return glFormat; }
+					Display *getDisplay(void) { return dpy; }
+
+					// Only GLX front end Pbuffers can be recycled through the drawable
+					// pool.
+					bool isPoolable(void)
+					{
+						return !isPixmap && edpy == EGL_NO_DISPLAY;
+					}
+
+					// Approximate amount of GPU memory occupied by the drawable,
+					// including all color buffers, the depth/stencil buffer, and
+					// multisampling
+					size_t getSize(void);
+
+					// Prepare a recycled drawable for use with a new window
+					void reset(void) { cleared = false;  swapCount = 0; }
 
 				private:
 
 					void setVisAttribs(void);
 
 					bool cleared, stereo;
+					unsigned int swapCount;
 					GLXDrawable glxDraw;
 					Display *dpy;
 					EGLDisplay edpy;
@@ -92,10 +123,29 @@ namespace faker
 					bool isPixmap;
 			};
 
+			// The drawable pool retains the Pbuffers that back recently destroyed or
+			// resized windows, so that they can be reused when a window of the same
+			// size and FB config is created.
+			static OGLDrawable *acquireDrawable(Display *dpy, int width, int height,
+				VGLFBConfig config);
+			static void releaseDrawable(OGLDrawable *draw);
+
 			void initReadbackContext(void);
 			bool checkRenderMode(void);
 			void readPixels(GLint x, GLint y, GLint width, GLint pitch, GLint height,
-				GLenum glFormat, PF *pf, GLubyte *bits, GLint readBuf, bool stereo);
+				GLenum glFormat, PF *pf, GLubyte *bits, GLint readBuf, bool stereo,
+				bool topDown = false);
+			bool readPixelsStriped(GLint x, GLint y, GLint width, GLint pitch,
+				GLint height, GLint stripeHeight, GLenum glFormat, PF *pf,
+				GLubyte *bits, GLint readBuf, bool topDown, common::Frame *f);
+			// Called by readPixelsStriped() for each stripe, after the stripe has
+			// been copied into the destination buffer and before it is signaled
+			virtual void stripeReady(GLubyte *bits, GLint width, GLint pitch,
+				GLint height, PF *pf) {}
+			void autotest(GLubyte *bits, GLint width, GLint pitch, GLint height,
+				PF *pf, GLint readBuf);
+			static void flipRows(unsigned char *bits, int pitch, int rowSize,
+				int height);
 
 			util::CriticalSection mutex;
 			Display *dpy;  Drawable x11Draw;
@@ -107,12 +157,23 @@ namespace faker
 			common::Profiler profReadback;
 			int autotestFrameCount;
 
-			GLuint pbo;
-			int numSync, numFrames, lastFormat;
+			GLuint pbo, stripePBOs[MAXSTRIPES];
+			// If readPixels() is called from this thread, then it uses the thread's
+			// context and PBO rather than ctx and pbo.  (Only VirtualWin creates a
+			// readback thread.)
+			ReadbackThread *rbThread;
+			int numSync, numFrames, lastFormat, stripeFence;
 			bool usePBO;
-			bool alreadyPrinted, alreadyWarned, alreadyWarnedRenderMode;
+			bool alreadyPrinted, alreadyWarned, alreadyWarnedRenderMode,
+				alreadyWarnedTopDown, alreadyPrintedStripes;
 			const char *ext;
 			unsigned long eventMask;
+
+			static const int MAXPOOLED = 16;
+			static OGLDrawable *pool[MAXPOOLED];
+			static int poolCount;
+			static size_t poolBytes;
+			static util::CriticalSection poolMutex;
 	};
 }
 
@@ -16,6 +16,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/dma-buf.h>
+#endif
 #include "fakerconfig.h"
 #include "glxvisual.h"
 #include "vglutil.h"
@@ -49,6 +55,7 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 	VirtualDrawable(dpy_, win)
 {
 	eventdpy = NULL;
+	resizeWatcher = NULL;
 	oldDraw = NULL;  newWidth = newHeight = -1;
 	x11trans = NULL;
 	#ifdef USEXV
@@ -68,6 +75,12 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 	newConfig = false;
 	swapInterval = 0;
 	alreadyWarnedPluginRenderMode = false;
+	damageX = damageY = damageW = damageH = 0;
+	lastFrameVGL = false;
+	rbPending = rbDisabled = rbDamageValid = false;
+	rbStereoMode = rbCompress = rbQual = rbSubsamp = 0;
+	rbDamageX = rbDamageY = rbDamageW = rbDamageH = 0;
+	triggerTime = 0.;
 	XWindowAttributes xwa;
 	if(!XGetWindowAttributes(dpy, win, &xwa) || !xwa.visual)
 		throw(Error(__FUNCTION__, "Invalid window", -1));
@@ -79,6 +92,19 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 		if(fconfig.verbose)
 			vglout.println("[VGL] Selecting structure notify events in window 0x%.8x",
 				win);
+		XFlush(eventdpy);
+		try
+		{
+			resizeWatcher = new ResizeWatcher(eventdpy, win);
+			eventdpy = NULL;
+		}
+		catch(std::exception &e)
+		{
+			// Fall back to checking for ConfigureNotify events in checkResize().
+			if(fconfig.verbose)
+				vglout.println("[VGL] WARNING: Could not start resize watcher:\n[VGL]    %s",
+					e.what());
+		}
 	}
 	stereoVisual = false;
 	if(edpy != EGL_NO_DISPLAY)
@@ -89,8 +115,13 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 
 VirtualWin::~VirtualWin(void)
 {
+	delete resizeWatcher;  resizeWatcher = NULL;
+	// The readback thread must be shut down before the off-screen drawable and
+	// the transport are destroyed.
+	delete rbThread;  rbThread = NULL;
 	mutex.lock(false);
 	delete oldDraw;  oldDraw = NULL;
+	releaseDrawable(oglDraw);  oglDraw = NULL;
 	delete x11trans;  x11trans = NULL;
 	delete vglconn;  vglconn = NULL;
 	#ifdef USEXV
@@ -117,6 +148,7 @@ int VirtualWin::init(int w, int h, VGLFBConfig config_)
 {
 	CriticalSection::SafeLock l(mutex);
 	if(deletedByWM) THROW("Window has been deleted by window manager");
+	if(rbThread) rbThread->wait();
 	return VirtualDrawable::init(w, h, config_);
 }
 
@@ -157,6 +189,7 @@ void VirtualWin::clear(void)
 {
 	CriticalSection::SafeLock l(mutex);
 	if(deletedByWM) THROW("Window has been deleted by window manager");
+	if(rbThread) rbThread->wait();
 	VirtualDrawable::clear();
 }
 
@@ -165,6 +198,10 @@ void VirtualWin::cleanup(void)
 {
 	CriticalSection::SafeLock l(mutex);
 	if(deletedByWM) THROW("Window has been deleted by window manager");
+	// The drawable that was replaced by a resize is not pooled.  When a window
+	// is interactively resized, it would be replaced by a drawable of a
+	// different size almost every frame, so the pool would fill up with
+	// drawables that are never reused.
 	delete oldDraw;  oldDraw = NULL;
 }
 
@@ -191,9 +228,20 @@ GLXDrawable VirtualWin::getGLXDrawable(void)
 }
 
 
+// Pass any ConfigureNotify events for the window to resize().  If the resize
+// watcher is running, then it has already read the events, so this does not
+// block, but a resize that the watcher has not yet seen will be picked up by
+// a later call.  Otherwise, synchronize with the X server and read the events
+// here.
+
 void VirtualWin::checkResize(void)
 {
-	if(eventdpy)
+	if(resizeWatcher)
+	{
+		int width, height;
+		if(resizeWatcher->getNewSize(width, height)) resize(width, height);
+	}
+	else if(eventdpy)
 	{
 		XSync(dpy, False);
 		while(XPending(eventdpy) > 0)
@@ -238,18 +286,23 @@ GLXDrawable VirtualWin::updateGLXDrawable(void)
 
 void VirtualWin::swapBuffers(void)
 {
-	if(edpy != EGL_NO_DISPLAY)
-		THROW("VirtualWin::swapBuffers() method not supported with EGL/X11");
-
 	CriticalSection::SafeLock l(mutex);
 	if(deletedByWM) THROW("Window has been deleted by window manager");
 	if(oglDraw)
 	{
-		if(fconfig.amdgpuHack)
+		if(fconfig.amdgpuHack && edpy == EGL_NO_DISPLAY)
+		{
 			copyPixels(0, 0, oglDraw->getWidth(), oglDraw->getHeight(), 0, 0,
 				getGLXDrawable(), GL_BACK, GL_FRONT);
+			oglDraw->setSwapped();
+		}
 		else
 			oglDraw->swap();
+		if(rbPending)
+		{
+			rbPending = false;
+			rbThread->post(oglDraw->getGLXDrawable());
+		}
 	}
 }
 
@@ -268,6 +321,47 @@ void VirtualWin::enableWMDeleteHandler(void)
 }
 
 
+// Accumulate the region of the off-screen drawable (in OpenGL window
+// coordinates) that the application has rendered to since the last frame was
+// read back.  The damage rectangles passed to eglSwapBuffersWithDamage*() are
+// always recorded, and if VGL_DAMAGE is enabled, then the rectangles passed to
+// glViewport() and glScissor() are treated as damage hints as well.  The VGL
+// Transport reads back only the union of those rectangles.
+
+void VirtualWin::addDamage(int x, int y, int width, int height)
+{
+	CriticalSection::SafeLock l(mutex);
+	if(width <= 0 || height <= 0) return;
+	if(damageW <= 0 || damageH <= 0)
+	{
+		damageX = x;  damageY = y;  damageW = width;  damageH = height;
+		return;
+	}
+	int x2 = max(damageX + damageW, x + width);
+	int y2 = max(damageY + damageH, y + height);
+	damageX = min(damageX, x);  damageY = min(damageY, y);
+	damageW = x2 - damageX;  damageH = y2 - damageY;
+}
+
+
+// Clip the accumulated damage rectangle to the off-screen drawable and reset
+// it.  Returns false if no damage was recorded, in which case the whole
+// drawable must be read back.  (Called with the mutex held.)
+
+bool VirtualWin::getDamage(int &x, int &y, int &width, int &height)
+{
+	int w = oglDraw->getWidth(), h = oglDraw->getHeight();
+
+	if(damageW <= 0 || damageH <= 0) return false;
+	x = max(damageX, 0);  y = max(damageY, 0);
+	width = min(damageX + damageW, w) - x;
+	height = min(damageY + damageH, h) - y;
+	damageX = damageY = damageW = damageH = 0;
+	if(width <= 0 || height <= 0) { width = height = 0; }
+	return true;
+}
+
+
 void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 {
 	fconfig_reloadenv();
@@ -279,7 +373,14 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 	CriticalSection::SafeLock l(mutex);
 	if(deletedByWM) THROW("Window has been deleted by window manager");
 
+	// Wait for the readback thread to finish with the previous frame, since
+	// everything below can modify the state that it uses.  A frame that was
+	// handed to the readback thread but never swapped is discarded.
+	if(rbThread) rbThread->wait();
+	rbPending = false;
+
 	dirty = false;
+	triggerTime = GetTime();
 
 	int compress = fconfig.compress;
 	if(sync && strlen(fconfig.transport) == 0) compress = RRCOMP_PROXY;
@@ -327,10 +428,34 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 
 	if(strlen(fconfig.transport) > 0)
 	{
+		lastFrameVGL = false;
 		sendPlugin(drawBuf, spoilLast, sync, doStereo, stereoMode);
 		return;
 	}
 
+	if(_Trans[compress] != RRTRANS_VGL) lastFrameVGL = false;
+	else if(!vglconn)
+	{
+		vglconn = new VGLTrans();
+		vglconn->connect(
+			strlen(fconfig.client) > 0 ? fconfig.client : DisplayString(dpy),
+			fconfig.port);
+	}
+
+	if(useReadbackThread(drawBuf, sync, doStereo, compress))
+	{
+		// sendVGL() will be called from the readback thread, which must not
+		// access the application's X display connection or the accumulated
+		// damage.
+		if(!syncdpy) { XSync(dpy, False);  syncdpy = true; }
+		rbDamageValid = !fconfig.logo && lastFrameVGL
+			&& getDamage(rbDamageX, rbDamageY, rbDamageW, rbDamageH);
+		rbStereoMode = stereoMode;  rbCompress = compress;
+		rbQual = fconfig.qual;  rbSubsamp = fconfig.subsamp;
+		rbPending = true;
+		return;
+	}
+
 	switch(compress)
 	{
 		case RRCOMP_PROXY:
@@ -340,13 +465,6 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 		case RRCOMP_JPEG:
 		case RRCOMP_RGB:
 		case RRCOMP_YUV:
-			if(!vglconn)
-			{
-				vglconn = new VGLTrans();
-				vglconn->connect(
-					strlen(fconfig.client) > 0 ? fconfig.client : DisplayString(dpy),
-					fconfig.port);
-			}
 			sendVGL(drawBuf, spoilLast, doStereo, stereoMode, compress, fconfig.qual,
 				fconfig.subsamp);
 			break;
@@ -358,6 +476,51 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 }
 
 
+// Threaded readback is used only for frames that are read back from the back
+// buffer in response to a buffer swap and sent using the VGL Transport.  In
+// that case, the frame can be read from the front buffer after the swap,
+// while the application renders the next frame into the back buffer.  The X11
+// and XV Transports access the application's X display connection, and stereo
+// and image transport plugins are rare enough that they still use inline
+// readback.  Returns true if the caller should insert a fence and defer the
+// readback until swapBuffers() is called.
+
+bool VirtualWin::useReadbackThread(GLint drawBuf, bool sync, bool doStereo,
+	int compress)
+{
+	if(fconfig.readback != RRREAD_THREAD || rbDisabled || drawBuf != GL_BACK
+		|| sync || doStereo || isStereo() || _Trans[compress] != RRTRANS_VGL
+		|| edpy != EGL_NO_DISPLAY || fconfig.egl || fconfig.amdgpuHack)
+		return false;
+
+	try
+	{
+		if(!rbThread) rbThread = new ReadbackThread(this, dpy, config, direct);
+		rbThread->insertFence();
+	}
+	catch(std::exception &e)
+	{
+		if(fconfig.verbose)
+			vglout.println("[VGL] WARNING: Could not start readback thread:\n[VGL]    %s",
+				e.what());
+		delete rbThread;  rbThread = NULL;
+		rbDisabled = true;
+		return false;
+	}
+	return true;
+}
+
+
+// Called from the readback thread after the off-screen drawable has been
+// swapped and the GPU has finished rendering the frame
+
+void VirtualWin::readbackFromThread(void)
+{
+	sendVGL(GL_FRONT, false, false, rbStereoMode, rbCompress, rbQual,
+		rbSubsamp);
+}
+
+
 TempContext *VirtualWin::setupPluginTempContext(GLint drawBuf)
 {
 	// This code is largely copied from VirtualDrawable::readPixels().  It
@@ -389,13 +552,54 @@ TempContext *VirtualWin::setupPluginTempContext(GLint drawBuf)
 }
 
 
+// Map the memfd or dma-buf that backs a version 2 plugin frame buffer.  The
+// dma-buf sync ioctl fails harmlessly with memfds.
+
+static unsigned char *mapPluginFrame(RRFrame2 *frame, void *&base,
+	size_t &size)
+{
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if(pageSize < 1) pageSize = 4096;
+	off_t offset = (off_t)(frame->fdOffset & ~((unsigned long long)pageSize - 1));
+	size_t delta = (size_t)(frame->fdOffset - offset);
+
+	size = (size_t)frame->f.pitch * frame->f.h + delta;
+	base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, frame->fd,
+		offset);
+	if(base == MAP_FAILED) { base = NULL;  THROW_UNIX(); }
+	#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync = { DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE };
+	ioctl(frame->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	#endif
+	return (unsigned char *)base + delta;
+}
+
+
+static void unmapPluginFrame(RRFrame2 *frame, void *&base, size_t size)
+{
+	if(!base) return;
+	#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync = { DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE };
+	ioctl(frame->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	#endif
+	munmap(base, size);
+	base = NULL;
+}
+
+
 void VirtualWin::sendPlugin(GLint drawBuf, bool spoilLast, bool sync,
 	bool doStereo, int stereoMode)
 {
 	Frame f;
 	int w = oglDraw->getWidth(), h = oglDraw->getHeight();
 	RRFrame *rrframe = NULL;
+	RRFrame2 *rrframe2 = NULL;
+	RRFrameInfo info;
 	TempContext *tc = NULL;
+	void *mapBase = NULL;  size_t mapSize = 0;
+
+	memset(&info, 0, sizeof(RRFrameInfo));
+	info.tRequest = GetTime();
 
 	try
 	{
@@ -422,12 +626,41 @@ void VirtualWin::sendPlugin(GLint drawBuf, bool spoilLast, bool sync,
 		else if(oglDraw->getFormat() == GL_BGRA) desiredFormat = RRTRANS_BGRA;
 		else if(oglDraw->getFormat() == GL_RGBA) desiredFormat = RRTRANS_RGBA;
 
-		rrframe = plugin->getFrame(w, h, desiredFormat,
-			doStereo && stereoMode == RRSTEREO_QUADBUF);
-		if(rrframe->bits)
+		if(plugin->getVersion() >= 2)
+		{
+			rrframe2 = plugin->getFrame2(w, h, desiredFormat,
+				doStereo && stereoMode == RRSTEREO_QUADBUF);
+			rrframe = &rrframe2->f;
+		}
+		else
+			rrframe = plugin->getFrame(w, h, desiredFormat,
+				doStereo && stereoMode == RRSTEREO_QUADBUF);
+
+		// Version 2 plugins receive the damaged region (in top-down
+		// coordinates), and if the plugin has preserved the previous frame, then
+		// only that region is read back.
+		int dx = 0, dy = 0, dw = rrframe->w, dh = rrframe->h;
+		bool haveDamage = rrframe2 && getDamage(dx, dy, dw, dh);
+		if(haveDamage)
 		{
-			f.init(rrframe->bits, rrframe->w, rrframe->pitch, rrframe->h,
+			dw = min(dx + dw, rrframe->w) - dx;
+			dh = min(dy + dh, rrframe->h) - dy;
+			if(dw <= 0 || dh <= 0) dw = dh = 0;
+			info.nRects = 1;
+			info.rects[0].x = dx;  info.rects[0].y = rrframe->h - dy - dh;
+			info.rects[0].w = dw;  info.rects[0].h = dh;
+		}
+
+		unsigned char *bits = rrframe->bits;
+		if(!bits && rrframe2 && rrframe2->fd >= 0 && !rrframe->rbits)
+			bits = mapPluginFrame(rrframe2, mapBase, mapSize);
+		if(bits)
+		{
+			bool topDown = rrframe2 && (rrframe2->flags & RRTRANS_TOPDOWN);
+			bool flipped = false;
+			f.init(bits, rrframe->w, rrframe->pitch, rrframe->h,
 				trans2pf[rrframe->format], FRAME_BOTTOMUP);
+			info.tReadback = GetTime();
 
 			if(doStereo && stereoMode == RRSTEREO_QUADBUF && rrframe->rbits == NULL)
 			{
@@ -457,19 +690,50 @@ void VirtualWin::sendPlugin(GLint drawBuf, bool spoilLast, bool sync,
 				GLint readBuf = drawBuf;
 				if(doStereo || stereoMode == RRSTEREO_LEYE) readBuf = LEYE(drawBuf);
 				if(stereoMode == RRSTEREO_REYE) readBuf = REYE(drawBuf);
-				readPixels(0, 0, rrframe->w, rrframe->pitch, rrframe->h, GL_NONE, f.pf,
-					rrframe->bits, readBuf, doStereo);
-				if(doStereo && rrframe->rbits)
-					readPixels(0, 0, rrframe->w, rrframe->pitch, rrframe->h, GL_NONE,
-						f.pf, rrframe->rbits, REYE(drawBuf), doStereo);
+				if(!(haveDamage && (rrframe2->flags & RRTRANS_PRESERVED)
+					&& !fconfig.logo))
+				{
+					dx = dy = 0;  dw = rrframe->w;  dh = rrframe->h;
+				}
+				if(dw > 0 && dh > 0)
+				{
+					// In a top-down frame buffer, the region is read back, in top-down
+					// order, into the rows that it will occupy.
+					int offset = (topDown ? rrframe->h - dy - dh : dy) * rrframe->pitch
+						+ dx * f.pf->size;
+					readPixels(dx, dy, dw, rrframe->pitch, dh, GL_NONE, f.pf,
+						&bits[offset], readBuf, doStereo, topDown);
+					if(doStereo && rrframe->rbits)
+						readPixels(dx, dy, dw, rrframe->pitch, dh, GL_NONE, f.pf,
+							&rrframe->rbits[offset], REYE(drawBuf), doStereo, topDown);
+				}
+				flipped = true;
+			}
+			if(topDown)
+			{
+				if(!flipped)
+				{
+					flipRows(bits, rrframe->pitch, rrframe->w * f.pf->size, rrframe->h);
+					if(rrframe->rbits)
+						flipRows(rrframe->rbits, rrframe->pitch, rrframe->w * f.pf->size,
+							rrframe->h);
+				}
+				f.flags &= ~FRAME_BOTTOMUP;
 			}
 			if(!syncdpy) { XSync(dpy, False);  syncdpy = true; }
 			if(fconfig.logo) f.addLogo();
+			unmapPluginFrame(rrframe2, mapBase, mapSize);
+		}
+		if(rrframe2)
+		{
+			info.tSend = GetTime();
+			plugin->sendFrame2(rrframe2, info, sync);
 		}
-		plugin->sendFrame(rrframe, sync);
+		else plugin->sendFrame(rrframe, sync);
 	}
 	catch(...)
 	{
+		if(rrframe2) unmapPluginFrame(rrframe2, mapBase, mapSize);
 		delete tc;
 		throw;
 	}
@@ -497,9 +761,23 @@ void VirtualWin::sendVGL(GLint drawBuf, bool spoilLast, bool doStereo,
 		else if(glFormat == GL_BGRA) pixelFormat = PF_BGRX;
 	}
 
+	// Anaglyphic and passive stereo frames are always composited bottom-up.
+	bool topDown = fconfig.topdown
+		&& !(doStereo && (IS_ANAGLYPHIC(stereoMode) || IS_PASSIVE(stereoMode)));
+
 	if(!fconfig.spoil) vglconn->synchronize();
-	ERRIFNOT(f = vglconn->getFrame(w, h, pixelFormat, FRAME_BOTTOMUP,
-		doStereo && stereoMode == RRSTEREO_QUADBUF));
+	ERRIFNOT(f = vglconn->getFrame(w, h, pixelFormat,
+		topDown ? 0 : FRAME_BOTTOMUP, doStereo && stereoMode == RRSTEREO_QUADBUF));
+	f->hdr.winid = x11Draw;
+	f->hdr.framew = f->hdr.width;
+	f->hdr.frameh = f->hdr.height;
+	f->hdr.x = 0;
+	f->hdr.y = 0;
+	f->hdr.qual = qual;
+	f->hdr.subsamp = subsamp;
+	f->hdr.compress = (unsigned char)compress;
+	f->timestamp = triggerTime;
+
 	if(doStereo && IS_ANAGLYPHIC(stereoMode))
 	{
 		stereoFrame.deInit();
@@ -516,26 +794,97 @@ void VirtualWin::sendVGL(GLint drawBuf, bool spoilLast, bool doStereo,
 		GLint readBuf = drawBuf;
 		if(doStereo || stereoMode == RRSTEREO_LEYE) readBuf = LEYE(drawBuf);
 		if(stereoMode == RRSTEREO_REYE) readBuf = REYE(drawBuf);
-		readPixels(0, 0, f->hdr.framew, f->pitch, f->hdr.frameh, glFormat, f->pf,
-			f->bits, readBuf, doStereo);
-		if(doStereo && f->rbits)
-			readPixels(0, 0, f->hdr.framew, f->pitch, f->hdr.frameh, glFormat, f->pf,
-				f->rbits, REYE(drawBuf), doStereo);
+		int dx = 0, dy = 0, dw = f->hdr.framew, dh = f->hdr.frameh;
+
+		// If the application has only rendered to a portion of the drawable, then
+		// read back only that portion and copy the remainder from the previous
+		// frame.  The logo is drawn into the frame after readback, so partial
+		// readback is disabled when it is enabled.
+		bool haveDamage = false;
+		if(rbThread && rbThread->isCurrent())
+		{
+			if((haveDamage = rbDamageValid))
+			{
+				dx = rbDamageX;  dy = rbDamageY;  dw = rbDamageW;  dh = rbDamageH;
+			}
+		}
+		else
+			haveDamage = !fconfig.logo && lastFrameVGL && getDamage(dx, dy, dw, dh);
+		if(!(haveDamage && vglconn->copyLastFrame(f)))
+		{
+			dx = dy = 0;  dw = f->hdr.framew;  dh = f->hdr.frameh;
+		}
+
+		// A large frame is passed to the VGL Transport before it is read back,
+		// and it is then read back in stripes, so the compressors can start on
+		// the top of the frame while the rest of it is still in transit from the
+		// GPU.
+		int stripeHeight = 0;
+		if(dw == f->hdr.framew && dh == f->hdr.frameh && !f->rbits
+			&& !fconfig.logo && usePBO && !(rbThread && rbThread->isCurrent()))
+			stripeHeight = getStripeHeight(dw, dh);
+		if(stripeHeight > 0)
+		{
+			f->setStripes((dh + stripeHeight - 1) / stripeHeight, stripeHeight);
+			if(!syncdpy) { XSync(dpy, False);  syncdpy = true; }
+			vglconn->sendFrame(f);
+			try
+			{
+				if(!readPixelsStriped(0, 0, dw, f->pitch, dh, stripeHeight, glFormat,
+					f->pf, f->bits, readBuf, topDown, f))
+					readPixels(0, 0, dw, f->pitch, dh, glFormat, f->pf, f->bits,
+						readBuf, doStereo, topDown);
+			}
+			catch(...)
+			{
+				f->signalStripes();
+				throw;
+			}
+			f->signalStripes();
+			lastFrameVGL = true;
+			return;
+		}
+
+		if(dw > 0 && dh > 0)
+		{
+			int offset = (topDown ? f->hdr.frameh - dy - dh : dy) * f->pitch
+				+ dx * f->pf->size;
+			readPixels(dx, dy, dw, f->pitch, dh, glFormat, f->pf, &f->bits[offset],
+				readBuf, doStereo, topDown);
+			if(doStereo && f->rbits)
+				readPixels(dx, dy, dw, f->pitch, dh, glFormat, f->pf,
+					&f->rbits[offset], REYE(drawBuf), doStereo, topDown);
+		}
 	}
-	f->hdr.winid = x11Draw;
-	f->hdr.framew = f->hdr.width;
-	f->hdr.frameh = f->hdr.height;
-	f->hdr.x = 0;
-	f->hdr.y = 0;
-	f->hdr.qual = qual;
-	f->hdr.subsamp = subsamp;
-	f->hdr.compress = (unsigned char)compress;
 	if(!syncdpy) { XSync(dpy, False);  syncdpy = true; }
 	if(fconfig.logo) f->addLogo();
+	lastFrameVGL = !(doStereo && (IS_ANAGLYPHIC(stereoMode)
+		|| IS_PASSIVE(stereoMode)));
 	vglconn->sendFrame(f);
 }
 
 
+// Frames with at least this many pixels are read back in stripes, unless
+// VGL_READSTRIPE is set
+
+#define STRIPE_MINPIXELS  (3840 * 2160)
+
+int VirtualWin::getStripeHeight(int width, int height)
+{
+	int stripeHeight = fconfig.readstripe;
+	if(stripeHeight < 0)
+	{
+		if((long)width * height < STRIPE_MINPIXELS) return 0;
+		// Use about 8 stripes, each a whole number of tile rows high
+		int tileSize = fconfig.tilesize ? fconfig.tilesize : height;
+		stripeHeight = (height / 8 + tileSize - 1) / tileSize * tileSize;
+	}
+	if(stripeHeight < 1) return 0;
+	stripeHeight = max(stripeHeight, (height + MAXSTRIPES - 1) / MAXSTRIPES);
+	return stripeHeight < height ? stripeHeight : 0;
+}
+
+
 void VirtualWin::sendX11(GLint drawBuf, bool spoilLast, bool sync,
 	bool doStereo, int stereoMode)
 {
@@ -546,7 +895,12 @@ void VirtualWin::sendX11(GLint drawBuf, bool spoilLast, bool sync,
 	if(spoilLast && fconfig.spoil && !x11trans->isReady()) return;
 	if(!fconfig.spoil) x11trans->synchronize();
 	ERRIFNOT(f = x11trans->getFrame(dpy, x11Draw, width, height));
-	f->flags |= FRAME_BOTTOMUP;
+	// A top-down frame can be drawn without flipping it first.  Anaglyphic and
+	// passive stereo frames are always composited bottom-up.
+	bool topDown = fconfig.topdown
+		&& !(doStereo && (IS_ANAGLYPHIC(stereoMode) || IS_PASSIVE(stereoMode)));
+	if(topDown) f->flags &= ~FRAME_BOTTOMUP;
+	else f->flags |= FRAME_BOTTOMUP;
 	if(doStereo && IS_ANAGLYPHIC(stereoMode))
 	{
 		stereoFrame.deInit();
@@ -564,7 +918,8 @@ void VirtualWin::sendX11(GLint drawBuf, bool spoilLast, bool sync,
 			if(stereoMode == RRSTEREO_REYE) readBuf = REYE(drawBuf);
 			else if(stereoMode == RRSTEREO_LEYE) readBuf = LEYE(drawBuf);
 			readPixels(0, 0, min(width, f->hdr.framew), f->pitch,
-				min(height, f->hdr.frameh), GL_NONE, f->pf, f->bits, readBuf, false);
+				min(height, f->hdr.frameh), GL_NONE, f->pf, f->bits, readBuf, false,
+				topDown);
 		}
 	}
 	if(fconfig.logo) f->addLogo();
@@ -596,7 +951,9 @@ void VirtualWin::sendXV(GLint drawBuf, bool spoilLast, bool sync,
 	else if(glFormat == GL_BGR) pixelFormat = PF_BGR;
 	else if(glFormat == GL_BGRA) pixelFormat = PF_BGRX;
 
-	frame.init(hdr, pixelFormat, FRAME_BOTTOMUP, false);
+	bool topDown = fconfig.topdown
+		&& !(doStereo && (IS_ANAGLYPHIC(stereoMode) || IS_PASSIVE(stereoMode)));
+	frame.init(hdr, pixelFormat, topDown ? 0 : FRAME_BOTTOMUP, false);
 
 	if(doStereo && IS_ANAGLYPHIC(stereoMode))
 	{
@@ -616,7 +973,7 @@ void VirtualWin::sendXV(GLint drawBuf, bool spoilLast, bool sync,
 		else if(stereoMode == RRSTEREO_LEYE) readBuf = LEYE(drawBuf);
 		readPixels(0, 0, min(width, frame.hdr.framew), frame.pitch,
 			min(height, frame.hdr.frameh), glFormat, frame.pf, frame.bits, readBuf,
-			false);
+			false, topDown);
 	}
 
 	if(fconfig.logo) frame.addLogo();
@@ -671,12 +1028,25 @@ void VirtualWin::makePassive(Frame *f, int drawBuf, GLenum glFormat,
 
 
 void VirtualWin::readPixels(GLint x, GLint y, GLint width, GLint pitch,
-	GLint height, GLenum glFormat, PF *pf, GLubyte *bits, GLint buf, bool stereo)
+	GLint height, GLenum glFormat, PF *pf, GLubyte *bits, GLint buf, bool stereo,
+	bool topDown)
 {
 	VirtualDrawable::readPixels(x, y, width, pitch, height, glFormat, pf, bits,
-		buf, stereo);
+		buf, stereo, topDown);
+	applyGamma(bits, width, pitch, height, pf, stereo);
+}
+
+
+void VirtualWin::stripeReady(GLubyte *bits, GLint width, GLint pitch,
+	GLint height, PF *pf)
+{
+	applyGamma(bits, width, pitch, height, pf, false);
+}
 
-	// Gamma correction
+
+void VirtualWin::applyGamma(GLubyte *bits, GLint width, GLint pitch,
+	GLint height, PF *pf, bool stereo)
+{
 	if(fconfig.gamma != 0.0 && fconfig.gamma != 1.0 && fconfig.gamma != -1.0)
 	{
 		profGamma.startFrame();
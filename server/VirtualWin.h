@@ -22,6 +22,8 @@
 #endif
 #include "TransPlugin.h"
 #include "TempContext.h"
+#include "ResizeWatcher.h"
+#include "ReadbackThread.h"
 
 
 namespace faker
@@ -47,6 +49,7 @@ namespace faker
 			void enableWMDeleteHandler(void);
 			int getSwapInterval(void) { return swapInterval; }
 			void setSwapInterval(int swapInterval_) { swapInterval = swapInterval_; }
+			void addDamage(int x, int y, int width, int height);
 
 			bool dirty, rdirty;
 
@@ -54,7 +57,13 @@ namespace faker
 
 			int init(int w, int h, VGLFBConfig config);
 			void readPixels(GLint x, GLint y, GLint width, GLint pitch, GLint height,
-				GLenum glFormat, PF *pf, GLubyte *bits, GLint buf, bool stereo);
+				GLenum glFormat, PF *pf, GLubyte *bits, GLint buf, bool stereo,
+				bool topDown = false);
+			void stripeReady(GLubyte *bits, GLint width, GLint pitch, GLint height,
+				PF *pf);
+			void applyGamma(GLubyte *bits, GLint width, GLint pitch, GLint height,
+				PF *pf, bool stereo);
+			int getStripeHeight(int width, int height);
 			void makeAnaglyph(common::Frame *f, int drawBuf, int stereoMode);
 			void makePassive(common::Frame *f, int drawBuf, GLenum glFormat,
 				int stereoMode);
@@ -69,8 +78,13 @@ namespace faker
 				int stereoMode);
 			#endif
 			TempContext *setupPluginTempContext(GLint drawBuf);
+			bool getDamage(int &x, int &y, int &width, int &height);
+			bool useReadbackThread(GLint drawBuf, bool sync, bool doStereo,
+				int compress);
+			void readbackFromThread(void);
 
 			Display *eventdpy;
+			ResizeWatcher *resizeWatcher;
 			OGLDrawable *oldDraw;
 			int newWidth, newHeight;
 			server::X11Trans *x11trans;
@@ -88,6 +102,14 @@ namespace faker
 			bool newConfig;
 			int swapInterval;
 			bool alreadyWarnedPluginRenderMode;
+			int damageX, damageY, damageW, damageH;
+			bool lastFrameVGL;
+			bool rbPending, rbDisabled, rbDamageValid;
+			int rbStereoMode, rbCompress, rbQual, rbSubsamp;
+			int rbDamageX, rbDamageY, rbDamageW, rbDamageH;
+			double triggerTime;
+
+			friend class ReadbackThread;
 	};
 }
 
@@ -18,9 +18,10 @@
 #include "glxvisual.h"
 #include <X11/Xlib.h>
 #include "Hash.h"
+#include "faker.h"
 
 
-#define HASH  Hash<char *, XVisualInfo *, VGLFBConfig>
+#define HASH  Hash<DisplayID, XVisualInfo *, VGLFBConfig>
 
 // This maps a XVisualInfo * to a VGLFBConfig
 
@@ -45,21 +46,19 @@ namespace faker
 			void add(Display *dpy, XVisualInfo *vis, VGLFBConfig config)
 			{
 				if(!dpy || !vis || !config) THROW("Invalid argument");
-				char *dpystring = strdup(DisplayString(dpy));
-				if(!HASH::add(dpystring, vis, config))
-					free(dpystring);
+				HASH::add(getDisplayID(dpy), vis, config);
 			}
 
 			VGLFBConfig getConfig(Display *dpy, XVisualInfo *vis)
 			{
 				if(!dpy || !vis) THROW("Invalid argument");
-				return HASH::find(DisplayString(dpy), vis);
+				return HASH::find(getDisplayID(dpy), vis);
 			}
 
 			void remove(Display *dpy, XVisualInfo *vis)
 			{
 				if(!vis) THROW("Invalid argument");
-				HASH::remove(dpy ? DisplayString(dpy) : NULL, vis);
+				HASH::remove(getDisplayID(dpy), vis);
 			}
 
 		private:
@@ -69,16 +68,12 @@ namespace faker
 				HASH::kill();
 			}
 
-			bool compare(char *key1, XVisualInfo *key2, HashEntry *entry)
+			bool compare(DisplayID key1, XVisualInfo *key2, HashEntry *entry)
 			{
-				return key2 == entry->key2
-					&& (!key1 || !strcasecmp(key1, entry->key1));
+				return key2 == entry->key2 && (!key1 || key1 == entry->key1);
 			}
 
-			void detach(HashEntry *entry)
-			{
-				if(entry) free(entry->key1);
-			}
+			void detach(HashEntry *entry) {}
 
 			static VisualHash *instance;
 			static util::CriticalSection instanceMutex;
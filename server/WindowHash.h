@@ -17,9 +17,10 @@
 
 #include "VirtualWin.h"
 #include "Hash.h"
+#include "faker.h"
 
 
-#define HASH  Hash<char *, Window, VirtualWin *>
+#define HASH  Hash<DisplayID, Window, VirtualWin *>
 
 // This maps a window ID to an off-screen drawable instance
 
@@ -44,9 +45,7 @@ namespace faker
 			void add(Display *dpy, Window win)
 			{
 				if(!dpy || !win) return;
-				char *dpystring = strdup(DisplayString(dpy));
-				if(!HASH::add(dpystring, win, NULL))
-					free(dpystring);
+				HASH::add(getDisplayID(dpy), win, NULL);
 			}
 
 			// dpy == NULL: search for VirtualWin instance by off-screen drawable ID
@@ -54,7 +53,7 @@ namespace faker
 			VirtualWin *find(Display *dpy, GLXDrawable glxd)
 			{
 				if(!glxd) return NULL;
-				return HASH::find(dpy ? DisplayString(dpy) : NULL, glxd);
+				return HASH::find(getDisplayID(dpy), glxd);
 			}
 
 			VirtualWin *initVW(Display *dpy, Window win, VGLFBConfig config)
@@ -62,13 +61,14 @@ namespace faker
 				if(!dpy || !win || !config) THROW("Invalid argument");
 				HashEntry *ptr = NULL;
 				util::CriticalSection::SafeLock l(mutex);
-				if((ptr = HASH::findEntry(DisplayString(dpy), win)) != NULL)
+				if((ptr = HASH::findEntry(getDisplayID(dpy), win)) != NULL)
 				{
 					if(!ptr->value)
 					{
 						ptr->value = new VirtualWin(dpy, win);
 						VirtualWin *vw = ptr->value;
 						vw->initFromWindow(config);
+						bumpHashGeneration();
 					}
 					else
 					{
@@ -83,7 +83,7 @@ namespace faker
 			void remove(Display *dpy, GLXDrawable glxd)
 			{
 				if(!dpy || !glxd) return;
-				HASH::remove(DisplayString(dpy), glxd);
+				HASH::remove(getDisplayID(dpy), glxd);
 			}
 
 			void remove(Display *dpy)
@@ -111,29 +111,17 @@ namespace faker
 
 			void detach(HashEntry *entry)
 			{
-				if(entry)
-				{
-					free(entry->key1);
-					delete entry->value;
-				}
+				if(entry) delete entry->value;
 			}
 
-			bool compare(char *key1, Window key2, HashEntry *entry)
+			bool compare(DisplayID key1, Window key2, HashEntry *entry)
 			{
 				VirtualWin *vw = entry->value;
-				return (
-					// Match 2D X Server display string and Window ID stored in
-					// VirtualDrawable instance
-					(vw && key1 && !strcasecmp(DisplayString(vw->getX11Display()), key1)
-						&& key2 == vw->getX11Drawable())
-					||
-					// If key1 is NULL, match off-screen drawable ID instead of X Window
-					// ID
-					(vw && key1 == NULL && key2 == vw->getGLXDrawable())
-					||
-					// Direct match
-					(key1 && !strcasecmp(key1, entry->key1) && key2 == entry->key2)
-				);
+				// The VirtualWin instance for an entry is always created with the
+				// display and Window ID in the entry's keys, so Hash::findEntry() has
+				// already handled the direct match.  If key1 is 0, match off-screen
+				// drawable ID instead of X Window ID.
+				return vw && key1 == 0 && key2 == vw->getGLXDrawable();
 			}
 
 			static WindowHash *instance;
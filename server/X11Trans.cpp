@@ -13,6 +13,7 @@
 // wxWindows Library License for more details.
 
 #include "X11Trans.h"
+#include "transworkers.h"
 #include "Timer.h"
 #include "fakerconfig.h"
 #include "vglutil.h"
@@ -55,6 +56,7 @@ void X11Trans::run(void)
 	try
 	{
 		_vgl_disableFaker();
+		initTransportThread();
 
 		while(!deadYet)
 		{
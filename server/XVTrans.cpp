@@ -13,6 +13,7 @@
 // wxWindows Library License for more details.
 
 #include "XVTrans.h"
+#include "transworkers.h"
 #include "vglutil.h"
 #include "Timer.h"
 #include "fakerconfig.h"
@@ -26,7 +27,7 @@ using namespace common;
 using namespace server;
 
 
-XVTrans::XVTrans(void) : thread(NULL), deadYet(false)
+XVTrans::XVTrans(void) : yuvEncoder(NULL), thread(NULL), deadYet(false)
 {
 	for(int i = 0; i < NFRAMES; i++) frames[i] = NULL;
 	thread = new Thread(this);
@@ -49,6 +50,7 @@ void XVTrans::run(void)
 
 	try
 	{
+		initTransportThread();
 		while(!deadYet)
 		{
 			XVFrame *f;  void *ftemp = NULL;
@@ -113,7 +115,15 @@ XVFrame *XVTrans::getFrame(Display *dpy, Window win, int width, int height)
 				index = i;
 		if(index < 0) THROW("No free buffers in pool");
 		if(!frames[index])
+		{
 			frames[index] = new XVFrame(dpy, win);
+			// The frames are encoded one at a time by the rendering thread, so they
+			// can share a single stripe encoder.
+			if(!yuvEncoder)
+				yuvEncoder = new YUVEncoder(fconfig.np,
+					fconfig.np > 1 ? getWorkerPool() : NULL);
+			frames[index]->setYUVEncoder(yuvEncoder);
+		}
 		f = frames[index];  f->waitUntilComplete();
 	}
 
@@ -38,6 +38,7 @@ namespace server
 				{
 					delete frames[i];  frames[i] = NULL;
 				}
+				delete yuvEncoder;  yuvEncoder = NULL;
 			}
 
 			bool isReady(void);
@@ -51,6 +52,7 @@ namespace server
 			static const int NFRAMES = 3;
 			util::CriticalSection mutex;
 			common::XVFrame *frames[NFRAMES];
+			common::YUVEncoder *yuvEncoder;
 			util::Event ready;
 			util::GenericQ q;
 			util::Thread *thread;
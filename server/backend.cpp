@@ -970,6 +970,9 @@ void queryDrawable(Display *dpy, GLXDrawable draw, int attribute,
 			case GLX_FBCONFIG_ID:
 				*value = pb->getFBConfig() ? pb->getFBConfig()->id : 0;
 				return;
+			case GLX_BACK_BUFFER_AGE_EXT:
+				*value = pb->getBufferAge();
+				return;
 			default:
 				return;
 		}
@@ -1080,6 +1083,50 @@ void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
 }
 
 
+bool readPixelsFlipped(GLint x, GLint y, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, void *data, bool tenBit)
+{
+	// A multisampled read buffer can only be blitted to a rectangle of the same
+	// orientation.
+	GLint sampleBuffers = 0;
+	_glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+	if(sampleBuffers > 0) return false;
+
+	bool retval = false;
+	GLuint fbo = 0, rbo = 0;
+	_glGenFramebuffers(1, &fbo);
+	if(!fbo) return false;
+	{
+		BufferState bs(BS_DRAWFBO | BS_READFBO | BS_DRAWBUFS | BS_READBUF);
+		_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+
+		_glGenRenderbuffers(1, &rbo);
+		if(rbo)
+		{
+			BufferState bsRBO(BS_RBO);
+			_glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+			_glRenderbufferStorage(GL_RENDERBUFFER, tenBit ? GL_RGB10_A2 : GL_RGBA8,
+				width, height);
+			_glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+				GL_RENDERBUFFER, rbo);
+
+			GLenum status = _glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+			if(status == GL_FRAMEBUFFER_COMPLETE)
+			{
+				_glBlitFramebuffer(x, y, x + width, y + height, 0, height, width, 0,
+					GL_COLOR_BUFFER_BIT, GL_NEAREST);
+				_glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+				_glReadPixels(0, 0, width, height, format, type, data);
+				retval = true;
+			}
+			_glDeleteRenderbuffers(1, &rbo);
+		}
+	}
+	_glDeleteFramebuffers(1, &fbo);
+	return retval;
+}
+
+
 void swapBuffers(Display *dpy, GLXDrawable drawable)
 {
 	if(fconfig.egl)
@@ -98,6 +98,13 @@ namespace backend
 	void readPixels(GLint x, GLint y, GLsizei width, GLsizei height,
 		GLenum format, GLenum type, void *data);
 
+	// Read back a region of the current read buffer with its rows in top-down
+	// order, by blitting the region into a temporary renderbuffer with the Y
+	// axis reversed.  Returns false (without reading anything) if the read
+	// buffer cannot be blitted in that manner.
+	bool readPixelsFlipped(GLint x, GLint y, GLsizei width, GLsizei height,
+		GLenum format, GLenum type, void *data, bool tenBit);
+
 	void swapBuffers(Display *dpy, GLXDrawable drawable);
 }
 
@@ -1300,6 +1300,9 @@ int procAddrTest(void)
 		TEST_PROC_SYM_OPT(eglCreatePlatformWindowSurfaceEXT);
 		TEST_PROC_SYM_OPT(eglGetPlatformDisplayEXT);
 
+		// EGL_EXT_swap_buffers_with_damage
+		TEST_PROC_SYM_OPT(eglSwapBuffersWithDamageEXT);
+
 		// EGL_KHR_cl_event2
 		TEST_PROC_SYM_OPT(eglCreateSync64KHR);
 
@@ -1316,6 +1319,9 @@ int procAddrTest(void)
 		// EGL_KHR_reusable_sync
 		TEST_PROC_SYM_OPT(eglSignalSyncKHR);
 
+		// EGL_KHR_swap_buffers_with_damage
+		TEST_PROC_SYM_OPT(eglSwapBuffersWithDamageKHR);
+
 		// EGL_KHR_wait_sync
 		TEST_PROC_SYM_OPT(eglWaitSyncKHR);
 
@@ -1349,6 +1355,7 @@ int procAddrTest(void)
 		TEST_PROC_SYM(glPopAttrib)
 		TEST_PROC_SYM(glReadBuffer)
 		TEST_PROC_SYM(glReadPixels);
+		TEST_PROC_SYM(glScissor)
 		TEST_PROC_SYM(glViewport)
 
 		printf("SUCCESS!\n");
@@ -14,6 +14,7 @@
 #include "faker-sym.h"
 #include "EGLXDisplayHash.h"
 #include "EGLXWindowHash.h"
+#include "ProcTable.h"
 
 
 extern void setWMAtom(Display *dpy, Window win, faker::VirtualWin *vw);
@@ -954,14 +955,7 @@ EGLint eglGetError(void)
 
 // If an application uses eglGetProcAddress() to obtain the address of a
 // function that we're interposing, we need to return the address of the
-// interposed function.
-
-#define CHECK_FAKED(f) \
-	if(!strcmp((char *)procName, #f)) \
-	{ \
-		retval = (void (*)(void))f; \
-		if(fconfig.trace) vglout.print("[INTERPOSED]"); \
-	}
+// interposed function.  (See ProcTable.cpp.)
 
 void (*eglGetProcAddress(const char *procName))(void)
 {
@@ -975,109 +969,8 @@ void (*eglGetProcAddress(const char *procName))(void)
 
 	if(procName)
 	{
-		// EGL 1.0
-		CHECK_FAKED(eglChooseConfig);
-		CHECK_FAKED(eglCopyBuffers);
-		CHECK_FAKED(eglCreateContext);
-		CHECK_FAKED(eglCreatePbufferSurface);
-		CHECK_FAKED(eglCreatePixmapSurface);
-		CHECK_FAKED(eglCreateWindowSurface);
-		CHECK_FAKED(eglDestroyContext);
-		CHECK_FAKED(eglDestroySurface);
-		CHECK_FAKED(eglGetConfigAttrib);
-		CHECK_FAKED(eglGetConfigs);
-		CHECK_FAKED(eglGetCurrentDisplay);
-		CHECK_FAKED(eglGetCurrentSurface);
-		CHECK_FAKED(eglGetDisplay);
-		CHECK_FAKED(eglGetError);
-		CHECK_FAKED(eglGetProcAddress);
-		CHECK_FAKED(eglInitialize);
-		CHECK_FAKED(eglMakeCurrent);
-		CHECK_FAKED(eglQueryContext);
-		CHECK_FAKED(eglQueryString);
-		CHECK_FAKED(eglQuerySurface);
-		CHECK_FAKED(eglSwapBuffers);
-		CHECK_FAKED(eglTerminate);
-
-		// EGL 1.1
-		CHECK_FAKED(eglBindTexImage);
-		CHECK_FAKED(eglReleaseTexImage);
-		CHECK_FAKED(eglSurfaceAttrib);
-		CHECK_FAKED(eglSwapInterval);
-
-		// EGL 1.2
-		CHECK_FAKED(eglCreatePbufferFromClientBuffer);
-
-		// EGL 1.5
-		CHECK_FAKED(eglClientWaitSync);
-		CHECK_FAKED(eglCreateImage);
-		CHECK_FAKED(eglCreatePlatformPixmapSurface);
-		CHECK_FAKED(eglCreatePlatformWindowSurface);
-		CHECK_FAKED(eglCreateSync);
-		CHECK_FAKED(eglDestroyImage);
-		CHECK_FAKED(eglDestroySync);
-		CHECK_FAKED(eglGetPlatformDisplay);
-		CHECK_FAKED(eglGetSyncAttrib);
-		CHECK_FAKED(eglWaitSync);
-
-		// EGL_EXT_device_query
-		CHECK_FAKED(eglQueryDisplayAttribEXT);
-
-		// EGL_EXT_platform_base
-		CHECK_FAKED(eglCreatePlatformPixmapSurfaceEXT);
-		CHECK_FAKED(eglCreatePlatformWindowSurfaceEXT);
-		CHECK_FAKED(eglGetPlatformDisplayEXT);
-
-		// EGL_KHR_cl_event2
-		CHECK_FAKED(eglCreateSync64KHR);
-
-		// EGL_KHR_fence_sync
-		CHECK_FAKED(eglClientWaitSyncKHR);
-		CHECK_FAKED(eglCreateSyncKHR);
-		CHECK_FAKED(eglDestroySyncKHR);
-		CHECK_FAKED(eglGetSyncAttribKHR);
-
-		// EGL_KHR_image
-		CHECK_FAKED(eglCreateImageKHR);
-		CHECK_FAKED(eglDestroyImageKHR);
-
-		// EGL_KHR_reusable_sync
-		CHECK_FAKED(eglSignalSyncKHR);
-
-		// EGL_KHR_wait_sync
-		CHECK_FAKED(eglWaitSyncKHR);
-
-		// OpenGL
-		CHECK_FAKED(glBindFramebuffer)
-		CHECK_FAKED(glBindFramebufferEXT)
-		CHECK_FAKED(glDeleteFramebuffers)
-		CHECK_FAKED(glDeleteFramebuffersEXT)
-		CHECK_FAKED(glFinish)
-		CHECK_FAKED(glFlush)
-		CHECK_FAKED(glDrawBuffer)
-		CHECK_FAKED(glDrawBuffers)
-		CHECK_FAKED(glDrawBuffersARB)
-		CHECK_FAKED(glDrawBuffersATI)
-		CHECK_FAKED(glFramebufferDrawBufferEXT)
-		CHECK_FAKED(glFramebufferDrawBuffersEXT)
-		CHECK_FAKED(glFramebufferReadBufferEXT)
-		CHECK_FAKED(glGetBooleanv)
-		CHECK_FAKED(glGetDoublev)
-		CHECK_FAKED(glGetFloatv)
-		CHECK_FAKED(glGetFramebufferAttachmentParameteriv)
-		CHECK_FAKED(glGetFramebufferParameteriv)
-		CHECK_FAKED(glGetIntegerv)
-		CHECK_FAKED(glGetInteger64v)
-		CHECK_FAKED(glGetNamedFramebufferParameteriv)
-		CHECK_FAKED(glGetString)
-		CHECK_FAKED(glGetStringi)
-		CHECK_FAKED(glNamedFramebufferDrawBuffer)
-		CHECK_FAKED(glNamedFramebufferDrawBuffers)
-		CHECK_FAKED(glNamedFramebufferReadBuffer)
-		CHECK_FAKED(glPopAttrib)
-		CHECK_FAKED(glReadBuffer)
-		CHECK_FAKED(glReadPixels)
-		CHECK_FAKED(glViewport)
+		retval = faker::getFakedProcAddress(procName, PROC_EGL);
+		if(retval && fconfig.trace) vglout.print("[INTERPOSED]");
 	}
 	if(!retval)
 	{
@@ -1090,7 +983,7 @@ void (*eglGetProcAddress(const char *procName))(void)
 		else
 		{
 			if(fconfig.trace) vglout.print("[passed through]");
-			retval = _eglGetProcAddress(procName);
+			retval = faker::getRealProcAddress(procName, PROC_EGL);
 		}
 	}
 
@@ -1255,6 +1148,10 @@ static char eglExtensions[2048] = { 0 };
 	if(strstr(retval, #ext) && !strstr(eglExtensions, #ext)) \
 		strncat(eglExtensions, #ext " ", 2047 - strlen(eglExtensions));
 
+#define ADD_VGL_EXTENSION(ext) \
+	if(!strstr(eglExtensions, #ext)) \
+		strncat(eglExtensions, #ext " ", 2047 - strlen(eglExtensions));
+
 const char *eglQueryString(EGLDisplay display, EGLint name)
 {
 	const char *retval = NULL;
@@ -1287,7 +1184,6 @@ const char *eglQueryString(EGLDisplay display, EGLint name)
 		ADD_EXTENSION(EGL_ARM_image_format);
 		ADD_EXTENSION(EGL_ARM_implicit_external_sync);
 		ADD_EXTENSION(EGL_EXT_bind_to_front);
-		ADD_EXTENSION(EGL_EXT_buffer_age);
 		ADD_EXTENSION(EGL_EXT_client_extensions);
 		ADD_EXTENSION(EGL_EXT_create_context_robustness);
 		ADD_EXTENSION(EGL_EXT_gl_colorspace_bt2020_linear);
@@ -1341,6 +1237,11 @@ const char *eglQueryString(EGLDisplay display, EGLint name)
 		ADD_EXTENSION(EGL_TIZEN_image_native_buffer);
 		ADD_EXTENSION(EGL_TIZEN_image_native_surface);
 
+		// These extensions are implemented by VirtualGL.
+		ADD_VGL_EXTENSION(EGL_EXT_buffer_age);
+		ADD_VGL_EXTENSION(EGL_EXT_swap_buffers_with_damage);
+		ADD_VGL_EXTENSION(EGL_KHR_swap_buffers_with_damage);
+
 		if(eglExtensions[strlen(eglExtensions) - 1] == ' ')
 			eglExtensions[strlen(eglExtensions) - 1] = 0;
 
@@ -1388,6 +1289,27 @@ EGLBoolean eglQuerySurface(EGLDisplay display, EGLSurface surface,
 		*value = EGL_BUFFER_DESTROYED;
 		retval = EGL_TRUE;
 	}
+	else if(eglxvw && attribute == EGL_BUFFER_AGE_EXT && value)
+	{
+		*value = eglxvw->getBufferAge();
+		retval = EGL_TRUE;
+	}
+	else if(attribute == EGL_BUFFER_AGE_EXT && value)
+	{
+		// We advertise EGL_EXT_buffer_age whether or not the underlying EGL
+		// implementation supports it, so if it doesn't, then report that the
+		// contents of other surfaces are undefined.  Querying EGL_WIDTH
+		// validates the surface.
+		const char *exts = _eglQueryString(display, EGL_EXTENSIONS);
+		if(exts && strstr(exts, "EGL_EXT_buffer_age"))
+			retval = _eglQuerySurface(display, actualSurface, attribute, value);
+		else
+		{
+			EGLint width = 0;
+			retval = _eglQuerySurface(display, actualSurface, EGL_WIDTH, &width);
+			if(retval) *value = 0;
+		}
+	}
 	else
 		retval = _eglQuerySurface(display, actualSurface, attribute, value);
 
@@ -1482,14 +1404,58 @@ EGLBoolean eglSurfaceAttrib(EGLDisplay display, EGLSurface surface,
 }
 
 
-EGLBoolean eglSwapBuffers(EGLDisplay display, EGLSurface surface)
+// Emulate eglSwapBuffers() for a window surface that VirtualGL is managing,
+// or pass the call through to the underlying EGL implementation if the
+// surface isn't one of ours.  display is the underlying EGL display.
+
+static EGLBoolean swapBuffers(faker::EGLXDisplay *eglxdpy, EGLDisplay display,
+	EGLSurface surface, EGLSurface &actualSurface)
 {
-	EGLBoolean retval = EGL_FALSE;
-	EGLSurface actualSurface = 0;
 	faker::EGLXVirtualWin *eglxvw = NULL;
 	static util::Timer timer;  util::Timer sleepTimer;
 	static double err = 0.;  static bool first = true;
 
+	fconfig.flushdelay = 0.;
+	if((eglxvw = EGLXWINHASH.find(eglxdpy, surface)) == NULL)
+		return _eglSwapBuffers(display, surface);
+
+	actualSurface = (EGLSurface)eglxvw->getGLXDrawable();
+	// If the current draw surface is being swapped, ensure that all rendering
+	// has completed.  eglSwapBuffers() would normally do this for us, but
+	// since Pbuffer surfaces are single-buffered, we have to emulate
+	// eglSwapBuffers() rather than actually calling it.
+	if(_eglGetCurrentSurface(EGL_DRAW) == actualSurface)
+		_glFinish();
+	eglxvw->readback(GL_BACK, false, fconfig.sync);
+	eglxvw->swapBuffers();
+	int interval = eglxvw->getSwapInterval();
+	if(interval > 0)
+	{
+		double elapsed = timer.elapsed();
+		if(first) first = false;
+		else
+		{
+			double fps = fconfig.refreshrate / (double)interval;
+			if(fps > 0.0 && elapsed < 1. / fps)
+			{
+				sleepTimer.start();
+				long usec = (long)((1. / fps - elapsed - err) * 1000000.);
+				if(usec > 0) usleep(usec);
+				double sleepTime = sleepTimer.elapsed();
+				err = sleepTime - (1. / fps - elapsed - err);  if(err < 0.) err = 0.;
+			}
+		}
+		timer.start();
+	}
+	return EGL_TRUE;
+}
+
+
+EGLBoolean eglSwapBuffers(EGLDisplay display, EGLSurface surface)
+{
+	EGLBoolean retval = EGL_FALSE;
+	EGLSurface actualSurface = 0;
+
 	TRY();
 
 	if(IS_EXCLUDED_EGLX(display))
@@ -1502,39 +1468,7 @@ EGLBoolean eglSwapBuffers(EGLDisplay display, EGLSurface surface)
 	OPENTRACE(eglSwapBuffers);  PRARGX(display);  PRARGX(surface);  STARTTRACE();
 	/////////////////////////////////////////////////////////////////////////////
 
-	fconfig.flushdelay = 0.;
-	if((eglxvw = EGLXWINHASH.find(eglxdpy, surface)) != NULL)
-	{
-		actualSurface = (EGLSurface)eglxvw->getGLXDrawable();
-		// If the current draw surface is being swapped, ensure that all rendering
-		// has completed.  eglSwapBuffers() would normally do this for us, but
-		// since Pbuffer surfaces are single-buffered, we have to emulate
-		// eglSwapBuffers() rather than actually calling it.
-		if(_eglGetCurrentSurface(EGL_DRAW) == actualSurface)
-			_glFinish();
-		eglxvw->readback(GL_BACK, false, fconfig.sync);
-		int interval = eglxvw->getSwapInterval();
-		if(interval > 0)
-		{
-			double elapsed = timer.elapsed();
-			if(first) first = false;
-			else
-			{
-				double fps = fconfig.refreshrate / (double)interval;
-				if(fps > 0.0 && elapsed < 1. / fps)
-				{
-					sleepTimer.start();
-					long usec = (long)((1. / fps - elapsed - err) * 1000000.);
-					if(usec > 0) usleep(usec);
-					double sleepTime = sleepTimer.elapsed();
-					err = sleepTime - (1. / fps - elapsed - err);  if(err < 0.) err = 0.;
-				}
-			}
-			timer.start();
-		}
-		retval = EGL_TRUE;
-	}
-	else retval = _eglSwapBuffers(display, surface);
+	retval = swapBuffers(eglxdpy, display, surface, actualSurface);
 
 	/////////////////////////////////////////////////////////////////////////////
 	STOPTRACE();  if(actualSurface) PRARGX(actualSurface);
@@ -1548,6 +1482,64 @@ EGLBoolean eglSwapBuffers(EGLDisplay display, EGLSurface surface)
 }
 
 
+// The damage rectangles passed to these functions are used to limit the
+// region of the window that is read back and transported.  (See
+// VirtualWin::addDamage().)  Otherwise, they behave like eglSwapBuffers().
+// Damage rectangles are only a hint, so it is safe to discard them when
+// passing the call through to the underlying EGL implementation.
+
+#define SWAP_BUFFERS_WITH_DAMAGE(f) \
+	EGLBoolean retval = EGL_FALSE; \
+	EGLSurface actualSurface = 0; \
+	faker::EGLXVirtualWin *eglxvw; \
+	\
+	TRY(); \
+	\
+	if(IS_EXCLUDED_EGLX(display)) \
+		return _eglSwapBuffers(display, surface); \
+	\
+	GET_DISPLAY_INIT(EGL_NOT_INITIALIZED); \
+	DISABLE_FAKER(); \
+	\
+	OPENTRACE(f);  PRARGX(display);  PRARGX(surface);  PRARGI(n_rects); \
+	STARTTRACE(); \
+	\
+	if(n_rects < 0 || (n_rects > 0 && !rects)) \
+		faker::setEGLError(EGL_BAD_PARAMETER); \
+	else \
+	{ \
+		if((eglxvw = EGLXWINHASH.find(eglxdpy, surface)) != NULL) \
+		{ \
+			for(EGLint i = 0; i < n_rects; i++) \
+				eglxvw->addDamage(rects[i * 4], rects[i * 4 + 1], rects[i * 4 + 2], \
+					rects[i * 4 + 3]); \
+		} \
+		retval = swapBuffers(eglxdpy, display, surface, actualSurface); \
+	} \
+	\
+	STOPTRACE();  if(actualSurface) PRARGX(actualSurface); \
+	PRARGI(retval);  CLOSETRACE(); \
+	\
+	CATCH(); \
+	ENABLE_FAKER(); \
+	bailout: \
+	return retval;
+
+
+EGLBoolean eglSwapBuffersWithDamageEXT(EGLDisplay display, EGLSurface surface,
+	const EGLint *rects, EGLint n_rects)
+{
+	SWAP_BUFFERS_WITH_DAMAGE(eglSwapBuffersWithDamageEXT)
+}
+
+
+EGLBoolean eglSwapBuffersWithDamageKHR(EGLDisplay display, EGLSurface surface,
+	const EGLint *rects, EGLint n_rects)
+{
+	SWAP_BUFFERS_WITH_DAMAGE(eglSwapBuffersWithDamageKHR)
+}
+
+
 EGLBoolean eglSwapInterval(EGLDisplay display, EGLint interval)
 {
 	EGLBoolean retval = EGL_FALSE;
@@ -850,6 +850,46 @@ void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height,
 }
 
 
+// If VGL_DAMAGE is enabled, then the scissor rectangle is treated as a hint
+// that the application is only rendering to that region of the window.
+
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if(faker::getOGLExcludeCurrent() || !fconfig.damage)
+	{
+		_glScissor(x, y, width, height);  return;
+	}
+
+	TRY();
+
+	/////////////////////////////////////////////////////////////////////////////
+	OPENTRACE(glScissor);  PRARGI(x);  PRARGI(y);  PRARGI(width);
+	PRARGI(height);  STARTTRACE();
+	/////////////////////////////////////////////////////////////////////////////
+
+	faker::VirtualWin *vw = NULL;
+	if(faker::getEGLXContextCurrent())
+	{
+		faker::EGLXDisplay *eglxdpy = faker::getCurrentEGLXDisplay();
+		EGLSurface draw = _eglGetCurrentSurface(EGL_DRAW);
+		if(eglxdpy && draw) vw = EGLXWINHASH.findInternal(eglxdpy, draw);
+	}
+	else
+	{
+		GLXDrawable draw = backend::getCurrentDrawable();
+		if(draw) vw = WINHASH.find(NULL, draw);
+	}
+	if(vw) vw->addDamage(x, y, width, height);
+	_glScissor(x, y, width, height);
+
+	/////////////////////////////////////////////////////////////////////////////
+	STOPTRACE();  CLOSETRACE();
+	/////////////////////////////////////////////////////////////////////////////
+
+	CATCH();
+}
+
+
 // Sometimes XNextEvent() is called from a thread other than the
 // rendering thread, so we wait until glViewport() is called and
 // take that opportunity to resize the off-screen drawable.
@@ -895,6 +935,8 @@ void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 				if(drawEGLXVW) { drawEGLXVW->clear();  drawEGLXVW->cleanup(); }
 				if(readEGLXVW) readEGLXVW->cleanup();
 			}
+			if(drawEGLXVW && fconfig.damage)
+				drawEGLXVW->addDamage(x, y, width, height);
 		}
 		_glViewport(x, y, width, height);
 
@@ -933,6 +975,7 @@ void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 				if(drawVW) { drawVW->clear();  drawVW->cleanup(); }
 				if(readVW) readVW->cleanup();
 			}
+			if(drawVW && fconfig.damage) drawVW->addDamage(x, y, width, height);
 		}
 		_glViewport(x, y, width, height);
 
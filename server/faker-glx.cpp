@@ -20,6 +20,7 @@
 #include "ContextHash.h"
 #include "GLXDrawableHash.h"
 #include "PixmapHash.h"
+#include "ProcTable.h"
 #include "VisualHash.h"
 #include "WindowHash.h"
 #include "rr.h"
@@ -867,6 +868,9 @@ static const char *getGLXExtensions(void)
 			strncat(glxextensions,
 				" GLX_ARB_create_context GLX_ARB_create_context_profile",
 				1023 - strlen(glxextensions));
+		if(!strstr(glxextensions, "GLX_EXT_buffer_age"))
+			strncat(glxextensions, " GLX_EXT_buffer_age",
+				1023 - strlen(glxextensions));
 		if(!strstr(glxextensions, "GLX_EXT_framebuffer_sRGB"))
 			strncat(glxextensions, " GLX_EXT_framebuffer_sRGB",
 				1023 - strlen(glxextensions));
@@ -892,6 +896,11 @@ static const char *getGLXExtensions(void)
 		strncat(glxextensions, " GLX_ARB_fbconfig_float",
 			1023 - strlen(glxextensions));
 
+	if(strstr(realGLXExtensions, "GLX_EXT_buffer_age")
+		&& !strstr(glxextensions, "GLX_EXT_buffer_age"))
+		strncat(glxextensions, " GLX_EXT_buffer_age",
+			1023 - strlen(glxextensions));
+
 	if(strstr(realGLXExtensions, "GLX_EXT_create_context_es2_profile")
 		&& !strstr(glxextensions, "GLX_EXT_create_context_es2_profile"))
 		strncat(glxextensions, " GLX_EXT_create_context_es2_profile",
@@ -1327,28 +1336,7 @@ void glXReleaseTexImageEXT(Display *dpy, GLXDrawable drawable, int buffer)
 
 // If an application uses glXGetProcAddressARB() to obtain the address of a
 // function that we're interposing, we need to return the address of the
-// interposed function.
-
-#define CHECK_FAKED(f) \
-	if(!strcmp((char *)procName, #f)) \
-	{ \
-		retval = (void (*)(void))f; \
-		if(fconfig.trace) vglout.print("[INTERPOSED]"); \
-	}
-
-// For optional libGL symbols, check that the underlying function
-// actually exists in libGL before returning the interposed version of it.
-
-#define CHECK_OPT_FAKED(f) \
-	if(!strcmp((char *)procName, #f)) \
-	{ \
-		CHECKSYM_NONFATAL(f) \
-		if(__##f) \
-		{ \
-			retval = (void (*)(void))f; \
-			if(fconfig.trace) vglout.print("[INTERPOSED]"); \
-		} \
-	}
+// interposed function.  (See ProcTable.cpp.)
 
 void (*glXGetProcAddressARB(const GLubyte *procName))(void)
 {
@@ -1364,126 +1352,8 @@ void (*glXGetProcAddressARB(const GLubyte *procName))(void)
 
 	if(procName)
 	{
-		// GLX 1.0
-		CHECK_FAKED(glXChooseVisual)
-		CHECK_FAKED(glXCopyContext)
-		CHECK_FAKED(glXCreateContext)
-		CHECK_FAKED(glXCreateGLXPixmap)
-		CHECK_FAKED(glXDestroyContext)
-		CHECK_FAKED(glXDestroyGLXPixmap)
-		CHECK_FAKED(glXGetConfig)
-		CHECK_FAKED(glXGetCurrentContext)
-		CHECK_FAKED(glXGetCurrentDrawable)
-		CHECK_FAKED(glXIsDirect)
-		CHECK_FAKED(glXMakeCurrent)
-		CHECK_FAKED(glXQueryExtension)
-		CHECK_FAKED(glXQueryVersion)
-		CHECK_FAKED(glXSwapBuffers)
-		CHECK_FAKED(glXUseXFont)
-		CHECK_FAKED(glXWaitGL)
-
-		// GLX 1.1
-		CHECK_FAKED(glXGetClientString)
-		CHECK_FAKED(glXQueryServerString)
-		CHECK_FAKED(glXQueryExtensionsString)
-
-		// GLX 1.2
-		CHECK_FAKED(glXGetCurrentDisplay)
-
-		// GLX 1.3
-		CHECK_FAKED(glXChooseFBConfig)
-		CHECK_FAKED(glXCreateNewContext)
-		CHECK_FAKED(glXCreatePbuffer)
-		CHECK_FAKED(glXCreatePixmap)
-		CHECK_FAKED(glXCreateWindow)
-		CHECK_FAKED(glXDestroyPbuffer)
-		CHECK_FAKED(glXDestroyPixmap)
-		CHECK_FAKED(glXDestroyWindow)
-		CHECK_FAKED(glXGetCurrentReadDrawable)
-		CHECK_FAKED(glXGetFBConfigAttrib)
-		CHECK_FAKED(glXGetFBConfigs)
-		CHECK_FAKED(glXGetSelectedEvent)
-		CHECK_FAKED(glXGetVisualFromFBConfig)
-		CHECK_FAKED(glXMakeContextCurrent)
-		CHECK_FAKED(glXQueryContext)
-		CHECK_FAKED(glXQueryDrawable)
-		CHECK_FAKED(glXSelectEvent)
-
-		// GLX 1.4
-		CHECK_FAKED(glXGetProcAddress)
-
-		// GLX_ARB_create_context
-		CHECK_OPT_FAKED(glXCreateContextAttribsARB)
-
-		// GLX_ARB_get_proc_address
-		CHECK_FAKED(glXGetProcAddressARB)
-
-		// GLX_EXT_import_context
-		CHECK_OPT_FAKED(glXFreeContextEXT)
-		CHECK_FAKED(glXGetCurrentDisplayEXT)
-		CHECK_OPT_FAKED(glXImportContextEXT)
-		CHECK_OPT_FAKED(glXQueryContextInfoEXT)
-
-		// GLX_EXT_swap_control
-		CHECK_FAKED(glXSwapIntervalEXT)
-
-		// GLX_EXT_texture_from_pixmap
-		CHECK_OPT_FAKED(glXBindTexImageEXT)
-		CHECK_OPT_FAKED(glXReleaseTexImageEXT)
-
-		// GLX_SGI_make_current_read
-		CHECK_FAKED(glXGetCurrentReadDrawableSGI)
-		CHECK_FAKED(glXMakeCurrentReadSGI)
-
-		// GLX_SGI_swap_control
-		CHECK_FAKED(glXSwapIntervalSGI)
-
-		// GLX_SGIX_fbconfig
-		CHECK_FAKED(glXChooseFBConfigSGIX)
-		CHECK_FAKED(glXCreateContextWithConfigSGIX)
-		CHECK_FAKED(glXCreateGLXPixmapWithConfigSGIX)
-		CHECK_FAKED(glXGetFBConfigAttribSGIX)
-		CHECK_FAKED(glXGetFBConfigFromVisualSGIX)
-		CHECK_FAKED(glXGetVisualFromFBConfigSGIX)
-
-		// GLX_SGIX_pbuffer
-		CHECK_FAKED(glXCreateGLXPbufferSGIX)
-		CHECK_FAKED(glXDestroyGLXPbufferSGIX)
-		CHECK_FAKED(glXGetSelectedEventSGIX)
-		CHECK_FAKED(glXQueryGLXPbufferSGIX)
-		CHECK_FAKED(glXSelectEventSGIX)
-
-		// OpenGL
-		CHECK_FAKED(glBindFramebuffer)
-		CHECK_FAKED(glBindFramebufferEXT)
-		CHECK_FAKED(glDeleteFramebuffers)
-		CHECK_FAKED(glDeleteFramebuffersEXT)
-		CHECK_FAKED(glFinish)
-		CHECK_FAKED(glFlush)
-		CHECK_FAKED(glDrawBuffer)
-		CHECK_FAKED(glDrawBuffers)
-		CHECK_FAKED(glDrawBuffersARB)
-		CHECK_FAKED(glDrawBuffersATI)
-		CHECK_FAKED(glFramebufferDrawBufferEXT)
-		CHECK_FAKED(glFramebufferDrawBuffersEXT)
-		CHECK_FAKED(glFramebufferReadBufferEXT)
-		CHECK_FAKED(glGetBooleanv)
-		CHECK_FAKED(glGetDoublev)
-		CHECK_FAKED(glGetFloatv)
-		CHECK_FAKED(glGetFramebufferAttachmentParameteriv)
-		CHECK_FAKED(glGetFramebufferParameteriv)
-		CHECK_FAKED(glGetIntegerv)
-		CHECK_FAKED(glGetInteger64v)
-		CHECK_FAKED(glGetNamedFramebufferParameteriv)
-		CHECK_FAKED(glGetString)
-		CHECK_FAKED(glGetStringi)
-		CHECK_FAKED(glNamedFramebufferDrawBuffer)
-		CHECK_FAKED(glNamedFramebufferDrawBuffers)
-		CHECK_FAKED(glNamedFramebufferReadBuffer)
-		CHECK_FAKED(glPopAttrib)
-		CHECK_FAKED(glReadBuffer)
-		CHECK_FAKED(glReadPixels)
-		CHECK_FAKED(glViewport)
+		retval = faker::getFakedProcAddress((const char *)procName, PROC_GLX);
+		if(retval && fconfig.trace) vglout.print("[INTERPOSED]");
 	}
 	if(!retval)
 	{
@@ -1496,7 +1366,7 @@ void (*glXGetProcAddressARB(const GLubyte *procName))(void)
 		else
 		{
 			if(fconfig.trace) vglout.print("[passed through]");
-			retval = _glXGetProcAddress(procName);
+			retval = faker::getRealProcAddress((const char *)procName, PROC_GLX);
 		}
 	}
 
@@ -1636,21 +1506,45 @@ Bool glXIsDirect(Display *dpy, GLXContext ctx)
 }
 
 
+// Record which off-screen drawables are bound to which contexts, so that an
+// off-screen drawable that is still bound to a context is never recycled
+// through the drawable pool (see VirtualDrawable::releaseDrawable().)
+
+static void setCurrentDrawables(GLXContext oldctx, GLXContext ctx,
+	GLXDrawable draw, GLXDrawable read)
+{
+	if(oldctx && oldctx != ctx) CTXHASH.setCurrentDrawables(oldctx, 0, 0);
+	if(ctx) CTXHASH.setCurrentDrawables(ctx, draw, read);
+}
+
+
 // See notes
 
 Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 {
 	Bool retval = False;  const char *renderer = "Unknown";
 	faker::VirtualWin *vw;  VGLFBConfig config = 0;
+	faker::MakeCurrentCache *mcc;  bool cached = false;
+	GLXDrawable x11draw = drawable;
 
 	if(faker::deadYet || faker::getFakerLevel() > 0)
 		return _glXMakeCurrent(dpy, drawable, ctx);
 
 	TRY();
 
+	// If this thread is re-binding the same context and window that it bound
+	// the last time, and none of the hashes has changed since, then reuse the
+	// previous resolution rather than acquiring the hash mutexes again.
+	unsigned int generation = faker::hashGeneration;
+	if((mcc = faker::getMakeCurrentCache()) != NULL && dpy && drawable && ctx
+		&& mcc->generation == generation && mcc->dpy == dpy
+		&& mcc->draw == drawable && mcc->read == drawable && mcc->ctx == ctx)
+		cached = true;
+
 	// Find the FB config that was previously hashed to this context when it was
 	// created.
-	if(ctx) config = CTXHASH.findConfig(ctx);
+	if(cached) config = mcc->config;
+	else if(ctx) config = CTXHASH.findConfig(ctx);
 	if(faker::isDisplayExcluded(dpy))
 	{
 		faker::setGLXExcludeCurrent(true);
@@ -1670,7 +1564,9 @@ Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 	// glXMakeCurrent() implies a glFinish() on the previous context, which is
 	// why we read back the front buffer here if it is dirty.
 	GLXDrawable curdraw = backend::getCurrentDrawable();
-	if(backend::getCurrentContext() && curdraw
+	GLXContext curctx = backend::getCurrentContext();
+	if(curctx && curdraw
+		&& !(cached && mcc->drawVW->getGLXDrawable() == curdraw)
 		&& (vw = WINHASH.find(NULL, curdraw)) != NULL)
 	{
 		faker::VirtualWin *newvw;
@@ -1684,7 +1580,7 @@ Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 
 	// If the drawable isn't a window, we pass it through unmodified, else we
 	// map it to an off-screen drawable.
-	int direct = CTXHASH.isDirect(ctx);
+	int direct = cached ? mcc->direct : CTXHASH.isDirect(ctx);
 	if(dpy && drawable && ctx)
 	{
 		if(!config)
@@ -1694,8 +1590,12 @@ Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 		}
 		try
 		{
-			vw = WINHASH.initVW(dpy, drawable, config);
-			if(vw)
+			if(cached)
+			{
+				vw = mcc->drawVW;
+				drawable = vw->updateGLXDrawable();
+			}
+			else if((vw = WINHASH.initVW(dpy, drawable, config)) != NULL)
 			{
 				setWMAtom(dpy, drawable, vw);
 				drawable = vw->updateGLXDrawable();
@@ -1735,19 +1635,34 @@ Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 	}
 
 	retval = backend::makeCurrent(dpy, drawable, drawable, ctx);
+	if(retval) setCurrentDrawables(curctx, ctx, drawable, drawable);
 	if(fconfig.trace && retval)
 		renderer = (const char *)_glGetString(GL_RENDERER);
 	// The pixels in a new off-screen drawable are undefined, so we have to clear
 	// it.
-	if((vw = WINHASH.find(NULL, drawable)) != NULL)
+	if(cached)
 	{
+		vw = mcc->drawVW;
 		vw->clear();  vw->cleanup();
 	}
-	faker::VirtualPixmap *vpm;
-	if((vpm = PMHASH.find(dpy, drawable)) != NULL)
+	else
 	{
-		vpm->clear();
-		vpm->setDirect(direct);
+		if((vw = WINHASH.find(NULL, drawable)) != NULL)
+		{
+			vw->clear();  vw->cleanup();
+		}
+		faker::VirtualPixmap *vpm;
+		if((vpm = PMHASH.find(dpy, drawable)) != NULL)
+		{
+			vpm->clear();
+			vpm->setDirect(direct);
+		}
+		if(mcc && retval && vw && dpy && x11draw && ctx && config)
+		{
+			mcc->dpy = dpy;  mcc->draw = mcc->read = x11draw;  mcc->ctx = ctx;
+			mcc->drawVW = mcc->readVW = vw;  mcc->config = config;
+			mcc->direct = direct;  mcc->generation = generation;
+		}
 	}
 
 	done:
@@ -1767,13 +1682,23 @@ Bool glXMakeContextCurrent(Display *dpy, GLXDrawable draw, GLXDrawable read,
 {
 	Bool retval = False;  const char *renderer = "Unknown";
 	faker::VirtualWin *vw;  VGLFBConfig config = 0;
+	faker::MakeCurrentCache *mcc;  bool cached = false;
+	GLXDrawable x11draw = draw, x11read = read;
 
 	if(faker::deadYet || faker::getFakerLevel() > 0)
 		return _glXMakeContextCurrent(dpy, draw, read, ctx);
 
 	TRY();
 
-	if(ctx) config = CTXHASH.findConfig(ctx);
+	// See glXMakeCurrent()
+	unsigned int generation = faker::hashGeneration;
+	if((mcc = faker::getMakeCurrentCache()) != NULL && dpy && draw && ctx
+		&& mcc->generation == generation && mcc->dpy == dpy
+		&& mcc->draw == draw && mcc->read == read && mcc->ctx == ctx)
+		cached = true;
+
+	if(cached) config = mcc->config;
+	else if(ctx) config = CTXHASH.findConfig(ctx);
 	if(faker::isDisplayExcluded(dpy))
 	{
 		faker::setGLXExcludeCurrent(true);
@@ -1793,7 +1718,9 @@ Bool glXMakeContextCurrent(Display *dpy, GLXDrawable draw, GLXDrawable read,
 	// glXMakeContextCurrent() implies a glFinish() on the previous context,
 	// which is why we read back the front buffer here if it is dirty.
 	GLXDrawable curdraw = backend::getCurrentDrawable();
-	if(backend::getCurrentContext() && curdraw
+	GLXContext curctx = backend::getCurrentContext();
+	if(curctx && curdraw
+		&& !(cached && mcc->drawVW->getGLXDrawable() == curdraw)
 		&& (vw = WINHASH.find(NULL, curdraw)) != NULL)
 	{
 		faker::VirtualWin *newvw;
@@ -1808,8 +1735,29 @@ Bool glXMakeContextCurrent(Display *dpy, GLXDrawable draw, GLXDrawable read,
 	// If the drawable isn't a window, we pass it through unmodified, else we
 	// map it to an off-screen drawable.
 	faker::VirtualWin *drawVW, *readVW;
-	int direct = CTXHASH.isDirect(ctx);
-	if(dpy && (draw || read) && ctx)
+	int direct = cached ? mcc->direct : CTXHASH.isDirect(ctx);
+	if(cached)
+	{
+		try
+		{
+			drawVW = mcc->drawVW;  readVW = mcc->readVW;
+			draw = drawVW->updateGLXDrawable();
+			if(readVW && readVW != drawVW) read = readVW->updateGLXDrawable();
+			else if(read) read = draw;
+		}
+		catch(std::exception &e)
+		{
+			if(!strcmp(GET_METHOD(e), "VirtualWin")
+				&& !strcmp(e.what(), "Invalid window"))
+			{
+				faker::sendGLXError(dpy, X_GLXMakeContextCurrent, GLXBadDrawable,
+					false);
+				goto done;
+			}
+			throw;
+		}
+	}
+	else if(dpy && (draw || read) && ctx)
 	{
 		if(!config)
 		{
@@ -1889,19 +1837,38 @@ Bool glXMakeContextCurrent(Display *dpy, GLXDrawable draw, GLXDrawable read,
 	}
 
 	retval = backend::makeCurrent(dpy, draw, read, ctx);
+	if(retval) setCurrentDrawables(curctx, ctx, draw, read);
 	if(fconfig.trace && retval)
 		renderer = (const char *)_glGetString(GL_RENDERER);
-	if((drawVW = WINHASH.find(NULL, draw)) != NULL)
+	if(cached)
 	{
 		drawVW->clear();  drawVW->cleanup();
+		if(readVW) readVW->cleanup();
 	}
-	if((readVW = WINHASH.find(NULL, read)) != NULL)
-		readVW->cleanup();
-	faker::VirtualPixmap *vpm;
-	if((vpm = PMHASH.find(dpy, draw)) != NULL)
+	else
 	{
-		vpm->clear();
-		vpm->setDirect(direct);
+		if((drawVW = WINHASH.find(NULL, draw)) != NULL)
+		{
+			drawVW->clear();  drawVW->cleanup();
+		}
+		if((readVW = WINHASH.find(NULL, read)) != NULL)
+			readVW->cleanup();
+		faker::VirtualPixmap *vpm;
+		if((vpm = PMHASH.find(dpy, draw)) != NULL)
+		{
+			vpm->clear();
+			vpm->setDirect(direct);
+		}
+		// Only cache the resolution if every drawable is a window, since the
+		// fast path above assumes that.
+		if(mcc && retval && drawVW && (!x11read || readVW) && dpy && x11draw
+			&& ctx && config)
+		{
+			mcc->dpy = dpy;  mcc->draw = x11draw;  mcc->read = x11read;
+			mcc->ctx = ctx;  mcc->drawVW = drawVW;  mcc->readVW = readVW;
+			mcc->config = config;  mcc->direct = direct;
+			mcc->generation = generation;
+		}
 	}
 
 	done:
@@ -2039,6 +2006,18 @@ void glXQueryDrawable(Display *dpy, GLXDrawable draw, int attribute,
 		*value = VGL_MAX_SWAP_INTERVAL;
 		goto done;
 	}
+	// GLX_EXT_buffer_age attributes
+	else if(attribute == GLX_BACK_BUFFER_AGE_EXT)
+	{
+		faker::VirtualWin *vw;
+		if((vw = WINHASH.find(dpy, draw)) != NULL)
+			*value = vw->getBufferAge();
+		else if(PMHASH.find(dpy, draw))
+			*value = 0;
+		else
+			backend::queryDrawable(dpy, draw, attribute, value);
+		goto done;
+	}
 	else
 	{
 		faker::VirtualWin *vw;  faker::VirtualPixmap *vpm;
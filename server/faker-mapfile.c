@@ -142,6 +142,9 @@
 		eglCreatePlatformWindowSurfaceEXT;
 		eglGetPlatformDisplayEXT;
 
+		/* EGL_EXT_swap_buffers_with_damage */
+		eglSwapBuffersWithDamageEXT;
+
 		/* EGL_KHR_cl_event2 */
 		eglCreateSync64KHR;
 
@@ -158,6 +161,9 @@
 		/* EGL_KHR_reusable_sync */
 		eglSignalSyncKHR;
 
+		/* EGL_KHR_swap_buffers_with_damage */
+		eglSwapBuffersWithDamageKHR;
+
 		/* EGL_KHR_wait_sync */
 		eglWaitSyncKHR;
 
@@ -191,6 +197,7 @@
 		glPopAttrib;
 		glReadBuffer;
 		glReadPixels;
+		glScissor;
 		glViewport;
 
 		/* OpenCL */
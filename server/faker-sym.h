@@ -809,6 +809,9 @@ VFUNCDEF1(glReadBuffer, GLenum, mode, glReadBuffer)
 VFUNCDEF7(glReadPixels, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
 	GLenum, format, GLenum, type, GLvoid *, pixels, glReadPixels)
 
+VFUNCDEF4(glScissor, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
+	glScissor)
+
 VFUNCDEF4(glViewport, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
 	glViewport)
 
@@ -1012,14 +1015,21 @@ VFUNCDEF1(glClear, GLbitfield, mask, NULL)
 VFUNCDEF4(glClearColor, GLclampf, red, GLclampf, green, GLclampf, blue,
 	GLclampf, alpha, NULL)
 
+FUNCDEF3(GLenum, glClientWaitSync, GLsync, sync, GLbitfield, flags,
+	GLuint64, timeout, NULL)
+
 VFUNCDEF5(glCopyPixels, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
 	GLenum, type, NULL)
 
 VFUNCDEF2(glDeleteRenderbuffers, GLsizei, n, const GLuint *, renderbuffers,
 	NULL)
 
+VFUNCDEF1(glDeleteSync, GLsync, sync, NULL)
+
 VFUNCDEF0(glEndList, NULL)
 
+FUNCDEF2(GLsync, glFenceSync, GLenum, condition, GLbitfield, flags, NULL)
+
 VFUNCDEF4(glFramebufferRenderbuffer, GLenum, target, GLenum, attachment,
 	GLenum, renderbuffertarget, GLuint, renderbuffer, NULL)
 
@@ -71,6 +71,7 @@ int XCloseDisplay(Display *dpy)
 	#endif
 
 	WINHASH.remove(dpy);
+	faker::VirtualDrawable::purgeDrawablePool(dpy);
 	retval = _XCloseDisplay(dpy);
 
 	/////////////////////////////////////////////////////////////////////////////
@@ -509,12 +510,16 @@ static void setupXDisplay(Display *dpy)
 	XExtData *extData;
 	bool excludeDisplay = faker::isDisplayStringExcluded(DisplayString(dpy));
 
-	// Extension code 1 stores the excluded status for a Display.
+	// Extension code 1 stores the excluded status and ID for a Display.
 	if(!(codes = XAddExtension(dpy))
 		|| !(extData = (XExtData *)calloc(1, sizeof(XExtData)))
-		|| !(extData->private_data = (XPointer)malloc(sizeof(bool))))
+		|| !(extData->private_data =
+			(XPointer)malloc(sizeof(faker::DisplayAttribs))))
 		THROW("Memory allocation error");
-	*(bool *)extData->private_data = excludeDisplay;
+	faker::DisplayAttribs *attribs =
+		(faker::DisplayAttribs *)extData->private_data;
+	attribs->excluded = excludeDisplay;
+	attribs->id = faker::internDisplayString(DisplayString(dpy));
 	extData->number = codes->extension;
 	XAddToExtensionList(XEHeadOfExtensionList(obj), extData);
 
@@ -51,6 +51,43 @@ VGL_THREAD_LOCAL(EGLXContextCurrent, bool, false)
 VGL_THREAD_LOCAL(EGLError, long, EGL_SUCCESS)
 VGL_THREAD_LOCAL(CurrentEGLXDisplay, EGLXDisplay *, NULL)
 
+volatile unsigned int hashGeneration = 1;
+
+
+// Unlike the other thread-local variables, the MakeCurrent cache is a
+// structure, so it is allocated the first time a thread needs it and freed
+// when the thread exits.
+
+static pthread_key_t getMakeCurrentCacheKey(void)
+{
+	static pthread_key_t key;
+	static bool init = false;
+	if(!init)
+	{
+		if(pthread_key_create(&key, free))
+		{
+			vglout.println("[VGL] ERROR: pthread_key_create() for MakeCurrentCache failed.\n");
+			safeExit(1);
+		}
+		init = true;
+	}
+	return key;
+}
+
+MakeCurrentCache *getMakeCurrentCache(void)
+{
+	pthread_key_t key = getMakeCurrentCacheKey();
+	MakeCurrentCache *mcc = (MakeCurrentCache *)pthread_getspecific(key);
+	if(!mcc)
+	{
+		if((mcc = (MakeCurrentCache *)calloc(1, sizeof(MakeCurrentCache)))
+			== NULL)
+			return NULL;
+		pthread_setspecific(key, mcc);
+	}
+	return mcc;
+}
+
 
 static void cleanup(void)
 {
@@ -84,6 +121,7 @@ void safeExit(int retcode)
 	globalMutex.unlock(false);
 	if(!shutdown)
 	{
+		vglout.flush();
 		if(!strcasecmp(fconfig.exitfunction, "_exit"))
 			_exit(retcode);
 		else if(!strcasecmp(fconfig.exitfunction, "abort"))
@@ -169,6 +207,19 @@ void init(void)
 
 	fconfig_reloadenv();
 	if(strlen(fconfig.log) > 0) vglout.logTo(fconfig.log);
+	if(fconfig.logrepeat > 0) vglout.setRepeatLimit(fconfig.logrepeat);
+	if(fconfig.logasync)
+	{
+		try
+		{
+			vglout.setAsync(true);
+		}
+		catch(std::exception &e)
+		{
+			vglout.println("[VGL] WARNING: Could not enable asynchronous logging:\n[VGL]    %s",
+				e.what());
+		}
+	}
 
 	if(fconfig.verbose)
 		vglout.println("[VGL] %s v%s %d-bit (Build %s)", __APPNAME, __VERSION,
@@ -304,6 +355,46 @@ bool isDisplayStringExcluded(char *name)
 }
 
 
+// The number of distinct display strings that an application uses is small, so
+// a linked list suffices.
+
+typedef struct DisplayStringEntryStruct
+{
+	char *name;
+	DisplayID id;
+	struct DisplayStringEntryStruct *next;
+} DisplayStringEntry;
+
+static DisplayStringEntry *displayStrings = NULL;
+static util::CriticalSection displayStringMutex;
+
+
+DisplayID internDisplayString(const char *name)
+{
+	DisplayStringEntry *entry;
+	DisplayID id = 1;
+
+	if(!name) THROW("Invalid argument");
+	util::CriticalSection::SafeLock l(displayStringMutex);
+
+	for(entry = displayStrings; entry; entry = entry->next)
+	{
+		if(!strcasecmp(name, entry->name)) return entry->id;
+		if(entry->id >= id) id = entry->id + 1;
+	}
+	if(!(entry = (DisplayStringEntry *)malloc(sizeof(DisplayStringEntry)))
+		|| !(entry->name = strdup(name)))
+	{
+		free(entry);
+		THROW("Memory allocation error");
+	}
+	entry->id = id;
+	entry->next = displayStrings;
+	displayStrings = entry;
+	return id;
+}
+
+
 extern "C" {
 
 int deleteCS(XExtData *extData)
@@ -42,6 +42,22 @@ namespace faker
 		bool isDefault, isInit;
 	} EGLXDisplay;
 
+	class VirtualWin;
+
+	// Per-thread cache of the most recent glXMakeCurrent() or
+	// glXMakeContextCurrent() resolution.  The cache is valid only as long as
+	// generation matches hashGeneration (see Hash.h.)
+	typedef struct
+	{
+		Display *dpy;
+		GLXDrawable draw, read;
+		GLXContext ctx;
+		VirtualWin *drawVW, *readVW;
+		VGLFBConfig config;
+		int direct;
+		unsigned int generation;
+	} MakeCurrentCache;
+
 	extern Display *dpy3D;
 	extern bool deadYet;
 	extern char *glExtensions;
@@ -77,12 +93,28 @@ namespace faker
 	extern void setEGLError(long error);
 	extern EGLXDisplay *getCurrentEGLXDisplay(void);
 	extern void setCurrentEGLXDisplay(EGLXDisplay *display);
+	extern MakeCurrentCache *getMakeCurrentCache(void);
 
 	void *loadSymbol(const char *name, bool optional = false);
 	void unloadSymbols(void);
 
 	extern bool isDisplayStringExcluded(char *name);
 
+	// The faker's hashes identify a 2D X server display by an integer ID rather
+	// than by its display string.  All Display handles with the same display
+	// string (compared case-insensitively) share the same nonzero ID, which is
+	// interned once when the Display handle is opened and stored along with the
+	// excluded status for the Display.
+	typedef unsigned long DisplayID;
+
+	typedef struct
+	{
+		bool excluded;
+		DisplayID id;
+	} DisplayAttribs;
+
+	extern DisplayID internDisplayString(const char *name);
+
 	INLINE bool isDisplayExcluded(Display *dpy)
 	{
 		XEDataObject obj = { dpy };
@@ -98,7 +130,26 @@ namespace faker
 		ERRIFNOT(extData);
 		ERRIFNOT(extData->private_data);
 
-		return *(bool *)extData->private_data;
+		return ((DisplayAttribs *)extData->private_data)->excluded;
+	}
+
+	INLINE DisplayID getDisplayID(Display *dpy)
+	{
+		XEDataObject obj = { dpy };
+		XExtData *extData;
+
+		if(!dpy) return 0;
+		// The 3D X server may have its own extensions that conflict with ours.
+		if(fconfig.egl || dpy != dpy3D)
+		{
+			int minExtensionNumber =
+				XFindOnExtensionList(XEHeadOfExtensionList(obj), 0) ? 0 : 1;
+			extData = XFindOnExtensionList(XEHeadOfExtensionList(obj),
+				minExtensionNumber);
+			if(extData && extData->private_data)
+				return ((DisplayAttribs *)extData->private_data)->id;
+		}
+		return internDisplayString(DisplayString(dpy));
 	}
 
 	extern "C" int deleteCS(XExtData *extData);
@@ -161,6 +161,8 @@ static void fconfig_init(void)
 	CriticalSection::SafeLock l(fcmutex);
 	memset(&fconfig, 0, sizeof(FakerConfig));
 	memset(&fconfig_env, 0, sizeof(FakerConfig));
+	fconfig.capturemode = RRCAPTURE_STREAM;
+	fconfig.compacthdr = 1;
 	fconfig.compress = -1;
 	strncpy(fconfig.config, VGLCONFIG_PATH, MAXSTR);
 	#ifdef sun
@@ -169,6 +171,7 @@ static void fconfig_init(void)
 	#ifdef FAKEXCB
 	fconfig.fakeXCB = 1;
 	#endif
+	fconfig.drawpool = 0;
 	fconfig.forcealpha = 0;
 	fconfig_setgamma(fconfig, 1.0);
 	fconfig.glflushtrigger = 1;
@@ -177,16 +180,20 @@ static void fconfig_init(void)
 	fconfig.guimod = ShiftMask | ControlMask;
 	fconfig.interframe = 1;
 	strncpy(fconfig.localdpystring, ":0", MAXSTR);
+	fconfig.lossless = 1;
 	fconfig.np = 1;
 	fconfig.port = -1;
 	fconfig.probeglx = -1;
 	fconfig.qual = DEFQUAL;
 	fconfig.readback = RRREAD_PBO;
+	fconfig.readstripe = -1;
 	fconfig.refreshrate = 60.0;
 	fconfig.samples = -1;
+	fconfig.shmtrans = 1;
 	fconfig.spoil = 1;
 	fconfig.spoillast = 1;
 	fconfig.stereo = RRSTEREO_QUADBUF;
+	fconfig.streams = 1;
 	fconfig.subsamp = -1;
 	fconfig.tilesize = RR_DEFAULTTILESIZE;
 	fconfig.transpixel = -1;
@@ -277,11 +284,33 @@ void fconfig_reloadenv(void)
 
 	CriticalSection::SafeLock l(fcmutex);
 
+	FETCHENV_DBL("VGL_ADAPTIVE", adaptive, 0.0, 1000.0);
+	FETCHENV_DBL("VGL_ADAPTIVEMBPS", adaptivembps, 0.0, 1000000.0);
+	FETCHENV_STR("VGL_AFFINITY", affinity);
 	FETCHENV_BOOL("VGL_ALLOWINDIRECT", allowindirect);
 	FETCHENV_BOOL("VGL_AMDGPUHACK", amdgpuHack);
 	FETCHENV_BOOL("VGL_AUTOTEST", autotest);
+	FETCHENV_STR("VGL_CAPTURE", capture);
+	if((env = getenv("VGL_CAPTUREMODE")) != NULL && strlen(env) > 0)
+	{
+		int capturemode = -1;
+		if(!strnicmp(env, "S", 1)) capturemode = RRCAPTURE_STREAM;
+		else if(!strnicmp(env, "F", 1)) capturemode = RRCAPTURE_FRAMES;
+		else if(!strnicmp(env, "B", 1)) capturemode = RRCAPTURE_BOTH;
+		else
+		{
+			char *t = NULL;  int itemp = strtol(env, &t, 10);
+			if(t && t != env && itemp >= RRCAPTURE_STREAM
+				&& itemp <= RRCAPTURE_BOTH)
+				capturemode = itemp;
+		}
+		if(capturemode >= 0
+			&& (!fconfig_envset || fconfig_env.capturemode != capturemode))
+			fconfig.capturemode = fconfig_env.capturemode = capturemode;
+	}
 	FETCHENV_BOOL("VGL_CHROMEHACK", chromeHack);
 	FETCHENV_STR("VGL_CLIENT", client);
+	FETCHENV_BOOL("VGL_COMPACTHDR", compacthdr);
 	if((env = getenv("VGL_SUBSAMP")) != NULL && strlen(env) > 0)
 	{
 		int subsamp = -1;
@@ -336,7 +365,9 @@ void fconfig_reloadenv(void)
 		if((env[0] == '/' || !strnicmp(env, "EGL", 3)))
 			fconfig.egl = true;
 	}
+	FETCHENV_BOOL("VGL_DAMAGE", damage);
 	FETCHENV_BOOL("VGL_DLSYM", dlsymloader);
+	FETCHENV_INT("VGL_DRAWPOOL", drawpool, 0, 65536);
 	FETCHENV_STR("VGL_EGLLIB", egllib);
 	// This is a hack to allow piglit tests to pass with the EGL/X11 front end,
 	// which doesn't (yet) support Pixmap surfaces.
@@ -411,11 +442,15 @@ void fconfig_reloadenv(void)
 	}
 	FETCHENV_BOOL("VGL_INTERFRAME", interframe);
 	FETCHENV_STR("VGL_LOG", log);
+	FETCHENV_BOOL("VGL_LOGASYNC", logasync);
 	FETCHENV_BOOL("VGL_LOGO", logo);
+	FETCHENV_INT("VGL_LOGREPEAT", logrepeat, 0, 65536);
+	FETCHENV_BOOL("VGL_LOSSLESS", lossless);
 	FETCHENV_INT("VGL_NPROCS", np, 1, min(NumProcs(), MAXPROCS));
 	#ifdef FAKEOPENCL
 	FETCHENV_STR("VGL_OCLLIB", ocllib);
 	#endif
+	FETCHENV_BOOL("VGL_PACE", pace);
 	FETCHENV_INT("VGL_PORT", port, 0, 65535);
 	FETCHENV_BOOL("VGL_PROBEGLX", probeglx);
 	FETCHENV_INT("VGL_QUAL", qual, 1, 100);
@@ -425,6 +460,7 @@ void fconfig_reloadenv(void)
 		if(!strnicmp(env, "N", 1)) readback = RRREAD_NONE;
 		else if(!strnicmp(env, "P", 1)) readback = RRREAD_PBO;
 		else if(!strnicmp(env, "S", 1)) readback = RRREAD_SYNC;
+		else if(!strnicmp(env, "T", 1)) readback = RRREAD_THREAD;
 		else
 		{
 			char *t = NULL;  int itemp = strtol(env, &t, 10);
@@ -434,8 +470,12 @@ void fconfig_reloadenv(void)
 		if(readback >= 0 && (!fconfig_envset || fconfig_env.readback != readback))
 			fconfig.readback = fconfig_env.readback = readback;
 	}
+	FETCHENV_INT("VGL_READSTRIPE", readstripe, 0, 65536);
+	FETCHENV_DBL("VGL_REFINE", refine, 0.0, 1000.0);
 	FETCHENV_DBL("VGL_REFRESHRATE", refreshrate, 0.0, 1000000.0);
 	FETCHENV_INT("VGL_SAMPLES", samples, 0, 64);
+	FETCHENV_STR("VGL_SCHED", sched);
+	FETCHENV_BOOL("VGL_SHMTRANS", shmtrans);
 	FETCHENV_BOOL("VGL_SPOIL", spoil);
 	FETCHENV_BOOL("VGL_SPOILLAST", spoillast);
 	{
@@ -460,14 +500,17 @@ void fconfig_reloadenv(void)
 				fconfig.stereo = fconfig_env.stereo = stereo;
 		}
 	}
+	FETCHENV_INT("VGL_STREAMS", streams, 1, RR_MAXSTREAMS);
 	FETCHENV_BOOL("VGL_SYNC", sync);
 	FETCHENV_INT("VGL_TILESIZE", tilesize, 8, 1024);
+	FETCHENV_BOOL("VGL_TOPDOWN", topdown);
 	FETCHENV_BOOL("VGL_TRACE", trace);
 	FETCHENV_INT("VGL_TRANSPIXEL", transpixel, 0, 255);
 	FETCHENV_BOOL("VGL_TRAPX11", trapx11);
 	FETCHENV_STR("VGL_XVENDOR", vendor);
 	FETCHENV_BOOL("VGL_VERBOSE", verbose);
 	FETCHENV_BOOL("VGL_WM", wm);
+	FETCHENV_INT("VGL_WORKERS", workers, 0, 1024);
 	FETCHENV_STR("VGL_X11LIB", x11lib);
 	#ifdef FAKEXCB
 	FETCHENV_STR("VGL_XCBLIB", xcblib);
@@ -621,14 +664,22 @@ void fconfig_setprobeglxfromdpy(Display *dpy)
 
 void fconfig_print(FakerConfig &fc)
 {
+	PRCONF_DBL(adaptive);
+	PRCONF_DBL(adaptivembps);
+	PRCONF_STR(affinity);
 	PRCONF_INT(allowindirect);
 	PRCONF_INT(amdgpuHack);
+	PRCONF_STR(capture);
+	PRCONF_INT(capturemode);
 	PRCONF_INT(chromeHack);
 	PRCONF_STR(client);
+	PRCONF_INT(compacthdr);
 	PRCONF_INT(compress);
 	PRCONF_STR(config);
+	PRCONF_INT(damage);
 	PRCONF_STR(defaultfbconfig);
 	PRCONF_INT(dlsymloader);
+	PRCONF_INT(drawpool);
 	PRCONF_INT(egl);
 	PRCONF_STR(egllib);
 	PRCONF_STR(excludeddpys);
@@ -646,21 +697,31 @@ void fconfig_print(FakerConfig &fc)
 	PRCONF_INT(interframe);
 	PRCONF_STR(localdpystring);
 	PRCONF_STR(log);
+	PRCONF_INT(logasync);
 	PRCONF_INT(logo);
+	PRCONF_INT(logrepeat);
+	PRCONF_INT(lossless);
 	PRCONF_INT(np);
 	#ifdef FAKEOPENCL
 	PRCONF_STR(ocllib);
 	#endif
+	PRCONF_INT(pace);
 	PRCONF_INT(port);
 	PRCONF_INT(qual);
 	PRCONF_INT(readback);
+	PRCONF_INT(readstripe);
+	PRCONF_DBL(refine);
 	PRCONF_INT(samples);
+	PRCONF_STR(sched);
+	PRCONF_INT(shmtrans);
 	PRCONF_INT(spoil);
 	PRCONF_INT(spoillast);
 	PRCONF_INT(stereo);
+	PRCONF_INT(streams);
 	PRCONF_INT(subsamp);
 	PRCONF_INT(sync);
 	PRCONF_INT(tilesize);
+	PRCONF_INT(topdown);
 	PRCONF_INT(trace);
 	PRCONF_INT(transpixel);
 	PRCONF_INT(transvalid[RRTRANS_X11]);
@@ -670,6 +731,7 @@ void fconfig_print(FakerConfig &fc)
 	PRCONF_STR(vendor);
 	PRCONF_INT(verbose);
 	PRCONF_INT(wm);
+	PRCONF_INT(workers);
 	PRCONF_STR(x11lib);
 	#ifdef FAKEXCB
 	PRCONF_STR(xcblib);
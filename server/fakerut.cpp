@@ -3680,6 +3680,7 @@ int procAddrTest(void)
 		TEST_PROC_SYM(glPopAttrib)
 		TEST_PROC_SYM(glReadBuffer)
 		TEST_PROC_SYM(glReadPixels);
+		TEST_PROC_SYM(glScissor)
 		TEST_PROC_SYM(glViewport)
 
 		printf("SUCCESS!\n");
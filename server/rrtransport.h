@@ -1,5 +1,5 @@
 /* Copyright (C)2005 Sun Microsystems, Inc.
- * Copyright (C)2009-2011, 2018, 2020 D. R. Commander
+ * Copyright (C)2009-2011, 2018, 2020, 2026 D. R. Commander
  *
  * This library is free software and may be redistributed and/or modified under
  * the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -19,6 +19,10 @@
 #include "rr.h"
 
 
+/* Version of the transport plugin API described in this header.  Plugins that
+   implement only RRTransGetFrame() and RRTransSendFrame() use version 1. */
+#define RRTRANS_API_VERSION  2
+
 /* Pixel formats */
 #define RRTRANS_FORMATOPT  6
 enum
@@ -63,6 +67,104 @@ typedef struct _RRFrame
 
 } RRFrame;
 
+
+/* RRFrame2 flags (set by the plugin in RRTransGetFrame2()) */
+
+/* The pixels in the frame buffer should be delivered in top-down order rather
+   than bottom-up order. */
+#define RRTRANS_TOPDOWN     1
+
+/* The frame buffer already contains the pixels of the previous frame that
+   VirtualGL sent to this plugin instance, with the same dimensions, pixel
+   format, and orientation.  VirtualGL may then read back only the damaged
+   region of the new frame. */
+#define RRTRANS_PRESERVED   2
+
+/* The plugin will call the completion function (see RRFrameInfo) once it has
+   finished with this frame.  VirtualGL considers the frame to be in flight
+   until then, and if frame spoiling is enabled, VirtualGL will not send a new
+   frame while RRTRANS_MAXINFLIGHT frames are in flight. */
+#define RRTRANS_COMPLETION  4
+
+#define RRTRANS_MAXINFLIGHT  2
+
+typedef struct _RRFrame2
+{
+  /* Version 1 frame structure.  If bits is NULL and fd is >= 0, then VirtualGL
+     maps pitch * h bytes of the file descriptor, starting at fdOffset, and
+     reads back the rendered frame into the mapping.  If bits is NULL and fd is
+     < 0, then VirtualGL does not read back the rendered frame. */
+  RRFrame f;
+
+  /* See above */
+  int flags;
+
+  /* A memfd or linear dma-buf file descriptor that backs the frame buffer, or
+     -1 if none.  File descriptors are used only for mono frames.  The plugin
+     retains ownership of the file descriptor. */
+  int fd;
+  unsigned long long fdOffset;
+
+} RRFrame2;
+
+
+/* Completion status codes */
+enum
+{
+  /* The frame was delivered to the receiver. */
+  RRTRANS_DELIVERED = 0,
+  /* The frame was discarded (for instance, because of network congestion.) */
+  RRTRANS_DROPPED = 1,
+  /* The frame could not be delivered.  RRTransGetError() describes why. */
+  RRTRANS_FAILED = -1
+};
+
+typedef void (*RRTransCompleteFunc)(void *completeData,
+  unsigned long long frameID, int status);
+
+typedef struct _RRRect
+{
+  int x, y, w, h;
+} RRRect;
+
+#define RRTRANS_MAXRECTS  16
+
+/* Per-frame metadata that VirtualGL passes to RRTransSendFrame2().  The
+   structure is valid only for the duration of that call. */
+typedef struct _RRFrameInfo
+{
+  /* Sequence number of the frame within this plugin instance (starting at 1) */
+  unsigned long long frameID;
+
+  /* The regions of the frame that the application rendered since the
+     previous frame was sent to this plugin instance, in pixels relative to the
+     upper left corner of the frame.  If nRects is 0, then the whole frame
+     should be treated as damaged.  If the frame buffer has RRTRANS_PRESERVED
+     set, then only these regions were read back. */
+  int nRects;
+  RRRect rects[RRTRANS_MAXRECTS];
+
+  /* The time at which the application triggered the frame (by swapping
+     buffers, for instance), the time at which VirtualGL began reading back
+     the frame, and the time at which VirtualGL called RRTransSendFrame2(), in
+     seconds.  The epoch is arbitrary, but all three are measured with the same
+     clock. */
+  double tRequest, tReadback, tSend;
+
+  /* If the frame buffer has RRTRANS_COMPLETION set, then the plugin must call
+     complete(completeData, frameID, status) exactly once for this frame, from
+     any thread, once it has finished with the frame.  This applies even if
+     the plugin instance is destroyed before the frame is delivered (in which
+     case the status should be RRTRANS_DROPPED or RRTRANS_FAILED), and the
+     function must be called before RRTransDestroy() returns.  VirtualGL does
+     not free the data that completeData points to, or unload the plugin,
+     until the function has been called for every such frame, so a plugin
+     that fails to call it will cause VirtualGL to hang. */
+  RRTransCompleteFunc complete;
+  void *completeData;
+
+} RRFrameInfo;
+
 #if !defined(__SUNPRO_CC) && !defined(__SUNPRO_C)
 #pragma pack()
 #endif
@@ -224,7 +326,9 @@ int RRTransSendFrame(void *handle, RRFrame *frame, int sync);
 
 
 /*
-   Clean up an instance of the transport plugin
+   Clean up an instance of the transport plugin.  If any frames that were sent
+   with RRTRANS_COMPLETION are still in flight, then the plugin must call their
+   completion functions (see RRFrameInfo) before this function returns.
 
    PARAMETERS:
    handle (IN) = instance handle (returned from a previous call to
@@ -243,6 +347,58 @@ int RRTransDestroy(void *handle);
 const char *RRTransGetError(void);
 
 
+/*
+   The following functions are part of version 2 of the transport plugin API.
+   RRTransGetVersion() is optional.  If a plugin exports it and it returns 2 or
+   greater, then VirtualGL calls RRTransGetFrame2() and RRTransSendFrame2()
+   instead of RRTransGetFrame() and RRTransSendFrame().  (A version 2 plugin
+   must still export the version 1 functions.)
+*/
+
+/*
+   Return the version of the transport plugin API that the plugin implements
+   (normally RRTRANS_API_VERSION)
+*/
+int RRTransGetVersion(void);
+
+
+/*
+   Retrieve a frame buffer of the requested dimensions from the transport
+   plugin's buffer pool.  The parameters are the same as those of
+   RRTransGetFrame().  The plugin fills in the RRFrame2 structure, including
+   the flags and the file descriptor (see above.)
+
+   RETURN VALUE:
+   If a buffer is successfully allocated, then a non-NULL pointer to an
+   RRFrame2 structure is returned.  Otherwise, NULL is returned and the reason
+   for the failure can be queried with RRTransGetError().
+*/
+RRFrame2 *RRTransGetFrame2(void *handle, int width, int height, int format,
+  int stereo);
+
+
+/*
+   Send the contents of a frame buffer to the receiver (or queue it for
+   transmission)
+
+   PARAMETERS:
+   handle (IN) = instance handle (returned from a previous call to
+                 RRTransInit())
+   frame (IN) = pointer to an RRFrame2 structure obtained in a previous call to
+                RRTransGetFrame2()
+   info (IN) = per-frame metadata (see above)
+   sync (IN) = if this parameter is set to 1, then this frame must be delivered
+               synchronously to the client in order to maintain strict GLX
+               conformance
+
+   RETURN VALUE:
+   This function returns 0 on success or -1 on failure.  RRTransGetError() can
+   be called to determine the cause of the failure.
+*/
+int RRTransSendFrame2(void *handle, RRFrame2 *frame, const RRFrameInfo *info,
+  int sync);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,4 @@
-// Copyright (C)2009-2011, 2014, 2017-2021 D. R. Commander
+// Copyright (C)2009-2011, 2014, 2017-2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -52,7 +52,8 @@ FakerConfig *fconfig_getinstance(void)
 
 // This just wraps the VGLTrans class in order to demonstrate how to build a
 // custom transport plugin for VGL and also to serve as a sanity check for the
-// plugin API
+// plugin API.  It implements version 2 of the API, whereas testplugin2 (which
+// wraps the X11Trans class) implements only version 1.
 
 extern "C" {
 
@@ -260,4 +261,95 @@ const char *RRTransGetError(void)
 }
 
 
+int RRTransGetVersion(void)
+{
+	return RRTRANS_API_VERSION;
+}
+
+
+RRFrame2 *RRTransGetFrame2(void *handle, int width, int height, int format,
+	int stereo)
+{
+	_vgl_disableFaker();
+
+	RRFrame2 *frame = NULL;
+	try
+	{
+		VGLTrans *vglconn = (VGLTrans *)handle;
+		if(!vglconn) THROW("Invalid handle");
+		frame = new RRFrame2;
+		memset(frame, 0, sizeof(RRFrame2));
+		frame->fd = -1;
+		int compress = fconfig->compress;
+		if(compress == RRCOMP_PROXY || compress == RRCOMP_RGB)
+			compress = RRCOMP_RGB;
+		else compress = RRCOMP_JPEG;
+		int pixelFormat = PF_RGB;
+		if(compress != RRCOMP_RGB) pixelFormat = trans2pf[format];
+		Frame *f = vglconn->getFrame(width, height, pixelFormat, FRAME_BOTTOMUP,
+			(bool)stereo);
+		f->hdr.compress = compress;
+		frame->f.opaque = (void *)f;
+		frame->f.w = f->hdr.framew;
+		frame->f.h = f->hdr.frameh;
+		frame->f.pitch = f->pitch;
+		frame->f.bits = f->bits;
+		frame->f.rbits = f->rbits;
+		frame->f.format = pf2trans[f->pf->id];
+		if(frame->f.format < 0) THROW("Unsupported pixel format");
+		// Seeding the frame with the previous frame allows VirtualGL to read
+		// back only the damaged region.
+		frame->flags = RRTRANS_COMPLETION;
+		if(vglconn->copyLastFrame(f)) frame->flags |= RRTRANS_PRESERVED;
+	}
+	catch(std::exception &e)
+	{
+		snprintf(errStr, MAXSTR + 14, "Error in %s -- %s", GET_METHOD(e),
+			e.what());
+		delete frame;
+		frame = NULL;
+	}
+
+	_vgl_enableFaker();
+
+	return frame;
+}
+
+
+int RRTransSendFrame2(void *handle, RRFrame2 *frame, const RRFrameInfo *info,
+	int sync)
+{
+	_vgl_disableFaker();
+
+	int ret = 0;
+	try
+	{
+		VGLTrans *vglconn = (VGLTrans *)handle;
+		if(!vglconn) THROW("Invalid handle");
+		Frame *f;
+		if(!frame || (f = (Frame *)frame->f.opaque) == NULL)
+			THROW("Invalid frame handle");
+		if(!info) THROW("Invalid argument");
+		f->hdr.qual = fconfig->qual;
+		f->hdr.subsamp = fconfig->subsamp;
+		f->hdr.winid = win;
+		vglconn->sendFrame(f);
+		// The VGL Transport owns the frame once it has been queued.
+		if(info->complete)
+			info->complete(info->completeData, info->frameID, RRTRANS_DELIVERED);
+		delete frame;
+	}
+	catch(std::exception &e)
+	{
+		snprintf(errStr, MAXSTR + 14, "Error in %s -- %s", GET_METHOD(e),
+			e.what());
+		ret = -1;
+	}
+
+	_vgl_enableFaker();
+
+	return ret;
+}
+
+
 }  // extern "C"
@@ -0,0 +1,85 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "transworkers.h"
+#include "fakerconfig.h"
+#include "vglutil.h"
+#include "Log.h"
+#include <unistd.h>
+
+using namespace util;
+
+
+// The pool is never destroyed, since transports may still be using it while
+// the process is exiting.  A child process cannot use the worker threads of
+// its parent, so it gets its own pool.
+static WorkerPool *workerPool = NULL;
+static pid_t workerPoolPID = 0;
+static CriticalSection workerPoolMutex;
+static bool warned = false;
+
+
+static void warnOnce(const char *what, const char *message)
+{
+	CriticalSection::SafeLock l(workerPoolMutex);
+	if(warned) return;
+	vglout.println("[VGL] WARNING: Could not apply %s:\n[VGL]    %s", what,
+		message);
+	warned = true;
+}
+
+
+WorkerPool *server::getWorkerPool(void)
+{
+	WorkerPool *pool = NULL;
+
+	{
+		CriticalSection::SafeLock l(workerPoolMutex);
+		if(!workerPool || workerPoolPID != getpid())
+		{
+			int nThreads = fconfig.workers;
+			if(nThreads < 1) nThreads = max(NumProcs() - 1, 1);
+			workerPool = new WorkerPool(nThreads,
+				strlen(fconfig.affinity) > 0 ? fconfig.affinity : NULL,
+				strlen(fconfig.sched) > 0 ? fconfig.sched : NULL);
+			workerPoolPID = getpid();
+			if(fconfig.verbose)
+				vglout.println("[VGL] Created a pool of %d worker threads", nThreads);
+		}
+		pool = workerPool;
+	}
+
+	const char *error = pool->getSetupError();
+	if(error) warnOnce("VGL_AFFINITY/VGL_SCHED to worker threads", error);
+	return pool;
+}
+
+
+void server::initTransportThread(void)
+{
+	try
+	{
+		if(strlen(fconfig.affinity) > 0) Thread::setAffinity(fconfig.affinity);
+	}
+	catch(std::exception &e)
+	{
+		warnOnce("VGL_AFFINITY", e.what());
+	}
+	try
+	{
+		if(strlen(fconfig.sched) > 0) Thread::setScheduling(fconfig.sched);
+	}
+	catch(std::exception &e)
+	{
+		warnOnce("VGL_SCHED", e.what());
+	}
+}
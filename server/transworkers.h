@@ -0,0 +1,33 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#ifndef __TRANSWORKERS_H__
+#define __TRANSWORKERS_H__
+
+#include "WorkerPool.h"
+
+
+namespace server
+{
+	// Return the process-wide pool of worker threads on which all of the image
+	// transports run their parallel compression and encoding jobs.  The pool is
+	// created on first use, with VGL_WORKERS threads, and its threads use the
+	// CPU affinity and scheduling policy specified by VGL_AFFINITY and
+	// VGL_SCHED.
+	util::WorkerPool *getWorkerPool(void);
+
+	// Apply VGL_AFFINITY and VGL_SCHED to the calling thread.  Each image
+	// transport calls this when its thread starts.
+	void initTransportThread(void);
+}
+
+#endif  // __TRANSWORKERS_H__
@@ -0,0 +1,522 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+// This program benchmarks the VGL Transport image pipeline end to end, without
+// a GPU.  It synthesizes frames with various types of content, measures the
+// throughput of each stage of the pipeline in isolation, and then drives the
+// real VGLTrans code over a loopback connection to either an in-process
+// receiver (which decodes the frames in the same manner as the VirtualGL
+// Client) or the VirtualGL Client code itself (which draws the frames to an X
+// server, such as Xvfb.)
+
+#include <math.h>
+#include <sys/resource.h>
+#include "VGLTrans.h"
+#include "LoopbackReceiver.h"
+#include "VGLTransReceiver.h"
+#include "vglutil.h"
+#include "Timer.h"
+#include "fakerconfig.h"
+
+using namespace util;
+using namespace common;
+using namespace server;
+using namespace client;
+
+
+// The VirtualGL Client code expects this to be defined
+Display *maindpy = NULL;
+
+#define MAXFRAMES  100000
+
+
+// Synthetic frame content
+
+enum { CONTENT_MOVING = 0, CONTENT_UI, CONTENT_NOISE, NCONTENT };
+
+static const char *contentName[NCONTENT] =
+{
+	"Moving", "Static UI", "Video-like noise"
+};
+
+static const char *contentArg[NCONTENT] = { "moving", "ui", "noise" };
+
+
+// Generates BGRX frames of the following types:
+// moving = a smooth gradient background with a box (whose contents also
+//          change) moving across it, so that a portion of the frame changes
+//          from one frame to the next
+// ui = flat-colored panels with text-like detail, of which only a small clock
+//      and progress bar change from one frame to the next
+// noise = random pixels, so that every pixel changes from one frame to the
+//         next and the frame is hard to compress
+
+class ContentGenerator
+{
+	public:
+
+		ContentGenerator(int type_, int width_, int height_) : type(type_),
+			width(width_), height(height_), bg(NULL), seed(0x12345678)
+		{
+			bg = new unsigned char[width * height * 4];
+			for(int y = 0; y < height; y++)
+			{
+				unsigned char *row = &bg[width * 4 * y];
+				for(int x = 0; x < width; x++)
+				{
+					unsigned char *p = &row[x * 4];
+					if(type == CONTENT_UI)
+					{
+						// Panels with 1-pixel borders, and rows of "text" in the main
+						// panel
+						bool border = (x % 320 == 0 || y % 200 == 0);
+						bool text = (x % 320) > 16 && (y % 200) > 24 && (y % 16) < 9
+							&& ((x / 7 + y / 16) % 11) != 0 && ((x * 13 + y) % 7) > 1;
+						unsigned char c = border ? 96 : (text ? 32 : 230);
+						if(y < 32) c = border ? 64 : 200;
+						p[0] = c;  p[1] = c;  p[2] = (y < 32) ? 160 : c;
+					}
+					else
+					{
+						p[0] = (unsigned char)(x * 255 / width);
+						p[1] = (unsigned char)(y * 255 / height);
+						p[2] = (unsigned char)((x + y) * 255 / (width + height));
+					}
+					p[3] = 0;
+				}
+			}
+		}
+
+		~ContentGenerator(void)
+		{
+			delete [] bg;
+		}
+
+		void generate(Frame &f, int n)
+		{
+			int x, y;
+
+			if(type == CONTENT_NOISE)
+			{
+				for(y = 0; y < height; y++)
+				{
+					unsigned int *row = (unsigned int *)&f.bits[f.pitch * y];
+					for(x = 0; x < width; x++)
+					{
+						seed ^= seed << 13;  seed ^= seed >> 17;  seed ^= seed << 5;
+						row[x] = seed & 0xFFFFFF;
+					}
+				}
+				return;
+			}
+
+			for(y = 0; y < height; y++)
+				memcpy(&f.bits[f.pitch * y], &bg[width * 4 * y], width * 4);
+
+			if(type == CONTENT_MOVING)
+			{
+				int bw = max(width / 4, 1), bh = max(height / 4, 1);
+				int bx = (int)((double)(width - bw) *
+					(0.5 + 0.5 * sin((double)n * 0.05)));
+				int by = (int)((double)(height - bh) *
+					(0.5 + 0.5 * sin((double)n * 0.037)));
+				for(y = by; y < by + bh; y++)
+				{
+					unsigned char *p = &f.bits[f.pitch * y + bx * 4];
+					for(x = 0; x < bw; x++, p += 4)
+					{
+						p[0] = (unsigned char)(x + n * 3);
+						p[1] = (unsigned char)(y * 2 - n);
+						p[2] = (unsigned char)(x ^ (y + n));
+					}
+				}
+			}
+			else if(type == CONTENT_UI)
+			{
+				// Clock
+				int cx = max(width - 112, 0);
+				for(y = 8; y < min(24, height); y++)
+				{
+					unsigned char *p = &f.bits[f.pitch * y + cx * 4];
+					for(x = 0; x < min(96, width - cx); x++, p += 4)
+					{
+						bool lit = ((x / 6 + n / 4 + y / 3) % 5) < 2;
+						p[0] = p[1] = p[2] = lit ? 255 : 200;
+					}
+				}
+				// Progress bar
+				int py = max(height - 24, 0), pw = (n * 4) % max(width - 32, 1);
+				for(y = py; y < min(py + 8, height); y++)
+				{
+					unsigned char *p = &f.bits[f.pitch * y + 16 * 4];
+					for(x = 0; x < pw; x++, p += 4)
+					{
+						p[0] = 200;  p[1] = 120;  p[2] = 40;
+					}
+				}
+			}
+		}
+
+	private:
+
+		int type, width, height;
+		unsigned char *bg;
+		unsigned int seed;
+};
+
+
+static int compareDouble(const void *a, const void *b)
+{
+	double d = *(const double *)a - *(const double *)b;
+	return d < 0. ? -1 : (d > 0. ? 1 : 0);
+}
+
+
+static double cpuTime(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec *
+		0.000001 + (double)usage.ru_stime.tv_sec +
+		(double)usage.ru_stime.tv_usec * 0.000001;
+}
+
+
+static const char *subsampName(int subsamp)
+{
+	switch(subsamp)
+	{
+		case 0:  return "Grayscale";
+		case 1:  return "4:4:4";
+		case 2:  return "4:2:2";
+		default:  return "4:2:0";
+	}
+}
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s [options]\n\n", argv[0]);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-res <w>x<h> = Frame size (default: 1920x1080)\n");
+	fprintf(stderr, "-content <c> = Type of synthetic content: moving, ui, noise, or all\n");
+	fprintf(stderr, "               (default: all)\n");
+	fprintf(stderr, "-time <t> = Duration of each benchmark, in seconds (default: 2.0)\n");
+	fprintf(stderr, "-rgb = Use RGB (uncompressed) encoding (default is JPEG)\n");
+	fprintf(stderr, "-yuv = Use YUV encoding (default is JPEG)\n");
+	fprintf(stderr, "-samp <s> = JPEG chrominance subsampling factor: 0 (gray), 1, 2, or 4\n");
+	fprintf(stderr, "            (default: %d)\n", fconfig.subsamp);
+	fprintf(stderr, "-qual <q> = JPEG quality, 1 <= <q> <= 100 (default: %d)\n",
+		fconfig.qual);
+	fprintf(stderr, "-tilesize <n> = Width/height of each multithreaded compression/interframe\n");
+	fprintf(stderr, "                comparison tile (default: %d x %d pixels)\n",
+		fconfig.tilesize, fconfig.tilesize);
+	fprintf(stderr, "-np <n> = Number of threads to use for compression (default: %d)\n",
+		fconfig.np);
+	fprintf(stderr, "-spoil = Spoil frames that the VGL Transport cannot send quickly enough\n");
+	fprintf(stderr, "         (default is to wait for each frame to be sent)\n");
+	fprintf(stderr, "-shape <m> = Emulate a network link of <m> megabits/second\n");
+	fprintf(stderr, "-nodecode = Do not decode the frames in the in-process receiver\n");
+	fprintf(stderr, "-streams <n> = Number of connections to use for sending the frames\n");
+	fprintf(stderr, "               (default: %d)\n", fconfig.streams);
+	fprintf(stderr, "-v21 = Make the in-process receiver act as a v2.1 client, which does not\n");
+	fprintf(stderr, "       support compact headers, lossless tiles, or multiple connections\n");
+	fprintf(stderr, "-x = Send the frames to the VirtualGL Client code, which will draw them to\n");
+	fprintf(stderr, "     the X server specified in the DISPLAY environment variable (such as\n");
+	fprintf(stderr, "     Xvfb), rather than to the in-process receiver.  Latency cannot be\n");
+	fprintf(stderr, "     measured in this mode.\n\n");
+	exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+	int i, retval = 0, width = 1920, height = 1080, content = -1;
+	double benchTime = 2.0, shapeMbps = 0.;
+	bool spoil = false, decode = true, useX = false, v21 = false;
+	Window win = 0;  VGLTransReceiver *xReceiver = NULL;
+	double *submitTimes = NULL, *arrivalTimes = NULL, *latencies = NULL;
+
+	try
+	{
+		fconfig_setcompress(fconfig, RRCOMP_JPEG);
+
+		for(i = 1; i < argc; i++)
+		{
+			if(!stricmp(argv[i], "-h") || !strcmp(argv[i], "-?")) usage(argv);
+			else if(!stricmp(argv[i], "-res") && i < argc - 1)
+			{
+				if(sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 1
+					|| height < 1 || width > 65535 || height > 65535)
+					usage(argv);
+			}
+			else if(!stricmp(argv[i], "-content") && i < argc - 1)
+			{
+				i++;
+				if(!stricmp(argv[i], "all")) content = -1;
+				else
+				{
+					for(content = 0; content < NCONTENT; content++)
+						if(!stricmp(argv[i], contentArg[content])) break;
+					if(content >= NCONTENT) usage(argv);
+				}
+			}
+			else if(!stricmp(argv[i], "-time") && i < argc - 1)
+			{
+				benchTime = atof(argv[++i]);
+				if(benchTime <= 0.) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-rgb"))
+				fconfig_setcompress(fconfig, RRCOMP_RGB);
+			else if(!stricmp(argv[i], "-yuv"))
+				fconfig_setcompress(fconfig, RRCOMP_YUV);
+			else if(!stricmp(argv[i], "-samp") && i < argc - 1)
+			{
+				fconfig.subsamp = atoi(argv[++i]);
+				if(fconfig.subsamp != 0 && fconfig.subsamp != 1
+					&& fconfig.subsamp != 2 && fconfig.subsamp != 4)
+					usage(argv);
+			}
+			else if(!stricmp(argv[i], "-qual") && i < argc - 1)
+			{
+				fconfig.qual = atoi(argv[++i]);
+				if(fconfig.qual < 1 || fconfig.qual > 100) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-tilesize") && i < argc - 1)
+			{
+				fconfig.tilesize = atoi(argv[++i]);
+			}
+			else if(!stricmp(argv[i], "-np") && i < argc - 1)
+			{
+				fconfig.np = atoi(argv[++i]);
+				if(fconfig.np < 1 || fconfig.np > MAXPROCS) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-spoil")) spoil = true;
+			else if(!stricmp(argv[i], "-shape") && i < argc - 1)
+			{
+				shapeMbps = atof(argv[++i]);
+				if(shapeMbps <= 0.) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-nodecode")) decode = false;
+			else if(!stricmp(argv[i], "-streams") && i < argc - 1)
+			{
+				fconfig.streams = atoi(argv[++i]);
+				if(fconfig.streams < 1 || fconfig.streams > RR_MAXSTREAMS)
+					usage(argv);
+			}
+			else if(!stricmp(argv[i], "-v21")) v21 = true;
+			else if(!stricmp(argv[i], "-x")) useX = true;
+			else usage(argv);
+		}
+		fconfig.capture[0] = 0;
+
+		if(useX)
+		{
+			if(!XInitThreads()) THROW("Could not initialize X threads");
+			if((maindpy = XOpenDisplay(0)) == NULL)
+				THROW("Could not open display");
+			if((win = XCreateSimpleWindow(maindpy, DefaultRootWindow(maindpy), 0, 0,
+				width, height, 0, WhitePixel(maindpy, DefaultScreen(maindpy)),
+				BlackPixel(maindpy, DefaultScreen(maindpy)))) == 0)
+				THROW("Could not create window");
+			ERRIFNOT(XMapRaised(maindpy, win));
+			XSync(maindpy, False);
+			xReceiver = new VGLTransReceiver(false, RR_DRAWX11);
+			xReceiver->listen(0);
+		}
+
+		if((submitTimes = (double *)malloc(sizeof(double) * MAXFRAMES)) == NULL
+			|| (arrivalTimes = (double *)malloc(sizeof(double) * MAXFRAMES)) == NULL
+			|| (latencies = (double *)malloc(sizeof(double) * MAXFRAMES)) == NULL)
+			THROW("Memory allocation error");
+
+		int compress = fconfig.compress, np = fconfig.np;
+		int tileSize = compress == RRCOMP_YUV ? 0 : fconfig.tilesize;
+		if(compress == RRCOMP_YUV) fconfig.subsamp = 4;
+		double framePixels = (double)width * (double)height;
+
+		for(int c = 0; c < NCONTENT; c++)
+		{
+			if(content >= 0 && c != content) continue;
+
+			printf("\n%s content, %d x %d, ", contentName[c], width, height);
+			if(compress == RRCOMP_JPEG)
+				printf("JPEG (quality %d, %s)", fconfig.qual,
+					subsampName(fconfig.subsamp));
+			else if(compress == RRCOMP_YUV) printf("YUV");
+			else printf("RGB");
+			printf(", %d thread%s, %s\n", np, np > 1 ? "s" : "",
+				useX ? "VirtualGL Client" :
+					(decode ? "in-process receiver" :
+						"in-process receiver (no decoding)"));
+
+			ContentGenerator gen(c, width, height);
+			Frame frame;
+			rrframeheader hdr;
+			memset(&hdr, 0, sizeof(rrframeheader));
+			hdr.width = hdr.framew = width;
+			hdr.height = hdr.frameh = height;
+			frame.init(hdr, PF_BGRX, FRAME_BOTTOMUP);
+			frame.hdr.compress = compress;  frame.hdr.qual = fconfig.qual;
+			frame.hdr.subsamp = fconfig.subsamp;
+
+			// Stage 1: synthesis (analogous to readback)
+			Timer timer;  double elapsed;  int n = 0;
+			timer.start();
+			do
+			{
+				gen.generate(frame, n++);
+			} while((elapsed = timer.elapsed()) < benchTime);
+			printf("Synthesis:      %f Megapixels/sec\n",
+				framePixels * (double)n / 1000000. / elapsed);
+
+			// Stages 2 and 3: compression and decompression, using one thread and
+			// no interframe comparison
+			CompressedFrame cframe;  TileDecoder decoder;  Timer stageTimer;
+			double compTime = 0., decompTime = 0., compBytes = 0.;  int frames = 0;
+			timer.start();
+			do
+			{
+				gen.generate(frame, frames);
+				int tw = tileSize ? tileSize : width, th = tileSize ? tileSize : height;
+				for(int y = 0; y < height; y += th)
+				{
+					for(int x = 0; x < width; x += tw)
+					{
+						Frame *tile = frame.getTile(x, y, min(tw, width - x),
+							min(th, height - y));
+						stageTimer.start();
+						cframe = *tile;
+						compTime += stageTimer.elapsed();
+						delete tile;
+						compBytes += (double)cframe.hdr.size;
+						stageTimer.start();
+						decoder.decode(cframe.hdr, cframe.bits);
+						decompTime += stageTimer.elapsed();
+					}
+				}
+				frames++;
+			} while(timer.elapsed() < benchTime);
+			printf("Compression:    %f Megapixels/sec\n",
+				framePixels * (double)frames / 1000000. / compTime);
+			printf("Decompression:  %f Megapixels/sec\n",
+				framePixels * (double)frames / 1000000. / decompTime);
+			printf("Compressed:     %f bytes/frame (%f:1)\n",
+				compBytes / (double)frames,
+				framePixels * 3. * (double)frames / compBytes);
+
+			// Stage 4: end to end
+			LoopbackReceiver *receiver = NULL;
+			for(i = 0; i < MAXFRAMES; i++) arrivalTimes[i] = 0.;
+			double cpuStart, cpuEnd;  int sent = 0;
+			{
+				VGLTrans vglconn;
+				char client[80];
+				if(useX)
+				{
+					const char *dpyNum = strrchr(DisplayString(maindpy), ':');
+					snprintf(client, 80, "127.0.0.1%s", dpyNum ? dpyNum : ":0");
+					vglconn.connect(client, xReceiver->getPort());
+				}
+				else
+				{
+					// The in-process receiver does not use the shared-memory transport,
+					// and the server will not offer multiple connections if it offers
+					// shared memory.
+					fconfig.shmtrans = 0;
+					receiver = new LoopbackReceiver(shapeMbps, decode, v21);
+					receiver->setArrivalLog(arrivalTimes, MAXFRAMES);
+					snprintf(client, 80, "127.0.0.1:0");
+					vglconn.connect(client, receiver->getPort());
+				}
+
+				cpuStart = cpuTime();
+				timer.start();
+				do
+				{
+					Frame *f;
+					if(!spoil) vglconn.synchronize();
+					ERRIFNOT(f = vglconn.getFrame(width, height, PF_BGRX,
+						FRAME_BOTTOMUP, false));
+					gen.generate(*f, sent);
+					f->hdr.qual = fconfig.qual;  f->hdr.subsamp = fconfig.subsamp;
+					f->hdr.compress = compress;
+					f->hdr.winid = useX ? win : sent;
+					submitTimes[sent] = timer.time();
+					vglconn.sendFrame(f);
+					sent++;
+				} while(timer.elapsed() < benchTime && sent < MAXFRAMES);
+
+				if(receiver)
+				{
+					// Wait for the last frame (which cannot be spoiled) to arrive.
+					Timer waitTimer;  waitTimer.start();
+					while(arrivalTimes[sent - 1] == 0. && waitTimer.elapsed() < 30.)
+						usleep(100);
+				}
+				else vglconn.synchronize();
+				elapsed = timer.elapsed();
+				cpuEnd = cpuTime();
+			}
+
+			int received = sent, nLatencies = 0;
+			if(receiver)
+			{
+				received = receiver->getFrames();
+				for(i = 0; i < sent; i++)
+					if(arrivalTimes[i] > 0.)
+						latencies[nLatencies++] = arrivalTimes[i] - submitTimes[i];
+			}
+			printf("End-to-end:     %f frames/sec, %f Megapixels/sec",
+				(double)received / elapsed,
+				framePixels * (double)received / 1000000. / elapsed);
+			if(received < sent) printf(" (%d frames spoiled)", sent - received);
+			printf("\n");
+			if(nLatencies > 0)
+			{
+				qsort(latencies, nLatencies, sizeof(double), compareDouble);
+				printf("Latency:        p50 = %f ms, p90 = %f ms, p99 = %f ms, max = %f ms\n",
+					latencies[(nLatencies - 1) / 2] * 1000.,
+					latencies[(int)((double)(nLatencies - 1) * 0.9)] * 1000.,
+					latencies[(int)((double)(nLatencies - 1) * 0.99)] * 1000.,
+					latencies[nLatencies - 1] * 1000.);
+			}
+			if(receiver)
+			{
+				printf("Sent:           %f bytes/frame\n",
+					receiver->getBytes() / (double)received);
+				unsigned int caps = receiver->getCaps();
+				printf("Protocol:       %s%s%s, %d connection%s\n",
+					v21 ? "v2.1" : "v2.2",
+					caps & RR_CAP_COMPACT ? ", compact headers" : "",
+					caps & RR_CAP_LOSSLESS ? ", lossless tiles" : "",
+					receiver->getStreams(), receiver->getStreams() > 1 ? "s" : "");
+			}
+			printf("CPU:            %f ms/frame\n",
+				(cpuEnd - cpuStart) * 1000. / (double)received);
+			delete receiver;
+		}
+	}
+	catch(std::exception &e)
+	{
+		printf("%s--\n%s\n", GET_METHOD(e), e.what());
+		retval = -1;
+	}
+
+	delete xReceiver;
+	if(win) XDestroyWindow(maindpy, win);
+	if(maindpy) XCloseDisplay(maindpy);
+	free(submitTimes);
+	free(arrivalTimes);
+	free(latencies);
+	return retval;
+}
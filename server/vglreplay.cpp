@@ -0,0 +1,209 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+// This program replays a capture file created with VGL_CAPTURE as fast as
+// possible, without a GPU or an X server.  Uncompressed frames are fed through
+// the VGL Transport's compressors (and optionally decoded by an in-process
+// receiver), and compressed tiles are decoded in the same manner as the
+// VirtualGL Client would decode them.
+
+#include "VGLTrans.h"
+#include "LoopbackReceiver.h"
+#include "FrameCapture.h"
+#include "vglutil.h"
+#include "Timer.h"
+#include "fakerconfig.h"
+
+using namespace util;
+using namespace common;
+using namespace server;
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s <capture file> [options]\n\n", argv[0]);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-frames = Replay the uncompressed frames in the capture through the VGL\n");
+	fprintf(stderr, "          Transport's compressors (default if the capture contains\n");
+	fprintf(stderr, "          uncompressed frames)\n");
+	fprintf(stderr, "-stream = Decode the compressed tiles in the capture (default if the capture\n");
+	fprintf(stderr, "          contains no uncompressed frames)\n");
+	fprintf(stderr, "-decode = When replaying uncompressed frames, also decode the compressed\n");
+	fprintf(stderr, "          tiles that the VGL Transport generates\n");
+	fprintf(stderr, "-loop <n> = Replay the capture <n> times (default: 1)\n");
+	fprintf(stderr, "\nThe following options override the settings with which the uncompressed\n");
+	fprintf(stderr, "frames were captured:\n");
+	fprintf(stderr, "-rgb = Use RGB (uncompressed) encoding\n");
+	fprintf(stderr, "-yuv = Use YUV encoding\n");
+	fprintf(stderr, "-jpeg = Use JPEG compression\n");
+	fprintf(stderr, "-samp <s> = JPEG chrominance subsampling factor: 0 (gray), 1, 2, or 4\n");
+	fprintf(stderr, "-qual <q> = JPEG quality, 1 <= <q> <= 100\n");
+	fprintf(stderr, "-tilesize <n> = Width/height of each multithreaded compression/interframe\n");
+	fprintf(stderr, "                comparison tile (default: %d x %d pixels)\n",
+		fconfig.tilesize, fconfig.tilesize);
+	fprintf(stderr, "-np <n> = Number of threads to use for compression (default: %d)\n\n",
+		fconfig.np);
+	exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+	Timer timer;  double elapsed;
+	CaptureReader *reader = NULL;  LoopbackReceiver *receiver = NULL;
+	int i, retval = 0, loops = 1, compress = -1, qual = -1, subsamp = -1;
+	bool replayFrames = false, replayStream = false, decode = false;
+
+	try
+	{
+		if(argc < 2) usage(argv);
+		if(!stricmp(argv[1], "-h") || !strcmp(argv[1], "-?")) usage(argv);
+
+		if(argc > 2) for(i = 2; i < argc; i++)
+		{
+			if(!stricmp(argv[i], "-h") || !strcmp(argv[i], "-?")) usage(argv);
+			else if(!stricmp(argv[i], "-frames")) replayFrames = true;
+			else if(!stricmp(argv[i], "-stream")) replayStream = true;
+			else if(!stricmp(argv[i], "-decode")) decode = true;
+			else if(!stricmp(argv[i], "-loop") && i < argc - 1)
+			{
+				loops = atoi(argv[++i]);
+				if(loops < 1) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-rgb")) compress = RRCOMP_RGB;
+			else if(!stricmp(argv[i], "-yuv")) compress = RRCOMP_YUV;
+			else if(!stricmp(argv[i], "-jpeg")) compress = RRCOMP_JPEG;
+			else if(!stricmp(argv[i], "-samp") && i < argc - 1)
+			{
+				subsamp = atoi(argv[++i]);
+				if(subsamp != 0 && subsamp != 1 && subsamp != 2 && subsamp != 4)
+					usage(argv);
+			}
+			else if(!stricmp(argv[i], "-qual") && i < argc - 1)
+			{
+				qual = atoi(argv[++i]);
+				if(qual < 1 || qual > 100) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-tilesize") && i < argc - 1)
+			{
+				fconfig.tilesize = atoi(argv[++i]);
+			}
+			else if(!stricmp(argv[i], "-np") && i < argc - 1)
+			{
+				fconfig.np = atoi(argv[++i]);
+				if(fconfig.np < 1 || fconfig.np > MAXPROCS) usage(argv);
+			}
+			else usage(argv);
+		}
+
+		// Don't capture the replay.
+		fconfig.capture[0] = 0;
+
+		reader = new CaptureReader(argv[1]);
+		unsigned int nFrames = 0, nTiles = 0;
+		for(unsigned int r = 0; r < reader->getCount(); r++)
+		{
+			if(reader->getRecord(r)->type == CAPTURE_FRAME) nFrames++;
+			else nTiles++;
+		}
+		printf("Capture contains %u uncompressed frames and %u compressed tiles\n",
+			nFrames, nTiles);
+		if(!replayFrames && !replayStream)
+		{
+			if(nFrames) replayFrames = true;
+			else replayStream = true;
+		}
+
+		if(replayFrames && nFrames)
+		{
+			printf("\nReplaying uncompressed frames through the VGL Transport%s ...\n",
+				decode ? " (with decoding)" : "");
+
+			receiver = new LoopbackReceiver(0., decode);
+			char client[] = "127.0.0.1:0";
+			VGLTrans vglconn;
+			vglconn.connect(client, receiver->getPort());
+
+			double pixels = 0., rawBytes = 0.;  int sent = 0;
+			timer.start();
+			for(int loop = 0; loop < loops; loop++)
+			{
+				for(unsigned int r = 0; r < reader->getCount(); r++)
+				{
+					const CaptureRecord *rec = reader->getRecord(r);
+					if(rec->type != CAPTURE_FRAME) continue;
+					const unsigned char *data = reader->getData(r);
+
+					Frame *f;
+					vglconn.synchronize();
+					ERRIFNOT(f = vglconn.getFrame(rec->hdr.framew, rec->hdr.frameh,
+						rec->pixelFormat, rec->flags, rec->stereo != 0));
+					int rowSize = min(f->pitch, (int)rec->pitch);
+					for(int y = 0; y < rec->hdr.frameh; y++)
+					{
+						memcpy(&f->bits[f->pitch * y], &data[rec->pitch * y], rowSize);
+						if(f->rbits && rec->stereo)
+							memcpy(&f->rbits[f->pitch * y],
+								&data[rec->pitch * (rec->hdr.frameh + y)], rowSize);
+					}
+					f->hdr.winid = rec->hdr.winid;
+					f->hdr.compress = compress >= 0 ? compress : rec->hdr.compress;
+					f->hdr.qual = qual >= 0 ? qual : rec->hdr.qual;
+					f->hdr.subsamp = subsamp >= 0 ? subsamp : rec->hdr.subsamp;
+					if(f->hdr.compress == RRCOMP_YUV) f->hdr.subsamp = 4;
+					pixels += (double)f->hdr.framew * (double)f->hdr.frameh;
+					rawBytes += (double)f->pitch * (double)f->hdr.frameh;
+					vglconn.sendFrame(f);
+					sent++;
+				}
+			}
+			while(receiver->getFrames() < sent) usleep(100);
+			elapsed = timer.elapsed();
+
+			printf("%d frames in %f seconds\n", sent, elapsed);
+			printf("%f Megapixels/sec\n", pixels / 1000000. / elapsed);
+			printf("Compression ratio: %f:1\n",
+				receiver->getBytes() > 0. ? rawBytes / receiver->getBytes() : 0.);
+		}
+
+		if(replayStream && nTiles)
+		{
+			printf("\nDecoding compressed tiles ...\n");
+
+			TileDecoder decoder;
+			timer.start();
+			for(int loop = 0; loop < loops; loop++)
+			{
+				for(unsigned int r = 0; r < reader->getCount(); r++)
+				{
+					const CaptureRecord *rec = reader->getRecord(r);
+					if(rec->type != CAPTURE_TILE) continue;
+					rrframeheader h = rec->hdr;
+					decoder.decode(h, reader->getData(r));
+				}
+			}
+			elapsed = timer.elapsed();
+
+			printf("%d frames in %f seconds\n", decoder.frames, elapsed);
+			printf("%f Megapixels/sec\n", decoder.pixels / 1000000. / elapsed);
+		}
+	}
+	catch(std::exception &e)
+	{
+		printf("%s--\n%s\n", GET_METHOD(e), e.what());
+		retval = -1;
+	}
+
+	delete receiver;
+	delete reader;
+	return retval;
+}
@@ -13,6 +13,7 @@
 // wxWindows Library License for more details.
 
 #include "VGLTrans.h"
+#include "LoopbackReceiver.h"
 #include "vglutil.h"
 #include "Timer.h"
 #include "bmp.h"
@@ -23,6 +24,31 @@ using namespace common;
 using namespace server;
 
 
+// The bandwidth estimate must be within this fraction of the rate of the
+// emulated link, once the link has been saturated
+#define BW_TOLERANCE  0.2
+
+// Print the bandwidth estimate and, if check is true, return false if it is
+// not within BW_TOLERANCE of shapeMbps.  The estimate can only be checked
+// after a test that keeps the link busy.
+bool printBandwidth(VGLTrans &vglconn, LoopbackReceiver *receiver,
+	double shapeMbps, bool check)
+{
+	if(!receiver) return true;
+	double mbps = vglconn.getBandwidth() * 8. / 1000000.;
+	printf("Estimated bandwidth = %f Mbps, RTT = %f ms\n", mbps,
+		vglconn.getRTT() * 1000.);
+	if(check && (mbps < shapeMbps * (1. - BW_TOLERANCE)
+		|| mbps > shapeMbps * (1. + BW_TOLERANCE)))
+	{
+		printf("FAILED: Estimated bandwidth is not within %d%% of %f Mbps\n",
+			(int)(BW_TOLERANCE * 100.), shapeMbps);
+		return false;
+	}
+	return true;
+}
+
+
 void usage(char **argv)
 {
 	fprintf(stderr, "\nUSAGE: %s <bitmap file> [options]\n\n", argv[0]);
@@ -44,8 +70,19 @@ void usage(char **argv)
 	fprintf(stderr, "                comparison tile (default: %d x %d pixels)\n",
 		fconfig.tilesize, fconfig.tilesize);
 	fprintf(stderr, "-rgb = Use RGB (uncompressed) encoding (default is JPEG)\n");
-	fprintf(stderr, "-np <n> = Number of threads to use for compression (default: %d)\n\n",
+	fprintf(stderr, "-np <n> = Number of threads to use for compression (default: %d)\n",
 		fconfig.np);
+	fprintf(stderr, "-shape <m> = Send the frames to an in-process receiver that reads them at\n");
+	fprintf(stderr, "             no more than <m> megabits/second, rather than to the VirtualGL\n");
+	fprintf(stderr, "             Client, and check that the estimated bandwidth is within %d%%\n",
+		(int)(BW_TOLERANCE * 100.));
+	fprintf(stderr, "             of <m>\n");
+	fprintf(stderr, "-streams <n> = Number of connections to use for sending the frames\n");
+	fprintf(stderr, "               (default: %d)\n", fconfig.streams);
+	fprintf(stderr, "-v21 = With -shape, make the in-process receiver act as a v2.1 client,\n");
+	fprintf(stderr, "       which does not support compact headers, lossless tiles, or multiple\n");
+	fprintf(stderr, "       connections\n");
+	fprintf(stderr, "-pace = Pace transmission to the estimated bandwidth (same as VGL_PACE=1)\n\n");
 	exit(1);
 }
 
@@ -55,13 +92,14 @@ int main(int argc, char **argv)
 	Timer timer;  double elapsed;
 	unsigned char *buf = NULL, *buf2 = NULL, *buf3 = NULL;
 	Display *dpy = NULL;  Window win = 0;
+	LoopbackReceiver *receiver = NULL;
 	int i, retval = 0;  int bgr = LittleEndian();
 
 	try
 	{
 		fconfig_setcompress(fconfig, RRCOMP_JPEG);
 
-		bool localtest = false;
+		bool localtest = false, v21 = false;  double shapeMbps = 0.;
 		if(argc < 2) usage(argv);
 		if(!stricmp(argv[1], "-h") || !strcmp(argv[1], "-?")) usage(argv);
 
@@ -98,6 +136,20 @@ int main(int argc, char **argv)
 			}
 			else if(!stricmp(argv[i], "-rgb"))
 				fconfig_setcompress(fconfig, RRCOMP_RGB);
+			else if(!stricmp(argv[i], "-shape") && i < argc - 1)
+			{
+				shapeMbps = atof(argv[++i]);
+				if(shapeMbps <= 0.) usage(argv);
+			}
+			else if(!stricmp(argv[i], "-streams") && i < argc - 1)
+			{
+				fconfig.streams = atoi(argv[++i]);
+				if(fconfig.streams < 1 || fconfig.streams > RR_MAXSTREAMS)
+					usage(argv);
+			}
+			else if(!stricmp(argv[i], "-v21")) v21 = true;
+			else if(!stricmp(argv[i], "-pace"))
+				fconfig.pace = 1;
 			else usage(argv);
 		}
 		if(fconfig.compress == RRCOMP_RGB) bgr = 0;
@@ -115,7 +167,7 @@ int main(int argc, char **argv)
 			THROW(bmp_geterr());
 		printf("Source image: %d x %d x %d-bit\n", w, h, d * 8);
 
-		if(!localtest)
+		if(!localtest && shapeMbps <= 0.)
 		{
 			if(!XInitThreads()) THROW("Could not initialize X threads");
 			if((dpy = XOpenDisplay(0)) == NULL) THROW("Could not open display");
@@ -133,6 +185,19 @@ int main(int argc, char **argv)
 
 		printf("Tile size = %d x %d pixels\n", fconfig.tilesize, fconfig.tilesize);
 
+		if(shapeMbps > 0.)
+		{
+			// The in-process receiver does not use the shared-memory transport, and
+			// the server will not offer multiple connections if it offers shared
+			// memory.
+			fconfig.shmtrans = 0;
+			receiver = new LoopbackReceiver(shapeMbps, false, v21);
+			strncpy(fconfig.client, "127.0.0.1:0", MAXSTR - 1);
+			fconfig.port = receiver->getPort();
+			localtest = false;
+			printf("Emulating a %f Mbps link\n", shapeMbps);
+		}
+
 		VGLTrans vglconn;
 		if(!localtest) vglconn.connect(fconfig.client, fconfig.port);
 
@@ -159,10 +224,12 @@ int main(int argc, char **argv)
 
 		printf("%f Megapixels/sec\n",
 			(double)w * (double)h * (double)frames / 1000000. / elapsed);
+		if(!printBandwidth(vglconn, receiver, shapeMbps, true)) retval = -1;
 
 		printf("\nTesting full-frame send (spoiling) ...\n");
 
 		fill = 0, frames = 0;  int clientframes = 0;  timer.start();
+		int startframes = receiver ? receiver->getFrames() : 0;
 		do
 		{
 			ERRIFNOT(f = vglconn.getFrame(w, h, bgr ? PF_BGR : PF_RGB, 0, false));
@@ -177,8 +244,10 @@ int main(int argc, char **argv)
 
 		printf("%f Megapixels/sec (server)\n",
 			(double)w * (double)h * (double)frames / 1000000. / elapsed);
+		if(receiver) clientframes = receiver->getFrames() - startframes;
 		printf("%f Megapixels/sec (client)\n",
 			(double)w * (double)h * (double)clientframes / 1000000. / elapsed);
+		if(!printBandwidth(vglconn, receiver, shapeMbps, true)) retval = -1;
 
 		printf("\nTesting half-frame send ...\n");
 
@@ -198,6 +267,7 @@ int main(int argc, char **argv)
 
 		printf("%f Megapixels/sec\n",
 			(double)w * (double)h * (double)frames / 1000000. / elapsed);
+		if(!printBandwidth(vglconn, receiver, shapeMbps, true)) retval = -1;
 
 		printf("\nTesting zero-frame send ...\n");
 
@@ -215,6 +285,8 @@ int main(int argc, char **argv)
 
 		printf("%f Megapixels/sec\n",
 			(double)w * (double)h * (double)frames / 1000000. / elapsed);
+		// No tiles are sent in this test, so the estimate is stale.
+		printBandwidth(vglconn, receiver, shapeMbps, false);
 	}
 	catch(std::exception &e)
 	{
@@ -222,6 +294,7 @@ int main(int argc, char **argv)
 		retval = -1;
 	}
 
+	delete receiver;
 	if(win) XDestroyWindow(dpy, win);
 	if(dpy) XCloseDisplay(dpy);
 	free(buf);
@@ -16,6 +16,7 @@
 #include <errno.h>
 #include "GenericQ.h"
 #include "Error.h"
+#include "vglutil.h"
 #ifdef USEHELGRIND
 	#include <valgrind/helgrind.h>
 #endif
@@ -27,6 +28,7 @@ GenericQ::GenericQ(void)
 {
 	start = NULL;  end = NULL;
 	deadYet = 0;
+	itemAdded.wait();
 	#ifdef USEHELGRIND
 	ANNOTATE_BENIGN_RACE_SIZED(&deadYet, sizeof(int), );
 	#endif
@@ -54,6 +56,7 @@ void GenericQ::release(void)
 {
 	deadYet = 1;
 	hasItem.post();
+	itemAdded.signal();
 }
 
 
@@ -86,6 +89,7 @@ void GenericQ::add(void *item)
 	temp->item = item;  temp->next = NULL;
 	end = temp;
 	hasItem.post();
+	itemAdded.signal();
 }
 
 
@@ -120,3 +124,30 @@ int GenericQ::items(void)
 	retval = hasItem.getValue();
 	return retval;
 }
+
+
+// This will block until there is something in the queue or until timeout
+// seconds have elapsed, but it does not remove anything from the queue.
+// Returns false if the queue is still empty.  The queue is checked under the
+// mutex rather than by taking and returning a count from the semaphore, which
+// would cause spoil() to overlook an item.  Only one thread (the consumer)
+// should call this method at a time.
+bool GenericQ::waitForItems(double timeout)
+{
+	double startTime = GetTime();
+
+	while(true)
+	{
+		if(deadYet) return true;
+		{
+			CriticalSection::SafeLock l(mutex);
+			if(start != NULL) return true;
+		}
+		double remaining = timeout - (GetTime() - startTime);
+		if(remaining <= 0.) return false;
+		// An item that was added before the queue was checked may have left the
+		// event signaled, in which case this returns immediately and the queue
+		// is checked again.
+		itemAdded.timedWait(remaining);
+	}
+}
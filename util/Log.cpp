@@ -1,6 +1,6 @@
 // Copyright (C)2004 Landmark Graphics Corporation
 // Copyright (C)2005, 2006 Sun Microsystems, Inc.
-// Copyright (C)2014, 2019, 2021 D. R. Commander
+// Copyright (C)2014, 2019, 2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -15,15 +15,57 @@
 #include "Log.h"
 #include <stdarg.h>
 #include <string.h>
+#ifndef _WIN32
+#include <new>
+#include <sched.h>
+#include <unistd.h>
+#endif
 #include "vglutil.h"
 
 using namespace util;
 
 
+// Messages that fit in this buffer are formatted on the stack
+#define LOG_BUFSIZE  1024
+
+// Each slot in the ring holds up to LOG_SLOTSIZE bytes, and longer messages
+// occupy consecutive slots.  The repeat limit applies only to lines that fit
+// in a single slot.
+#define LOG_SLOTS     1024
+#define LOG_SLOTSIZE  240
+
+enum { FLUSH_NONE = 0, FLUSH_FILE, FLUSH_SYNC };
+
+
 Log *Log::instance = NULL;
 CriticalSection Log::mutex;
 
 
+#ifndef _WIN32
+
+struct Log::Slot
+{
+	volatile int ready;
+	int len, flushType;
+	bool more;  // The message continues in the next slot
+	char data[LOG_SLOTSIZE];
+};
+
+#endif
+
+
+Log::Log(void)
+{
+	logFile = stderr;  newFile = false;
+	maxRepeat = repeats = lastLen = 0;  atLineStart = true;  last = NULL;
+	#ifndef _WIN32
+	slots = NULL;  head = tail = flushed = 0;  writerIdle = producers = 0;
+	async = deadYet = false;  writer = NULL;  thread = NULL;
+	wake.wait();  flushDone.wait();
+	#endif
+}
+
+
 Log *Log::getInstance(void)
 {
 	if(instance == NULL)
@@ -37,6 +79,7 @@ Log *Log::getInstance(void)
 
 void Log::logTo(FILE *logFile_)
 {
+	flush();
 	CriticalSection::SafeLock l(mutex);
 	if(logFile_)
 	{
@@ -52,6 +95,7 @@ void Log::logTo(FILE *logFile_)
 void Log::logTo(char *logFileName)
 {
 	FILE *logFile_ = NULL;
+	flush();
 	CriticalSection::SafeLock l(mutex);
 	if(logFileName)
 	{
@@ -71,43 +115,368 @@ void Log::logTo(char *logFileName)
 
 void Log::print(const char *format, ...)
 {
-	CriticalSection::SafeLock l(mutex);
 	va_list arglist;
 	va_start(arglist, format);
-	vfprintf(logFile, format, arglist);
+	write(format, arglist, false, false);
 	va_end(arglist);
 }
 
 
 void Log::PRINT(const char *format, ...)
 {
-	CriticalSection::SafeLock l(mutex);
 	va_list arglist;
 	va_start(arglist, format);
-	vfprintf(logFile, format, arglist);
+	write(format, arglist, false, true);
 	va_end(arglist);
-	flush();
 }
 
 
 void Log::println(const char *format, ...)
 {
-	CriticalSection::SafeLock l(mutex);
 	va_list arglist;
 	va_start(arglist, format);
-	vfprintf(logFile, format, arglist);
+	write(format, arglist, true, false);
 	va_end(arglist);
-	fprintf(logFile, "\n");
 }
 
 
 void Log::PRINTLN(const char *format, ...)
 {
-	CriticalSection::SafeLock l(mutex);
 	va_list arglist;
 	va_start(arglist, format);
-	vfprintf(logFile, format, arglist);
+	write(format, arglist, true, true);
 	va_end(arglist);
-	fprintf(logFile, "\n");
+}
+
+
+void Log::flush(void)
+{
+	#ifndef _WIN32
+	if(beginAsync())
+	{
+		// The Event wakes only one waiter, so only one thread at a time can wait
+		// for the writer thread.
+		CriticalSection::SafeLock l(flushMutex);
+		unsigned int target = enqueue(NULL, 0, FLUSH_SYNC);
+		endAsync();
+		while((int)(flushed - target) < 0) flushDone.wait();
+		return;
+	}
+	#endif
+	CriticalSection::SafeLock l(mutex);
+	endRepeats();
+	fflush(logFile);
+}
+
+
+FILE *Log::getFile(void)
+{
+	// The caller will write to the file directly, so anything that we have
+	// queued must be written first.
 	flush();
+	return logFile;
 }
+
+
+void Log::setRepeatLimit(int maxRepeat_)
+{
+	CriticalSection::SafeLock l(mutex);
+	endRepeats();
+	if(maxRepeat_ > 0 && !last) last = new char[LOG_SLOTSIZE];
+	maxRepeat = maxRepeat_ > 0 ? maxRepeat_ : 0;
+}
+
+
+// Format a message in the calling thread and either write it (synchronous
+// mode) or pass it to the writer thread (asynchronous mode.)
+
+void Log::write(const char *format, va_list arglist, bool newline,
+	bool flushNow)
+{
+	char stackBuf[LOG_BUFSIZE], *buf = stackBuf;
+	va_list arglist2;
+
+	va_copy(arglist2, arglist);
+	int len = vsnprintf(buf, LOG_BUFSIZE - 1, format, arglist);
+	if(len < 0) len = 0;
+	else if(len >= LOG_BUFSIZE - 1)
+	{
+		buf = new char[len + 2];
+		vsnprintf(buf, len + 1, format, arglist2);
+	}
+	va_end(arglist2);
+	if(newline) buf[len++] = '\n';
+
+	#ifndef _WIN32
+	if(beginAsync())
+	{
+		enqueue(buf, len, flushNow ? FLUSH_FILE : FLUSH_NONE);
+		endAsync();
+	}
+	else
+	#endif
+	{
+		CriticalSection::SafeLock l(mutex);
+		output(buf, len, true);
+		if(flushNow) fflush(logFile);
+	}
+	if(buf != stackBuf) delete [] buf;
+}
+
+
+// Write a message (or, if whole is false, part of a message) to the log file,
+// applying the repeat limit.  The caller must hold the mutex.
+
+void Log::output(const char *buf, int len, bool whole)
+{
+	if(maxRepeat > 0)
+	{
+		bool line = whole && atLineStart && len > 0 && len <= LOG_SLOTSIZE
+			&& buf[len - 1] == '\n';
+		if(line && len == lastLen && !memcmp(buf, last, len))
+		{
+			if(++repeats >= maxRepeat) return;
+		}
+		else
+		{
+			endRepeats();
+			if(line) { memcpy(last, buf, len);  lastLen = len; }
+		}
+	}
+	if(len > 0)
+	{
+		fwrite(buf, 1, len, logFile);
+		atLineStart = (buf[len - 1] == '\n');
+	}
+}
+
+
+void Log::endRepeats(void)
+{
+	if(maxRepeat > 0 && repeats >= maxRepeat)
+		fprintf(logFile, "[VGL] Previous message repeated %d more times\n",
+			repeats - maxRepeat + 1);
+	repeats = lastLen = 0;
+}
+
+
+#ifndef _WIN32
+
+void Log::setAsync(bool async_)
+{
+	static bool registered = false;
+
+	if(!async_) { stopWriter();  return; }
+
+	CriticalSection::SafeLock l(mutex);
+	if(async) return;
+	if(!slots) slots = new Slot[LOG_SLOTS];
+	for(int i = 0; i < LOG_SLOTS; i++) slots[i].ready = 0;
+	head = tail = flushed = 0;  writerIdle = 0;  deadYet = false;
+	writer = new Writer(this);
+	thread = new Thread(writer);
+	try
+	{
+		thread->start();
+	}
+	catch(...)
+	{
+		delete thread;  thread = NULL;  delete writer;  writer = NULL;
+		throw;
+	}
+	if(!registered)
+	{
+		pthread_atfork(atForkPrepare, atForkParent, atForkChild);
+		atexit(atExit);
+		registered = true;
+	}
+	async = true;
+}
+
+
+void Log::stopWriter(void)
+{
+	if(!async) return;
+	async = false;
+	__sync_synchronize();
+	// A producer that saw async == true before we cleared it may not have
+	// claimed its slots yet, or it may be waiting for room in the ring, so the
+	// writer thread must keep running until all such producers have finished.
+	// Any producer that arrives later sees async == false and writes its
+	// message synchronously.
+	while(producers > 0)
+	{
+		wakeWriter();  sched_yield();
+	}
+	// The writer thread exits once it has written everything in the ring.
+	deadYet = true;
+	__sync_synchronize();
+	wake.signal();
+	if(thread) { thread->stop();  delete thread;  thread = NULL; }
+	delete writer;  writer = NULL;
+	CriticalSection::SafeLock l(mutex);
+	endRepeats();
+	fflush(logFile);
+}
+
+
+// A thread that passes a message to the writer thread must call beginAsync()
+// first and, if it returns true, call endAsync() once the message has been
+// enqueued.  Incrementing the producer count before reading async (both with
+// full memory barriers) guarantees that stopWriter() either sees the producer
+// or the producer sees that asynchronous mode has been disabled.
+
+bool Log::beginAsync(void)
+{
+	__sync_fetch_and_add(&producers, 1);
+	if(async) return true;
+	__sync_fetch_and_sub(&producers, 1);
+	return false;
+}
+
+
+void Log::endAsync(void)
+{
+	__sync_fetch_and_sub(&producers, 1);
+}
+
+
+// Called by any thread to pass a message to the writer thread.  Returns the
+// index of the slot after the last slot that the message occupies.
+
+unsigned int Log::enqueue(const char *buf, int len, int flushType)
+{
+	int nSlots = len > 0 ? (len + LOG_SLOTSIZE - 1) / LOG_SLOTSIZE : 1;
+	if(nSlots > LOG_SLOTS / 2)
+	{
+		nSlots = LOG_SLOTS / 2;  len = nSlots * LOG_SLOTSIZE;
+	}
+
+	// Claiming consecutive slots with a single atomic operation keeps messages
+	// from different threads in order and prevents them from being interleaved.
+	unsigned int index = __sync_fetch_and_add(&head, nSlots);
+	for(int i = 0; i < nSlots; i++, index++)
+	{
+		// If the ring is full, then wait for the writer thread to catch up.
+		while(index - tail >= LOG_SLOTS)
+		{
+			wakeWriter();  sched_yield();
+		}
+		Slot &slot = slots[index % LOG_SLOTS];
+		slot.len = min(len, LOG_SLOTSIZE);
+		if(slot.len > 0) memcpy(slot.data, buf, slot.len);
+		buf += slot.len;  len -= slot.len;
+		slot.more = (i < nSlots - 1);
+		slot.flushType = slot.more ? FLUSH_NONE : flushType;
+		__sync_synchronize();
+		slot.ready = 1;
+	}
+	wakeWriter();
+	return index;
+}
+
+
+// The writer thread sleeps only when the ring is empty, so the Event (which
+// involves a mutex) is signaled only for the first message after an idle
+// period.
+
+void Log::wakeWriter(void)
+{
+	__sync_synchronize();
+	if(writerIdle && __sync_bool_compare_and_swap(&writerIdle, 1, 0))
+		wake.signal();
+}
+
+
+void Log::drain(void)
+{
+	bool whole = true, needFlush = false;
+
+	while(true)
+	{
+		if(!slots[tail % LOG_SLOTS].ready)
+		{
+			if(deadYet && tail == head) break;
+			writerIdle = 1;
+			__sync_synchronize();
+			if(slots[tail % LOG_SLOTS].ready || deadYet)
+			{
+				// If a producer has already cleared the flag, then it has also
+				// signaled the Event, which must be reset.
+				if(!__sync_bool_compare_and_swap(&writerIdle, 1, 0)) wake.wait();
+				if(!slots[tail % LOG_SLOTS].ready) sched_yield();
+			}
+			else wake.wait();
+			continue;
+		}
+
+		// Write all of the messages that are ready, and then flush the log file
+		// if any of them requested it.
+		CriticalSection::SafeLock l(mutex);
+		Slot *slot;
+		while((slot = &slots[tail % LOG_SLOTS])->ready)
+		{
+			__sync_synchronize();
+			int flushType = slot->flushType;
+			output(slot->data, slot->len, whole && !slot->more);
+			whole = !slot->more;
+			slot->ready = 0;
+			__sync_synchronize();
+			tail++;
+			if(flushType == FLUSH_SYNC) endRepeats();
+			if(flushType != FLUSH_NONE) needFlush = true;
+			if(flushType == FLUSH_SYNC) break;
+		}
+		if(needFlush)
+		{
+			fflush(logFile);  needFlush = false;  flushed = tail;
+			flushDone.signal();
+		}
+	}
+}
+
+
+void Log::atExit(void)
+{
+	if(instance) instance->stopWriter();
+}
+
+
+void Log::atForkPrepare(void)
+{
+	mutex.lock(false);
+}
+
+
+void Log::atForkParent(void)
+{
+	mutex.unlock(false);
+}
+
+
+// The writer thread does not exist in the child process, so the child logs
+// synchronously.  Anything left in the ring belongs to the parent.  The
+// mutexes may be owned by the parent's thread IDs, so the child cannot unlock
+// them and must instead re-create them.
+
+void Log::atForkChild(void)
+{
+	new (&mutex) CriticalSection();
+	if(instance && instance->async)
+	{
+		new (&instance->flushMutex) CriticalSection();
+		instance->async = false;
+		instance->thread = NULL;  instance->writer = NULL;
+		for(int i = 0; i < LOG_SLOTS; i++) instance->slots[i].ready = 0;
+		instance->head = instance->tail = instance->flushed = 0;
+		instance->writerIdle = instance->producers = 0;
+	}
+}
+
+#else
+
+void Log::setAsync(bool async_)
+{
+}
+
+#endif
@@ -14,9 +14,12 @@
 
 #include "Mutex.h"
 #ifndef _WIN32
+#include <errno.h>
 #include <string.h>
+#include <time.h>
 #endif
 #include "Error.h"
+#include "vglutil.h"
 
 using namespace util;
 
@@ -31,7 +34,17 @@ Event::Event(void)
 
 	ready = true;  deadYet = false;
 	pthread_mutex_init(&mutex, NULL);
+	#ifdef __APPLE__
 	pthread_cond_init(&cond, NULL);
+	#else
+	// Timed waits are measured on the monotonic clock, so that they are not
+	// affected by changes to the system time.
+	pthread_condattr_t ca;
+	pthread_condattr_init(&ca);
+	pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+	pthread_cond_init(&cond, &ca);
+	pthread_condattr_destroy(&ca);
+	#endif
 
 	#endif
 }
@@ -86,6 +99,64 @@ void Event::wait(void)
 }
 
 
+// Wait for up to timeout seconds.  Returns false if the event was not signaled
+// within that time.
+bool Event::timedWait(double timeout)
+{
+	#ifdef _WIN32
+
+	DWORD err = WaitForSingleObject(event, (DWORD)(timeout * 1000.));
+	if(err == WAIT_FAILED) throw(W32Error("Event::timedWait()"));
+	return err != WAIT_TIMEOUT;
+
+	#else
+
+	int ret;
+	bool signaled;
+	#ifdef __APPLE__
+	double start = GetTime();
+	#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	long long nsec = (long long)ts.tv_nsec +
+		(long long)(max(timeout, 0.) * 1000000000.);
+	ts.tv_sec += (time_t)(nsec / 1000000000LL);
+	ts.tv_nsec = (long)(nsec % 1000000000LL);
+	#endif
+
+	if((ret = pthread_mutex_lock(&mutex)) != 0)
+		throw(Error("Event::timedWait()", strerror(ret)));
+	while(!ready && !deadYet)
+	{
+		#ifdef __APPLE__
+		// macOS does not support pthread_condattr_setclock(), but it has a
+		// relative timed wait.
+		double remaining = timeout - (GetTime() - start);
+		if(remaining <= 0.) break;
+		struct timespec ts;
+		ts.tv_sec = (time_t)remaining;
+		ts.tv_nsec = (long)((remaining - (double)ts.tv_sec) * 1000000000.);
+		ret = pthread_cond_timedwait_relative_np(&cond, &mutex, &ts);
+		#else
+		ret = pthread_cond_timedwait(&cond, &mutex, &ts);
+		#endif
+		if(ret == ETIMEDOUT) break;
+		else if(ret != 0)
+		{
+			pthread_mutex_unlock(&mutex);
+			throw(Error("Event::timedWait()", strerror(ret)));
+		}
+	}
+	signaled = ready || deadYet;
+	ready = false;
+	if((ret = pthread_mutex_unlock(&mutex)) != 0)
+		throw(Error("Event::timedWait()", strerror(ret)));
+	return signaled;
+
+	#endif
+}
+
+
 void Event::signal(void)
 {
 	#ifdef _WIN32
@@ -26,6 +26,10 @@
 	#include <arpa/inet.h>
 	#include <netdb.h>
 	#include <netinet/tcp.h>
+	#ifdef __linux__
+		#include <sys/ioctl.h>
+		#include <linux/sockios.h>
+	#endif
 	#define SOCKET_ERROR  -1
 	#define INVALID_SOCKET  -1
 #endif
@@ -253,6 +257,40 @@ const char *Socket::remoteName(void)
 }
 
 
+static bool isLoopback(SockAddr &addr)
+{
+	if(addr.u.ss.ss_family == AF_INET6)
+	{
+		if(IN6_IS_ADDR_LOOPBACK(&addr.u.sin6.sin6_addr)) return true;
+		if(IN6_IS_ADDR_V4MAPPED(&addr.u.sin6.sin6_addr))
+			return addr.u.sin6.sin6_addr.s6_addr[12] == 127;
+		return false;
+	}
+	return (ntohl(addr.u.sin.sin_addr.s_addr) >> 24) == 127;
+}
+
+
+// Returns true if the peer is on the same host as this process, i.e. if it is
+// connected through the loopback interface or from one of our own addresses.
+bool Socket::isLocal(void)
+{
+	SockAddr localaddr, remoteaddr;
+	SOCKLEN_T addrlen = sizeof(struct sockaddr_storage);
+
+	if(sd == INVALID_SOCKET) THROW("Not connected");
+
+	TRY_SOCK(getpeername(sd, &remoteaddr.u.sa, &addrlen));
+	if(isLoopback(remoteaddr)) return true;
+	addrlen = sizeof(struct sockaddr_storage);
+	TRY_SOCK(getsockname(sd, &localaddr.u.sa, &addrlen));
+	if(localaddr.u.ss.ss_family != remoteaddr.u.ss.ss_family) return false;
+	if(remoteaddr.u.ss.ss_family == AF_INET6)
+		return !memcmp(&localaddr.u.sin6.sin6_addr, &remoteaddr.u.sin6.sin6_addr,
+			sizeof(struct in6_addr));
+	return localaddr.u.sin.sin_addr.s_addr == remoteaddr.u.sin.sin_addr.s_addr;
+}
+
+
 void Socket::send(char *buf, int len)
 {
 	if(sd == INVALID_SOCKET) THROW("Not connected");
@@ -281,3 +319,34 @@ void Socket::recv(char *buf, int len)
 	}
 	if(bytesRead != len) THROW("Incomplete receive");
 }
+
+
+// Returns the number of bytes that have been passed to send() but not yet
+// acknowledged by the peer (that is, the bytes that are still in transit or
+// waiting in the kernel's send buffer), or -1 if the platform does not provide
+// this information.
+int Socket::sendQueue(void)
+{
+	if(sd == INVALID_SOCKET) THROW("Not connected");
+	#ifdef SIOCOUTQ
+	int queued = 0;
+	if(ioctl(sd, SIOCOUTQ, &queued) == 0) return queued;
+	#endif
+	return -1;
+}
+
+
+// Returns the kernel's smoothed estimate of the round-trip time (in seconds)
+// for this connection, or -1.0 if the platform does not provide it.
+double Socket::rtt(void)
+{
+	if(sd == INVALID_SOCKET) THROW("Not connected");
+	#if defined(__linux__) && defined(TCP_INFO)
+	struct tcp_info info;
+	SOCKLEN_T infolen = sizeof(info);
+	if(getsockopt(sd, IPPROTO_TCP, TCP_INFO, &info, &infolen) == 0
+		&& info.tcpi_rtt > 0)
+		return (double)info.tcpi_rtt / 1000000.;
+	#endif
+	return -1.;
+}
@@ -1,6 +1,6 @@
 // Copyright (C)2004 Landmark Graphics Corporation
 // Copyright (C)2005 Sun Microsystems, Inc.
-// Copyright (C)2014, 2019, 2021 D. R. Commander
+// Copyright (C)2014, 2019, 2021, 2026 D. R. Commander
 //
 // This library is free software and may be redistributed and/or modified under
 // the terms of the wxWindows Library License, Version 3.1 or (at your option)
@@ -13,6 +13,11 @@
 // wxWindows Library License for more details.
 
 #include "Thread.h"
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sched.h>
+#include <strings.h>
+#endif
 
 using namespace util;
 
@@ -79,6 +84,120 @@ void Thread::checkError(void)
 }
 
 
+void Thread::setAffinity(const char *cpuList)
+{
+	if(!cpuList) throw(Error("Thread::setAffinity()", "Invalid argument"));
+
+	#if defined(_WIN32) || defined(__linux__)
+
+	#ifdef _WIN32
+	DWORD_PTR mask = 0;
+	const int maxCPUs = sizeof(DWORD_PTR) * 8;
+	#else
+	cpu_set_t mask;
+	CPU_ZERO(&mask);
+	const int maxCPUs = CPU_SETSIZE;
+	#endif
+	const char *ptr = cpuList;
+	int nCPUs = 0;
+
+	while(*ptr)
+	{
+		char *end = NULL;
+		long first = strtol(ptr, &end, 10), last = first;
+		if(end == ptr) throw(Error("Thread::setAffinity()", "Invalid CPU list"));
+		ptr = end;
+		if(*ptr == '-')
+		{
+			last = strtol(++ptr, &end, 10);
+			if(end == ptr) throw(Error("Thread::setAffinity()", "Invalid CPU list"));
+			ptr = end;
+		}
+		if(first < 0 || last < first || last >= maxCPUs)
+			throw(Error("Thread::setAffinity()", "CPU number is out of range"));
+		for(long cpu = first; cpu <= last; cpu++, nCPUs++)
+		{
+			#ifdef _WIN32
+			mask |= (DWORD_PTR)1 << cpu;
+			#else
+			CPU_SET(cpu, &mask);
+			#endif
+		}
+		if(*ptr == ',') ptr++;
+		else if(*ptr)
+			throw(Error("Thread::setAffinity()", "Invalid CPU list"));
+	}
+	if(nCPUs < 1) throw(Error("Thread::setAffinity()", "Invalid CPU list"));
+
+	#ifdef _WIN32
+	if(!SetThreadAffinityMask(GetCurrentThread(), mask))
+		throw(W32Error("Thread::setAffinity()"));
+	#else
+	int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &mask);
+	if(err != 0) throw(Error("Thread::setAffinity()", strerror(err)));
+	#endif
+
+	#else
+
+	throw(Error("Thread::setAffinity()",
+		"CPU affinity is not supported on this platform"));
+
+	#endif
+}
+
+
+void Thread::setScheduling(const char *policy)
+{
+	if(!policy) throw(Error("Thread::setScheduling()", "Invalid argument"));
+
+	#ifdef _WIN32
+
+	throw(Error("Thread::setScheduling()",
+		"Scheduling policies are not supported on this platform"));
+
+	#else
+
+	int pol = -1, len = strcspn(policy, ":");
+	bool realTime = false;
+
+	if(len == 5 && !strncasecmp(policy, "other", 5)) pol = SCHED_OTHER;
+	#ifdef SCHED_BATCH
+	else if(len == 5 && !strncasecmp(policy, "batch", 5)) pol = SCHED_BATCH;
+	#endif
+	#ifdef SCHED_IDLE
+	else if(len == 4 && !strncasecmp(policy, "idle", 4)) pol = SCHED_IDLE;
+	#endif
+	else if(len == 4 && !strncasecmp(policy, "fifo", 4))
+	{
+		pol = SCHED_FIFO;  realTime = true;
+	}
+	else if(len == 2 && !strncasecmp(policy, "rr", 2))
+	{
+		pol = SCHED_RR;  realTime = true;
+	}
+	if(pol < 0)
+		throw(Error("Thread::setScheduling()", "Unknown scheduling policy"));
+
+	struct sched_param param;
+	memset(&param, 0, sizeof(param));
+	if(realTime) param.sched_priority = sched_get_priority_min(pol);
+	if(policy[len] == ':')
+	{
+		char *end = NULL;
+		long priority = strtol(&policy[len + 1], &end, 10);
+		if(end == &policy[len + 1] || *end
+			|| priority < sched_get_priority_min(pol)
+			|| priority > sched_get_priority_max(pol))
+			throw(Error("Thread::setScheduling()", "Invalid priority"));
+		param.sched_priority = priority;
+	}
+	int err = pthread_setschedparam(pthread_self(), pol, &param);
+	if(err != 0) throw(Error("Thread::setScheduling()", strerror(err)));
+
+	#endif
+}
+
+
 #ifdef _WIN32
 DWORD WINAPI Thread::threadFunc(void *param)
 #else
@@ -0,0 +1,205 @@
+// Copyright (C)2026 D. R. Commander
+//
+// This library is free software and may be redistributed and/or modified under
+// the terms of the wxWindows Library License, Version 3.1 or (at your option)
+// any later version.  The full license is in the LICENSE.txt file included
+// with this distribution.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// wxWindows Library License for more details.
+
+#include "WorkerPool.h"
+#include <string.h>
+
+using namespace util;
+
+
+struct WorkerPool::Batch
+{
+	Batch(void) : remaining(0) { done.wait(); }
+
+	int remaining;
+	Event done;
+	Error error;
+};
+
+
+WorkerPool::WorkerPool(int nThreads_, const char *cpuList_,
+	const char *schedPolicy_) : nThreads(nThreads_), head(NULL), tail(NULL),
+	deadYet(false), workers(NULL), threads(NULL)
+{
+	if(nThreads < 0) nThreads = 0;
+	cpuList[0] = schedPolicy[0] = setupError[0] = 0;
+	if(cpuList_) { strncpy(cpuList, cpuList_, 255);  cpuList[255] = 0; }
+	if(schedPolicy_)
+	{
+		strncpy(schedPolicy, schedPolicy_, 255);  schedPolicy[255] = 0;
+	}
+	if(nThreads == 0) return;
+
+	workers = new Worker *[nThreads];
+	threads = new Thread *[nThreads];
+	for(int i = 0; i < nThreads; i++)
+	{
+		workers[i] = NULL;  threads[i] = NULL;
+	}
+	try
+	{
+		for(int i = 0; i < nThreads; i++)
+		{
+			workers[i] = new Worker(this);
+			threads[i] = new Thread(workers[i]);
+			threads[i]->start();
+		}
+	}
+	catch(...)
+	{
+		cleanup();  throw;
+	}
+}
+
+
+WorkerPool::~WorkerPool(void)
+{
+	cleanup();
+}
+
+
+void WorkerPool::cleanup(void)
+{
+	deadYet = true;
+	if(threads)
+	{
+		for(int i = 0; i < nThreads; i++) pending.post();
+		for(int i = 0; i < nThreads; i++)
+		{
+			if(threads[i]) { threads[i]->stop();  delete threads[i]; }
+			delete workers[i];
+		}
+		delete [] threads;  threads = NULL;
+		delete [] workers;  workers = NULL;
+	}
+}
+
+
+const char *WorkerPool::getSetupError(void)
+{
+	CriticalSection::SafeLock l(mutex);
+	return setupError[0] ? setupError : NULL;
+}
+
+
+void WorkerPool::runJob(Job *job, Batch *batch)
+{
+	Error error;
+	try
+	{
+		job->execute();
+	}
+	catch(std::exception &e)
+	{
+		error = e;
+	}
+
+	CriticalSection::SafeLock l(mutex);
+	if(error && !batch->error) batch->error = error;
+	if(--batch->remaining == 0) batch->done.signal();
+}
+
+
+void WorkerPool::execute(Job **jobs, int nJobs)
+{
+	if(!jobs || nJobs < 1) return;
+
+	Batch batch;
+	batch.remaining = nJobs;
+	Entry *entries = NULL;
+
+	if(nJobs > 1 && nThreads > 0)
+	{
+		entries = new Entry[nJobs - 1];
+		CriticalSection::SafeLock l(mutex);
+		for(int i = 1; i < nJobs; i++)
+		{
+			Entry *entry = &entries[i - 1];
+			entry->job = jobs[i];  entry->batch = &batch;  entry->next = NULL;
+			if(tail) tail->next = entry;
+			else head = entry;
+			tail = entry;
+		}
+	}
+	if(entries) for(int i = 1; i < nJobs; i++) pending.post();
+
+	runJob(jobs[0], &batch);
+
+	if(entries)
+	{
+		// Run any jobs in this batch that the worker threads haven't picked up
+		// yet.
+		while(true)
+		{
+			Entry *entry = NULL;
+			{
+				CriticalSection::SafeLock l(mutex);
+				Entry *prev = NULL;
+				for(entry = head; entry; prev = entry, entry = entry->next)
+				{
+					if(entry->batch != &batch) continue;
+					if(prev) prev->next = entry->next;
+					else head = entry->next;
+					if(tail == entry) tail = prev;
+					break;
+				}
+			}
+			if(!entry) break;
+			runJob(entry->job, &batch);
+		}
+		batch.done.wait();
+		delete [] entries;
+	}
+	else
+	{
+		for(int i = 1; i < nJobs; i++) runJob(jobs[i], &batch);
+	}
+
+	if(batch.error) throw batch.error;
+}
+
+
+void WorkerPool::Worker::run(void)
+{
+	try
+	{
+		if(parent->cpuList[0]) Thread::setAffinity(parent->cpuList);
+		if(parent->schedPolicy[0]) Thread::setScheduling(parent->schedPolicy);
+	}
+	catch(std::exception &e)
+	{
+		CriticalSection::SafeLock l(parent->mutex);
+		if(!parent->setupError[0])
+		{
+			strncpy(parent->setupError, e.what(), 256);
+			parent->setupError[256] = 0;
+		}
+	}
+
+	while(true)
+	{
+		parent->pending.wait();
+		if(parent->deadYet) break;
+
+		Entry *entry = NULL;
+		{
+			CriticalSection::SafeLock l(parent->mutex);
+			if((entry = parent->head) != NULL)
+			{
+				parent->head = entry->next;
+				if(!parent->head) parent->tail = NULL;
+			}
+		}
+		// The job may have already been run by the thread that submitted it.
+		if(entry) parent->runJob(entry->job, entry->batch);
+	}
+}
@@ -17,6 +17,7 @@
 #include "vglutil.h"
 #include "Thread.h"
 #include "Mutex.h"
+#include "WorkerPool.h"
 
 using namespace util;
 
@@ -80,13 +81,91 @@ class TestThread : public Runnable
 };
 
 
+class TestJob : public WorkerPool::Job
+{
+	public:
+
+		TestJob(int myRank_) : myRank(myRank_), runs(0), sum(0) {}
+
+		static long expectedSum(int rank)
+		{
+			long sum = 0;
+			for(int i = 1; i <= 1000000; i++) sum += i % (rank + 2);
+			return sum;
+		}
+
+		void execute(void)
+		{
+			runs++;  sum = 0;
+			for(int i = 1; i <= 1000000; i++) sum += i % (myRank + 2);
+			if(myRank == 7) THROW("Job error test");
+		}
+
+		// Check that the job ran exactly once since the last call to check()
+		// and produced the correct result.
+		void check(void)
+		{
+			char msg[256];
+			if(runs != 1)
+			{
+				snprintf(msg, 256, "Job %d ran %d times (expected 1)", myRank, runs);
+				THROW(msg);
+			}
+			if(sum != expectedSum(myRank))
+			{
+				snprintf(msg, 256, "Job %d:  sum = %ld (expected %ld)", myRank, sum,
+					expectedSum(myRank));
+				THROW(msg);
+			}
+			runs = 0;
+		}
+
+		int myRank, runs;  long sum;
+};
+
+
 int main(void)
 {
 	TestThread *testThread[5];  Thread *thread[5];  int i;
 
 	try
 	{
-		printf("Number of CPU cores in this system:  %d\n", NumProcs());
+		WorkerPool pool(3);
+		TestJob *testJob[8];  WorkerPool::Job *jobs[8];
+
+		printf("Running 7 jobs on a pool of 3 worker threads\n");
+		for(i = 0; i < 8; i++) jobs[i] = testJob[i] = new TestJob(i);
+		pool.execute(jobs, 7);
+		for(i = 0; i < 7; i++)
+		{
+			printf("Job %d:  sum = %ld\n", i, testJob[i]->sum);
+			testJob[i]->check();
+		}
+		printf("Running 8 jobs on a pool of 3 worker threads\n");
+		bool threw = false;
+		try
+		{
+			pool.execute(jobs, 8);
+		}
+		catch(std::exception &e)
+		{
+			printf("Job error (expected):  %s\n", e.what());
+			threw = true;
+		}
+		if(!threw) THROW("Job error was not reported");
+		// All of the jobs in a batch must run, even if one of them fails.
+		for(i = 0; i < 8; i++) testJob[i]->check();
+		for(i = 0; i < 8; i++) delete testJob[i];
+	}
+	catch(std::exception &e)
+	{
+		printf("Error in %s:\n%s\n", GET_METHOD(e), e.what());
+		return -1;
+	}
+
+	try
+	{
+		printf("\nNumber of CPU cores in this system:  %d\n", NumProcs());
 		printf("Word size = %d-bit\n", (int)sizeof(long *) * 8);
 
 		event.wait();